@@ -0,0 +1,26 @@
+; Two processes taking turns to enter a critical section, with the shared parts of the formulae
+; given names. Bit 0 is set while process 0 is critical, bit 1 while process 1 is, and bit 2 says
+; whose turn it is.
+(define crit0 (var 0))
+(define crit1 (var 1))
+(define both (and crit0 crit1))
+(define keep-turn (not (xor (var to 2) (var from 2))))
+(system 3
+        ; Init: nobody critical, turn of process 0
+        (and (not crit0) (not crit1) (not (var 2)))
+        ; Trans: the process whose turn it is enters or leaves, and hands the turn over on leaving
+        (let ((turn0 (not (var from 2)))
+              (other-stays (not (xor (var to 1) (var from 1)))))
+            (or (and turn0 (not (var from 0)) (var to 0) keep-turn other-stays)
+                (and turn0 (var from 0) (not (var to 0)) (var to 2) other-stays)
+                (and (not turn0) (not (var from 1)) (var to 1) keep-turn
+                     (not (xor (var to 0) (var from 0))))
+                (and (not turn0) (var from 1) (not (var to 1)) (not (var to 2))
+                     (not (xor (var to 0) (var from 0))))))
+        (properties (AG (not both))                 ; True, never both critical
+                    (AG (AF crit1))                 ; True, process 1 always gets its turn
+                    (let ((idle (and (not crit0) (not crit1))))
+                        (AG (EF idle)))             ; True, both can always be idle again
+                    (EF (and crit1 (not (var 2))))  ; False, process 1 is only critical on its turn
+        )
+)
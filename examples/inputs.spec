@@ -0,0 +1,16 @@
+; A register loaded from a 2 bit input whenever the load input is set, and kept otherwise. The
+; inputs are chosen freely at each step, and are not part of the state.
+(word reg 2)
+(input data 2)
+(input load 1)
+(system 2
+        ; Init: the register is 0
+        (= reg 0)
+        ; Trans:
+        (= (to reg) (ite (= load 1) data (from reg)))
+        (properties (AG (EF (= reg 3)))             ; True, any value can be loaded at any time
+                    (EG (= reg 0))                  ; True, the load may never be set
+                    (AG (= reg 0))                  ; False, a nonzero value can be loaded
+                    (AX (= reg 0))                  ; False, the first step may load
+        )
+)
@@ -0,0 +1,21 @@
+; A counter that steps by one in slow mode and by two in fast mode, and goes back to 0 once it has
+; reached its limit. The mode may change at any step, the limit never does.
+(interleave (word count 3) (word limit 3))
+(enum mode slow fast)
+(system 7
+        ; Init: count 0, limit 5, either mode
+        (and (= count 0) (= limit 5))
+        ; Trans:
+        (and (= (to limit) (from limit))
+             (= (to count) (ite (< (from count) (from limit))
+                                (+ (from count) (ite (= (from mode) fast) 2 1))
+                                0)))
+        (properties (AG (<= count 6))               ; True, the count stops at or just past 5
+                    (EF (= count 6))                ; True, fast mode steps from 4 to 6
+                    (AG (not (= count 7)))          ; True, 7 is never reached
+                    (AG (<= count limit))           ; False, 6 is past the limit
+                    (AG (AF (= count 0)))           ; True, the count always goes back to 0
+                    (EX (EG (= mode slow)))         ; True, the mode may be slow from then on
+                    (AF (= count 3))                ; False, fast mode can step over 3
+        )
+)
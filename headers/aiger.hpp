@@ -0,0 +1,138 @@
+/**
+ * Header declaring a reader for and-inverter graphs in the AIGER format, as used by hardware model
+ * checking competitions. Both the ASCII (`aag`) and binary (`aig`) forms are read, along with the
+ * bad state, invariant constraint, justice and fairness sections added in AIGER 1.9. The latches of
+ * the circuit become the bits of the state, and its inputs the inputs of the StateSpace.
+ */
+
+#ifndef AIGER_H
+#define AIGER_H
+
+#include "headers/pred.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+
+/**
+ * A circuit read from an AIGER file. Parsing only reads the structure of the circuit, the BDDs are
+ * built over a StateSpace with `num_latches` state bits and `num_inputs` input bits. The function of
+ * each and gate is built at most once, and is shared by every latch, property and constraint that
+ * uses it. Throws a runtime_error if the file is malformed.
+ */
+class Aiger
+{
+    public:
+        Aiger(const char* data, size_t size);
+
+        /**
+         * Returns true if the buffer starts with the header of an AIGER file
+         */
+        static bool is_aiger(const char* data, size_t size);
+
+        int num_inputs() const { return inputs.size(); }
+        int num_latches() const { return latches.size(); }
+
+        /**
+         * The properties of the circuit as the properties section of a specification. Each bad
+         * state literal, or each output if there are no bad state or justice literals, becomes a
+         * property that the literal is never true. A justice property becomes a property that there
+         * is no fair path, with the justice literals as fairness constraints. Only one justice
+         * property is supported, as the transition has a single set of fairness constraints.
+         */
+        const std::string& properties() const { return props; }
+
+        /**
+         * The names used in `properties()` for the bad state literals, and a description of each
+         * property for the user, from the symbol table if it has one
+         */
+        const std::vector<std::string>& signal_names() const { return names; }
+        const std::vector<std::string>& descriptions() const { return descs; }
+
+        /**
+         * Returns true if the i-th property, counting from 1, is to be checked under the fairness
+         * constraints of the transition, which is only the case for the justice property. The bad
+         * state properties are checked without them.
+         */
+        bool fair(size_t i) const { return i > checked.size(); }
+
+        /**
+         * Build the initial states and the transition relation, adding the fairness constraints of
+         * the justice property to it. The relation is the conjunction of one partition per latch
+         * relating its next value to its next state function, and of the invariant constraints on
+         * the state it goes from.
+         */
+        void build_model(const StateSpace& sp, Predicate& init, Transition& trans);
+
+        /**
+         * Build the states in which some input makes each bad state literal named in
+         * `signal_names()` true while the invariant constraints hold
+         */
+        std::vector<Predicate> build_signals(const StateSpace& sp);
+
+    private:
+        /**
+         * What defines a variable of the circuit. The index is that of the input, latch or and
+         * gate.
+         */
+        enum Kind { UNDEFINED, CONSTANT, INPUT, LATCH, AND };
+        struct VarDef
+        {
+            Kind kind;
+            unsigned index;
+        };
+        struct Latch
+        {
+            unsigned lit;
+            unsigned next;
+            unsigned reset;     // 0, 1, or `lit` if the initial value is arbitrary
+        };
+        struct Gate
+        {
+            unsigned lhs;
+            unsigned rhs0;
+            unsigned rhs1;
+        };
+
+        void define(unsigned lit, Kind kind, unsigned index);
+        void check_literal(unsigned lit) const;
+        void make_properties();
+
+        /**
+         * The function of a literal over the inputs and the state a transition goes from, building
+         * the and gates it depends on that have not been built yet
+         */
+        Transition literal(const StateSpace& sp, unsigned lit);
+
+        /**
+         * States where the function of a literal holds with the constraints for some input
+         */
+        Predicate literal_states(const StateSpace& sp, unsigned lit);
+
+        unsigned max_var;
+        std::vector<unsigned> inputs;
+        std::vector<Latch> latches;
+        std::vector<unsigned> outputs;
+        std::vector<unsigned> bad;
+        std::vector<unsigned> constraints;
+        std::vector<std::vector<unsigned> > justice;
+        std::vector<unsigned> fairness;
+        std::vector<Gate> gates;
+        std::vector<VarDef> defs;
+
+        std::vector<std::string> output_syms;
+        std::vector<std::string> bad_syms;
+        std::vector<std::string> justice_syms;
+        std::vector<unsigned> checked;          // Literals checked by the properties
+        std::string props;
+        std::vector<std::string> names;
+        std::vector<std::string> descs;
+
+        std::vector<std::unique_ptr<Transition> > funcs;   // Built functions, indexed by variable
+        std::vector<bool> expanded;     // And gates whose operands have been pushed by `literal`
+};
+
+#endif
@@ -1,31 +1,33 @@
 /**
- * Header file declaring a class to represent a BDD. This will be a wrapper around the CUDD
- * interface
+ * Header file declaring a class to represent a BDD. This will be a wrapper around a BDD backend, by
+ * default the one using CUDD
  */
 
 #ifndef BDD_H
 #define BDD_H
 
+#include "headers/bdd_backend.hpp"
+
+#include <cstdint>                  // Truth tables
+#include <functional>               // Cube enumeration
+#include <random>                   // Random minterms
 #include <string>                   // Filenames
 #include <vector>                   // List of variables
+#include <istream>                  // Serialization
+#include <ostream>
 
-/** 
- * Forward declare DdNode and DdManager here
- */
-struct DdNode;
-struct DdManager;
 
 
 /**
- * Class representing a BDD. Wraps around DdNode, and takes care of reference incrementing and
- * decrementing. Also provides nice syntax for logical operations on BDD.
+ * Class representing a BDD. Wraps around a node of a backend, and takes care of reference
+ * incrementing and decrementing. Also provides nice syntax for logical operations on BDD. New BDDs
+ * are made with the current backend, and each BDD keeps the backend it was made with.
  */
 class BDD
 {
     public:
         /**
-         * Constructor to create a new BDD representing just the variable with the given index. Must
-         * be given a manager.
+         * Constructor to create a new BDD representing just the variable with the given index
          */
         BDD(int var_index);
 
@@ -55,8 +57,8 @@ class BDD
         ~BDD();
 
         /**
-         * Logical operators, along with their assignment counterparts. Note that calling these is
-         * safe only if both operands are initialized with same manager.
+         * Logical operators, along with their assignment counterparts. Both operands must have the
+         * same backend.
          */
         friend BDD operator&&(const BDD& bddl, const BDD& bddr);
         friend BDD operator||(const BDD& bddl, const BDD& bddr);
@@ -80,9 +82,20 @@ class BDD
         bool is_one()   const;
 
         /**
-         * Get a satisfying assignment for this BDD
+         * Check if this BDD implies the other, without building their combination
          */
-        std::vector<bool> get_assign();
+        bool leq(const BDD& other) const;
+
+        /**
+         * Pick a satisfying assignment of the BDD, returning the values of `vars` in their order.
+         * A single path is walked down from the root. Without `rng` it takes the else branch
+         * wherever it can and sets the variables left off the path to 1, so the choice is fixed by
+         * the BDD. With `rng` the branch is chosen at random where both satisfy, and so are the
+         * free variables. Variables on the path but not in `vars` are chosen the same way and not
+         * returned.
+         */
+        std::vector<bool> pick_minterm(const std::vector<int>& vars, 
+                                       std::mt19937_64* rng = NULL) const;
 
         /**
          * Abstract the BDD using quantifiers over variable with given index, or vector of variables
@@ -95,17 +108,115 @@ class BDD
         BDD universal_abstraction  (std::vector<int>& var_indices) const;
         BDD universal_abstraction  (const BDD& cube) const;
 
+        /**
+         * Abstract the variables of cube from the conjunction of this BDD and other, without
+         * building the conjunction
+         */
+        BDD and_abstraction(const BDD& other, const BDD& cube) const;
+
+        /**
+         * Indices of the variables the BDD depends on, in increasing order
+         */
+        std::vector<int> support() const;
+
+        /**
+         * A BDD that agrees with this one wherever care holds, and is usually smaller. Outside care
+         * its value is arbitrary.
+         */
+        BDD restrict(const BDD& care) const;
+
+        /**
+         * The BDD with each variable i replaced by variable perm[i]. Variables from the size of
+         * perm on are kept.
+         */
+        BDD permute(const std::vector<int>& perm) const;
+
+        /**
+         * The truth table of the BDD over the given variables, which must include its support. Bit
+         * i of the table, counting from the least significant bit of the first word, is the value
+         * of the BDD when each vars[j] is bit j of i. `from_truth_table` builds the BDD back from
+         * such a table.
+         */
+        std::vector<uint64_t> truth_table(const std::vector<int>& vars) const;
+        static BDD from_truth_table(const std::vector<int>& vars, 
+                                    const std::vector<uint64_t>& table);
+
+        /**
+         * The cube given by the value of each variable by its index, as in for_each_cube: 0 or 1
+         * for a negative or positive literal, and 2 if the variable is left out
+         */
+        static BDD from_cube(const std::vector<int>& values);
+
+        /**
+         * Call visit with each cube of a cover of the BDD by disjoint cubes, until it returns false.
+         * A cube gives the value of each variable of the manager by its index: 0, 1, or 2 if the
+         * cube allows both.
+         */
+        void for_each_cube(const std::function<bool(const std::vector<int>&)>& visit) const;
+
         /**
          * Print out a representation of the BDD in dot format
          */
         void save_dot(const std::string& filename, bool draw_0_arc = false) const;
 
+        /**
+         * Number of nodes in the DAG of this BDD, including the constant node
+         */
+        size_t node_count() const;
+
+        /**
+         * The number of assignments to `vars` that satisfy the BDD, which must not depend on other
+         * variables, in decimal. The count is exact however many variables there are.
+         */
+        std::string count_minterms(const std::vector<int>& vars) const;
+
+        /**
+         * Read the current counters of the current backend
+         */
+        static ManagerStats read_manager_stats();
+
+        /**
+         * Make new BDDs with the given backend from now on, taking ownership of it. BDDs made
+         * before keep using the backend they were made with, which is never freed. The default
+         * backend is a CuddBackend, made when the first BDD is.
+         */
+        static void set_backend(BDDBackend* backend);
+
+        /**
+         * Make new BDDs on the calling thread with the given backend, or with the shared one again
+         * if it is NULL. The caller keeps ownership. `new_backend` makes an empty backend of the
+         * same kind as the current one, owned by the caller.
+         */
+        static void set_thread_backend(BDDBackend* backend);
+        static BDDBackend* new_backend();
+
+        /**
+         * The same function in the current backend, rebuilt node by node if this BDD was made with
+         * another one. The other backend is only read, so several threads can transfer from it at
+         * once as long as nothing else uses it meanwhile.
+         */
+        BDD transfer() const;
+
+        /**
+         * Write out the given BDDs to a binary stream, and read them back. Nodes shared between the
+         * BDDs are written only once. The format is a list of nodes with children before parents,
+         * each given by its variable index and references to its children, followed by references
+         * to the roots. It uses the byte order of the host. `load` throws a runtime_error if the
+         * stream is malformed, including when a node has a variable index of `n_vars` or more.
+         */
+        static void save(std::ostream& out, const std::vector<BDD>& roots);
+        static std::vector<BDD> load(std::istream& in, int n_vars);
+
 
     private:
-        BDD(DdNode* nd);
-        
-        DdNode* node;
-        static DdManager* manager;
+        BDD(BDDBackend* bk, BDDBackend::Node nd);
+
+        static BDDBackend* current_backend();
+
+        BDDBackend* backend;
+        BDDBackend::Node node;
+        static BDDBackend* current;
+        static thread_local BDDBackend* thread_current;
 };
 
 #endif
@@ -0,0 +1,131 @@
+/**
+ * Header declaring the interface between the BDD class and the package that implements the BDDs.
+ * A backend owns a set of BDD nodes and the operations on them, and the BDD class only holds a
+ * backend and a handle to one of its nodes.
+ */
+
+#ifndef BDD_BACKEND_H
+#define BDD_BACKEND_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>               // Cube enumeration
+#include <string>                   // Filenames
+#include <vector>
+
+
+
+/**
+ * A snapshot of the counters maintained by the BDD manager. Times are in milliseconds.
+ */
+struct ManagerStats
+{
+    long live_nodes;                // Nodes currently live in the manager
+    long peak_nodes;                // Peak number of nodes ever held by the manager
+    double cache_lookups;           // Lookups and hits in the computed table
+    double cache_hits;
+    int gc_count;                   // Number of garbage collections and time spent in them
+    long gc_time;
+    unsigned int reorder_count;     // Number of reorderings and time spent in them
+    long reorder_time;
+    size_t memory_in_use;           // Memory used by the manager in bytes
+};
+
+
+/**
+ * A BDD package. Nodes are opaque handles, and a node may be a complemented edge to another. The
+ * operations return nodes that are not yet referenced, which stay valid until the next operation
+ * on the backend unless they are referenced first. Operations throw a runtime_error if the package
+ * fails. A backend is used by one thread at a time, though it may use more threads internally.
+ */
+class BDDBackend
+{
+    public:
+        typedef uintptr_t Node;
+
+        virtual ~BDDBackend() {}
+
+        /**
+         * A new, empty backend of the same kind, owned by the caller. Several threads can work at
+         * once on backends of their own.
+         */
+        virtual BDDBackend* create() const = 0;
+
+        /**
+         * The constant functions, the variable with the given index, and the number of variables
+         * created so far. Asking for a variable creates all the variables up to it.
+         */
+        virtual Node constant(bool value) = 0;
+        virtual Node var(int index) = 0;
+        virtual int num_vars() = 0;
+
+        /**
+         * The conjunction of a literal for each variable i with values[i] 0 or 1, negative for 0, as
+         * in the cubes of for_each_cube. Variables with value 2, and those from the size of values
+         * on, are left out.
+         */
+        virtual Node cube(const std::vector<int>& values) = 0;
+
+        /**
+         * Nodes that are referenced are kept alive along with all the nodes below them
+         */
+        virtual void ref(Node nd) = 0;
+        virtual void deref(Node nd) = 0;
+
+        /**
+         * Logical operations. Quantification is over the variables of `cube`, a conjunction of
+         * positive literals.
+         */
+        virtual Node negate(Node f) = 0;
+        virtual Node apply_and(Node f, Node g) = 0;
+        virtual Node apply_or(Node f, Node g) = 0;
+        virtual Node apply_xor(Node f, Node g) = 0;
+        virtual Node ite(Node f, Node g, Node h) = 0;
+        virtual bool leq(Node f, Node g) = 0;
+        virtual Node exists(Node f, Node cube) = 0;
+        virtual Node forall(Node f, Node cube) = 0;
+        virtual Node and_exists(Node f, Node g, Node cube) = 0;
+        virtual Node restrict(Node f, Node care) = 0;
+
+        /**
+         * f with each variable i replaced by variable perm[i]. Variables from the size of perm on
+         * are kept.
+         */
+        virtual Node permute(Node f, const std::vector<int>& perm) = 0;
+
+        /**
+         * The structure of a node. The variable index and children are those of a regular, that is
+         * not complemented, node that is not constant, and the children do not include the
+         * complement of the edge leading to it.
+         */
+        virtual bool is_complement(Node nd) = 0;
+        virtual Node regular(Node nd) = 0;
+        virtual bool is_constant(Node nd) = 0;
+        virtual int var_index(Node nd) = 0;
+        virtual Node then_child(Node nd) = 0;
+        virtual Node else_child(Node nd) = 0;
+
+        /**
+         * Variables f depends on in increasing order, and the number of nodes in its DAG including
+         * the constant node
+         */
+        virtual std::vector<int> support(Node f) = 0;
+        virtual size_t node_count(Node f) = 0;
+
+        /**
+         * Call visit with each cube of a cover of f by disjoint cubes, taking the else branch of
+         * each node first, until it returns false. A cube gives the value of each variable by its
+         * index: 0, 1, or 2 if the cube allows both.
+         */
+        virtual void for_each_cube(Node f,
+                                   const std::function<bool(const std::vector<int>&)>& visit) = 0;
+
+        /**
+         * Write f in dot format to the named file
+         */
+        virtual void save_dot(Node f, bool draw_0_arc, const std::string& filename) = 0;
+
+        virtual ManagerStats read_stats() = 0;
+};
+
+#endif
@@ -0,0 +1,107 @@
+/**
+ * Header declaring caches that persist the BDDs built from the system section of a specification
+ * and the results of checking properties to disk, so that later runs on the same model can skip
+ * building them or checking unchanged properties.
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "headers/pred.hpp"
+
+#include <string>
+
+
+
+/**
+ * 64 bit FNV-1a hash of a string, used to name cache entries. Stable across runs and platforms.
+ */
+unsigned long long fnv1a_hash(const std::string& str);
+
+/**
+ * Incremental 128 bit hash of a sequence of strings, used to key models whose source is too large
+ * to keep as a string. Made of two independently seeded FNV-1a hashes. Each string added is
+ * terminated so that the boundaries between them affect the hash.
+ */
+class StreamHash
+{
+    public:
+        StreamHash();
+
+        void add(const char* data, size_t size);
+
+        /**
+         * The hash as 32 hex digits
+         */
+        std::string hex() const;
+
+    private:
+        unsigned long long hash_lo;
+        unsigned long long hash_hi;
+};
+
+
+
+/**
+ * A directory of binary files, each holding the initial states, transition relation and fairness
+ * constraints built for a model. Entries are identified by a key, which should be a canonical
+ * string or hash of the system section of the specification. The file for a key is named
+ * after its hash, and the full key is stored in the file to guard against collisions.
+ */
+class ModelCache
+{
+    public:
+        ModelCache(const std::string& dir);
+
+        /**
+         * Try to load the entry for `key` into `init` and `trans`, adding the fairness constraints
+         * to `trans`. Returns false, leaving both untouched, if there is no valid entry.
+         */
+        bool load(const std::string& key, Predicate& init, Transition& trans) const;
+
+        /**
+         * Write the entry for `key`, creating the directory if it does not exist. Throws a
+         * runtime_error if the file cannot be written.
+         */
+        void store(const std::string& key, const Predicate& init, const Transition& trans) const;
+
+    private:
+        std::string path(const std::string& key) const;
+
+        std::string dir;
+};
+
+
+
+/**
+ * A directory of binary files, each holding the result of checking a property. The key should
+ * identify both the model and the property, see ModelCache. The result is the verdict along with
+ * the report that was produced when checking it, which includes any witness or counterexample
+ * written as text, and the contents of the file any other trace was written to.
+ */
+class ResultCache
+{
+    public:
+        ResultCache(const std::string& dir);
+
+        /**
+         * Try to load the result for `key` into `sat`, `report` and `trace`, which is empty if no
+         * trace file was written. Returns false, leaving all three untouched, if there is no valid
+         * entry.
+         */
+        bool load(const std::string& key, bool& sat, std::string& report, std::string& trace) const;
+
+        /**
+         * Write the result for `key`, creating the directory if it does not exist. Throws a
+         * runtime_error if the file cannot be written.
+         */
+        void store(const std::string& key, bool sat, const std::string& report, 
+                   const std::string& trace) const;
+
+    private:
+        std::string path(const std::string& key) const;
+
+        std::string dir;
+};
+
+#endif
@@ -0,0 +1,70 @@
+/**
+ * Header declaring the BDD backend that wraps a CUDD manager
+ */
+
+#ifndef CUDD_BACKEND_H
+#define CUDD_BACKEND_H
+
+#include "headers/bdd_backend.hpp"
+
+/**
+ * Forward declare DdNode and DdManager here
+ */
+struct DdNode;
+struct DdManager;
+
+
+
+/**
+ * Backend over a CUDD manager of its own. Nodes are DdNode pointers, and references are CUDD's
+ * reference counts. CUDD is single threaded.
+ */
+class CuddBackend : public BDDBackend
+{
+    public:
+        CuddBackend();
+        ~CuddBackend();
+
+        BDDBackend* create() const;
+
+        Node constant(bool value);
+        Node var(int index);
+        int num_vars();
+        Node cube(const std::vector<int>& values);
+
+        void ref(Node nd);
+        void deref(Node nd);
+
+        Node negate(Node f);
+        Node apply_and(Node f, Node g);
+        Node apply_or(Node f, Node g);
+        Node apply_xor(Node f, Node g);
+        Node ite(Node f, Node g, Node h);
+        bool leq(Node f, Node g);
+        Node exists(Node f, Node cube);
+        Node forall(Node f, Node cube);
+        Node and_exists(Node f, Node g, Node cube);
+        Node restrict(Node f, Node care);
+        Node permute(Node f, const std::vector<int>& perm);
+
+        bool is_complement(Node nd);
+        Node regular(Node nd);
+        bool is_constant(Node nd);
+        int var_index(Node nd);
+        Node then_child(Node nd);
+        Node else_child(Node nd);
+
+        std::vector<int> support(Node f);
+        size_t node_count(Node f);
+        void for_each_cube(Node f, const std::function<bool(const std::vector<int>&)>& visit);
+        void save_dot(Node f, bool draw_0_arc, const std::string& filename);
+        ManagerStats read_stats();
+
+    private:
+        CuddBackend(const CuddBackend&);
+        CuddBackend& operator=(const CuddBackend&);
+
+        DdManager* manager;
+};
+
+#endif
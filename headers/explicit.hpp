@@ -0,0 +1,145 @@
+/**
+ * Header declaring an explicit representation of a transition relation for small state spaces. The
+ * states are numbered by reading the state bits as an unsigned integer, with the first bit least
+ * significant. A set of states is a packed bitset, and the relation a graph stored as compressed
+ * successor and predecessor lists. For a few tens of thousands of states, sweeping these is much
+ * faster than the BDD operations they replace.
+ */
+
+#ifndef EXPLICIT_H
+#define EXPLICIT_H
+
+#include "headers/pred.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+
+
+/**
+ * A set of states, packed 64 to a word. The bits past the last state are kept clear, so that sets
+ * can be compared word by word. The operations work a word at a time in plain loops that the
+ * compiler can vectorize.
+ */
+class StateSet
+{
+    public:
+        /**
+         * The empty set, or the set of all states if `full`, out of `size` states
+         */
+        StateSet(size_t size = 0, bool full = false);
+
+        size_t size() const { return n_states; }
+
+        bool test(size_t state) const { return (words[state / 64] >> (state % 64)) & 1; }
+        void set(size_t state) { words[state / 64] |= uint64_t(1) << (state % 64); }
+        void reset(size_t state) { words[state / 64] &= ~(uint64_t(1) << (state % 64)); }
+
+        /**
+         * Set operations, on sets of the same size
+         */
+        StateSet& operator&=(const StateSet& other);
+        StateSet& operator|=(const StateSet& other);
+        StateSet& operator^=(const StateSet& other);
+        friend StateSet operator&(StateSet setl, const StateSet& setr) { return setl &= setr; }
+        friend StateSet operator|(StateSet setl, const StateSet& setr) { return setl |= setr; }
+        friend StateSet operator^(StateSet setl, const StateSet& setr) { return setl ^= setr; }
+        StateSet operator~() const;
+
+        friend bool operator==(const StateSet& setl, const StateSet& setr);
+        friend bool operator!=(const StateSet& setl, const StateSet& setr);
+
+        /**
+         * Returns true if every state in this set is in other
+         */
+        bool subset_of(const StateSet& other) const;
+        bool intersects(const StateSet& other) const;
+        bool empty() const;
+        size_t count() const;
+
+        void swap(StateSet& other);
+
+    private:
+        size_t n_states;
+        std::vector<uint64_t> words;
+
+    friend class ExplicitGraph;
+};
+
+
+/**
+ * The graph of a transition relation over all the states of its StateSpace, with the inputs
+ * abstracted. Successors and predecessors of state s are `succs[succ_start[s]]` up to
+ * `succs[succ_start[s + 1]]`, and likewise for predecessors. The CTL operators agree with those of
+ * Transition, a state without successors satisfying AX of anything and EX of nothing.
+ */
+class ExplicitGraph
+{
+    public:
+        ExplicitGraph(const StateSpace& sp);
+
+        /**
+         * Enumerate the edges of a transition relation, given as a BDD from the u to the v
+         * variables. Returns false, leaving the graph empty, if it has more than `max_edges` edges.
+         */
+        bool build(const BDD& t_u_v, size_t max_edges);
+
+        size_t num_states() const { return succ_start.size() - 1; }
+        size_t num_edges() const { return succs.size(); }
+
+        /**
+         * Convert between predicates and sets of states
+         */
+        StateSet to_set(const Predicate& pred) const;
+        Predicate to_pred(const StateSet& set) const;
+
+        /**
+         * The states with some successor in set, with all successors in set, and the successors
+         * of the states in set
+         */
+        StateSet EX(const StateSet& set) const;
+        StateSet AX(const StateSet& set) const;
+        StateSet post(const StateSet& set) const;
+
+        /**
+         * Search forward from init one breadth first layer of newly reached states at a time,
+         * stopping at the first layer that meets target if one is given. `step` is called with the
+         * states reached before and after each new layer, and the layer. Returns true if target
+         * was met, and sets `reached` to the states reached.
+         */
+        bool search(const StateSet& init, const StateSet* target, StateSet& reached,
+                    const std::function<void(const StateSet&, const StateSet&,
+                                             const StateSet&)>& step) const;
+
+        /**
+         * A least fixpoint iterates `setr | (setl & X acc)` from the empty set, and a greatest one
+         * `setr & (setl | X acc)` from all states, where X is AX if `universal` and EX otherwise.
+         * Each iterate is found from the states that changed in the one before, by following their
+         * predecessors, so the whole fixpoint takes time linear in the size of the graph. If init
+         * is given, the fixpoint stops once an iterate decides whether it includes init, as for the
+         * CTL operators of Transition. `step` is called with the previous and new iterates after
+         * each iteration. Returns the last iterate, and sets `iterations` to their number.
+         */
+        StateSet fixpoint(const StateSet& setl, const StateSet& setr, bool universal, bool least,
+                          const StateSet* init, size_t& iterations,
+                          const std::function<void(const StateSet&, const StateSet&)>& step) const;
+
+        /**
+         * The states with a path staying in set that visits each of the fairness sets infinitely
+         * often. These are the states in set that can reach, within set, a strongly connected
+         * component of the graph restricted to set that has an edge and meets every fairness set.
+         */
+        StateSet EG_fair(const StateSet& set, const std::vector<StateSet>& fairness) const;
+
+    private:
+        const StateSpace& space;
+        std::vector<int> u_vars;
+        std::vector<uint32_t> succ_start;
+        std::vector<uint32_t> succs;
+        std::vector<uint32_t> pred_start;
+        std::vector<uint32_t> preds;
+};
+
+#endif
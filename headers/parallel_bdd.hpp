@@ -0,0 +1,159 @@
+/**
+ * Header declaring a multi-threaded BDD backend. Nodes live in one table shared by a pool of worker
+ * threads, with a lock-free unique table and a lossy operation cache that both take concurrent
+ * inserts. The recursive operations split into tasks on their top levels, which idle workers steal
+ * from the deque of the worker that made them.
+ */
+
+#ifndef PARALLEL_BDD_H
+#define PARALLEL_BDD_H
+
+#include "headers/bdd_backend.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+
+
+/**
+ * Parallel BDD package. The thread calling the operations works on them along with `threads - 1`
+ * worker threads. Nodes are stored in a table that is garbage collected, and grown if collection
+ * frees too little, between operations when the table is getting full. An operation that fills the
+ * table is abandoned and started again after collection.
+ */
+class ParallelBackend : public BDDBackend
+{
+    public:
+        /**
+         * Use the given number of threads in all, at least one, starting with room for
+         * `initial_nodes` nodes
+         */
+        ParallelBackend(unsigned threads, size_t initial_nodes = size_t(1) << 18);
+        ~ParallelBackend();
+
+        BDDBackend* create() const;
+
+        Node constant(bool value);
+        Node var(int index);
+        int num_vars();
+        Node cube(const std::vector<int>& values);
+
+        void ref(Node nd);
+        void deref(Node nd);
+
+        Node negate(Node f);
+        Node apply_and(Node f, Node g);
+        Node apply_or(Node f, Node g);
+        Node apply_xor(Node f, Node g);
+        Node ite(Node f, Node g, Node h);
+        bool leq(Node f, Node g);
+        Node exists(Node f, Node cube);
+        Node forall(Node f, Node cube);
+        Node and_exists(Node f, Node g, Node cube);
+        Node restrict(Node f, Node care);
+        Node permute(Node f, const std::vector<int>& perm);
+
+        bool is_complement(Node nd);
+        Node regular(Node nd);
+        bool is_constant(Node nd);
+        int var_index(Node nd);
+        Node then_child(Node nd);
+        Node else_child(Node nd);
+
+        std::vector<int> support(Node f);
+        size_t node_count(Node f);
+        void for_each_cube(Node f, const std::function<bool(const std::vector<int>&)>& visit);
+        void save_dot(Node f, bool draw_0_arc, const std::string& filename);
+        ManagerStats read_stats();
+
+    private:
+        ParallelBackend(const ParallelBackend&);
+        ParallelBackend& operator=(const ParallelBackend&);
+
+        /**
+         * An edge is a node index shifted left by one, with the low bit set if it is complemented.
+         * The then edge of a node is never complemented, so each function has one node.
+         */
+        typedef uint32_t Edge;
+        struct TableNode
+        {
+            uint32_t var;
+            Edge then_edge;
+            Edge else_edge;
+        };
+        struct CacheEntry;
+        struct Task;
+        struct Worker;
+
+        // Running operations and tasks
+        Edge run(const std::function<Edge(Worker&)>& op);
+        Edge dispatch(Worker& w, int op, Edge f, Edge g, Edge h, unsigned depth);
+        void fork(Worker& w, Task& task);
+        Edge join(Worker& w, Task& task);
+        bool steal(Worker& w);
+        void worker_loop(Worker& w);
+
+        // The recursive operations
+        Edge and_rec(Worker& w, Edge f, Edge g, unsigned depth);
+        Edge xor_rec(Worker& w, Edge f, Edge g, unsigned depth);
+        Edge ite_rec(Worker& w, Edge f, Edge g, Edge h, unsigned depth);
+        Edge exists_rec(Worker& w, Edge f, Edge cube, unsigned depth);
+        Edge and_exists_rec(Worker& w, Edge f, Edge g, Edge cube, unsigned depth);
+        Edge restrict_rec(Worker& w, Edge f, Edge care);
+        Edge permute_rec(Worker& w, Edge f, const std::vector<int>& perm,
+                         std::unordered_map<Edge, Edge>& memo);
+        bool leq_rec(Worker& w, Edge f, Edge g);
+
+        // Compute two subproblems of an operation, in parallel on the top levels
+        void split(Worker& w, int op, Edge f1, Edge g1, Edge h1, Edge f0, Edge g0, Edge h0,
+                   unsigned depth, Edge& r1, Edge& r0);
+
+        // Nodes
+        Edge make_node(Worker& w, uint32_t var, Edge then_edge, Edge else_edge);
+        uint32_t alloc(Worker& w);
+        uint32_t top_var(Edge e) const { return nodes[e >> 1].var; }
+        void cofactors(Edge e, uint32_t var, Edge& e1, Edge& e0) const;
+        void insert_bucket(uint32_t index);
+
+        // Cache
+        bool cache_get(Worker& w, uint64_t key0, uint64_t key1, Edge& result);
+        void cache_put(uint64_t key0, uint64_t key1, Edge result);
+        void clear_cache();
+
+        // Garbage collection
+        void collect(bool grow);
+        size_t nodes_used() const;
+
+        std::vector<TableNode> nodes;
+        std::vector<uint32_t> refs;                             // External references per node
+        std::unique_ptr<std::atomic<uint64_t>[]> buckets;       // Hash tag and node index
+        size_t bucket_mask;
+        std::unique_ptr<CacheEntry[]> cache;
+        size_t cache_mask;
+
+        std::vector<uint32_t> free_slots;                       // Indices of unused nodes
+        std::atomic<size_t> free_pos;                           // Next of them to hand out
+        size_t live_after_gc;
+        std::atomic<bool> table_full;
+        int n_vars;
+
+        std::vector<std::unique_ptr<Worker> > workers;          // The calling thread is worker 0
+        std::vector<std::thread> threads;
+        unsigned spawn_depth;
+        std::atomic<bool> stopping;
+        std::atomic<int> sleeping;
+        std::mutex sleep_mutex;
+        std::condition_variable sleep_cv;
+        unsigned wake_gen;
+
+        long peak_nodes;
+        int gc_count;
+        long gc_time;
+};
+
+#endif
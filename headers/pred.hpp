@@ -16,6 +16,12 @@
 
 #include "headers/bdd.hpp"
 
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
 #include <vector>
 
 
@@ -27,6 +33,11 @@ class StateSpace;
 class Predicate;
 class Transition;
 class State;
+class TraceWriter;
+class ExplicitGraph;
+class StateSet;
+class FixpointListener;
+struct SimWorker;
 
 
 
@@ -43,9 +54,47 @@ class StateSpace
         const int state_bits;
 
         /**
-         * Create a new context with `state_bits` bits representing a state
+         * The number of input bits. Inputs are free variables of the transition relation that are
+         * not part of the state. Each has a single BDD variable, numbered after those of the state,
+         * and they are quantified out together with the state in each image, so predicates never
+         * depend on them.
          */
-        StateSpace(int state_bits);
+        const int input_bits;
+
+        /**
+         * Create a new context with `state_bits` bits representing a state, and `input_bits` input
+         * bits for transitions
+         */
+        StateSpace(int state_bits, int input_bits = 0);
+
+        /**
+         * A named variable made up of some of the bits of the state, read as an unsigned integer
+         * with the first bit being least significant. For an enumerated variable, `values` holds
+         * the names of its values, with the i'th name standing for the integer i. For an input
+         * variable, the bits are indices of input bits instead.
+         */
+        struct Variable
+        {
+            std::vector<int> bits;
+            std::vector<std::string> values;
+            bool input;
+        };
+
+        /**
+         * Name a variable. Returns false if the name or the name of one of its values is already
+         * used by another variable or value.
+         */
+        bool add_variable(const std::string& name, const Variable& var);
+
+        /**
+         * Find a variable by name, returns NULL if there is none
+         */
+        const Variable* find_variable(const std::string& name) const;
+
+        /**
+         * Find the integer an enumerated value stands for, returns false if there is no such value
+         */
+        bool find_value(const std::string& name, unsigned long long& value) const;
 
         /**
          * Equality operators
@@ -57,7 +106,15 @@ class StateSpace
         BDD var_eq_bdd;
         BDD cube_u;
         BDD cube_v;
-
+        BDD cube_u_in;              // cube_u and all input variables
+        BDD cube_v_in;              // cube_v and all input variables
+        std::vector<int> u_vars;    // Index of the u variable of each bit
+        std::vector<int> v_vars;    // Index of the v variable of each bit
+        std::vector<int> swap_uv;   // Permutation exchanging the u and v variables of each bit
+        std::map<std::string, Variable> variables;
+        std::map<std::string, unsigned long long> values;
+
+    friend class State;
     friend class Predicate;
     friend Predicate operator&&(const Predicate& predl, const Predicate& predr);
     friend Predicate operator||(const Predicate& predl, const Predicate& predr);
@@ -77,8 +134,9 @@ class StateSpace
 
 
 /**
- * A class representing a state. Contains both assignments for each of the bits, and a BDD
- * representing the assignments
+ * A class representing a state. The bits are packed into words, and the BDD cube representing the
+ * state is only built when it is first needed, so that states that are only printed or compared
+ * make no BDDs.
  */
 class State
 {
@@ -91,9 +149,11 @@ class State
         State(const StateSpace& sp, const std::vector<bool>& assign);
 
         /**
-         * Construct a state space from a nonempty predicate
+         * Construct a state from a nonempty predicate, picking one of its states in whichever
+         * representation it is kept in. Without `rng` the pick is the same each time for the same
+         * predicate, with it the pick is random.
          */
-        State(const Predicate& pred);
+        State(const Predicate& pred, std::mt19937_64* rng = NULL);
 
         /**
          * Assignment operator, cannot be auto generated because of const StateSpace& type member.
@@ -103,7 +163,23 @@ class State
         /**
          * Deep equality check between two states, checks if the states refer to the same assignment
          */ 
-        bool operator == (const State& other);
+        bool operator == (const State& other) const;
+
+        /**
+         * The value of bit i of the state
+         */
+        bool bit(int i) const { return (words[i / 64] >> (i % 64)) & 1; }
+
+        /**
+         * The bits of the state packed into words, bit i being bit i % 64 of word i / 64. Bits
+         * past the last state bit are 0.
+         */
+        const std::vector<uint64_t>& packed() const { return words; }
+
+        /**
+         * Hash of the assignment, for keeping states in unordered containers
+         */
+        size_t hash() const;
 
         /**
          * Returns the state as a string of boolean values denoted by 0 or 1, one for each variable.
@@ -113,9 +189,14 @@ class State
 
 
     private: 
-        std::vector<bool> assign;
-        BDD bdd_u;
-        BDD bdd_v;
+        /**
+         * The cube of the state over the u variables, built on first use
+         */
+        const BDD& cube_u() const;
+
+        std::vector<uint64_t> words;    // Bit i is bit i % 64 of words[i / 64]
+        mutable BDD bdd_u;              // Valid if have_bdd_u
+        mutable bool have_bdd_u;
 
     friend class Transition;
     friend class Predicate;
@@ -123,22 +204,56 @@ class State
 
 
 /**
- * Represents a finite or lasso shaped path
+ * Hash of states for unordered containers
+ */
+namespace std
+{
+    template<> struct hash<State>
+    {
+        size_t operator()(const State& st) const { return st.hash(); }
+    };
+}
+
+
+/**
+ * Interface for objects that receive the finite or lasso shaped paths made by the witness and
+ * counterexample generators, one state at a time as the states are found, so that no path has to
+ * be held in memory. A path is bracketed by calls to `begin`, which is told if the path is finite,
+ * and `end`. For a lasso shaped path, the states from the one numbered `lasso_point`, counting
+ * from 0, on form the loop, and the rest the head. Finite paths end with a `lasso_point` of 0.
+ */
+class TraceWriter
+{
+    public:
+        virtual ~TraceWriter() {}
+        virtual void begin(const StateSpace& space, bool finite) = 0;
+        virtual void state(const State& st) = 0;
+        virtual void end(size_t lasso_point) = 0;
+};
+
+
+/**
+ * Interface for objects that want to observe the fixpoint computations done by a Transition. Each
+ * fixpoint computation is bracketed by calls to `on_begin` and `on_end` with the name of the
+ * operator. Each time the loop produces a new iterate, `on_iteration` is called with the number of
+ * the iteration starting from 1, and the previous and new iterates.
  */
-struct Path
+class FixpointListener
 {
-    bool is_finite;
-    /**
-     * If the path is finite, it is given by states. If it is infinite, then the part of states upto
-     * (not including) the index given by lasso_point is the head, and the rest represents the loop
-     */
-    std::vector<State> states;
-    size_t lasso_point;
-
-    /**
-     * Prints path out to stdout.
-     */
-    void print() const;
+    public:
+        virtual ~FixpointListener() {}
+
+        /**
+         * Asked before each call to `on_iteration`. If it returns false, the call may be given
+         * empty predicates in place of the iterates, so that the explicit engine does not convert
+         * its sets of states for listeners that do not look at them.
+         */
+        virtual bool wants_predicates() { return true; }
+
+        virtual void on_begin(const char*) {}
+        virtual void on_iteration(const char* op, size_t iteration, const Predicate& prev, 
+                                  const Predicate& next) = 0;
+        virtual void on_end(const char*, size_t) {}
 };
 
 
@@ -171,6 +286,11 @@ class Transition
          */
         Transition(const StateSpace& sp, bool bconst);
 
+        /**
+         * Make a transition that holds exactly when the input bit `input_idx` is set
+         */
+        static Transition input(const StateSpace& sp, int input_idx);
+
         /** 
          * Copy and assignment
          */
@@ -200,26 +320,121 @@ class Transition
          */
         Predicate next(const State& state) const;
 
+        /**
+         * Get the predicate representing the set of states reachable in a single step from some
+         * state satisfying pred
+         */
+        Predicate post(const Predicate& pred) const;
+
+        /**
+         * Search forward from init for a state satisfying target, one breadth first layer of newly
+         * reached states at a time, stopping at the first layer that has one. On success `depth`
+         * is set to the number of steps to the nearest such state. Returns false if no reachable
+         * state satisfies target.
+         */
+        bool reach(const Predicate& init, const Predicate& target, size_t& depth) const;
+
+        /**
+         * Compute all states reachable from init, one breadth first layer of newly reached states
+         * at a time. `layers` is set to the layers, starting with init, so a state in layer i is at
+         * least i steps from init.
+         */
+        void reach_layers(const Predicate& init, std::vector<Predicate>& layers) const;
+
+        /**
+         * Compute all states reachable from init, one breadth first layer at a time
+         */
+        Predicate reachable(const Predicate& init) const;
+
         /**
          * CTL quantifiers. Based on given transition, convert predicates to predicates representing
-         * quantified versions.
+         * quantified versions. If `init` is given, the fixpoint stops as soon as it is known
+         * whether the result includes all of init: the least fixpoints of EF, EU, AF and AU stop
+         * once an iterate includes init, and the greatest fixpoints of EG, ER, AG and AR once an
+         * iterate misses some of init. The result then only agrees with the full fixpoint on
+         * whether it includes init, and is an iterate of it that can still guide witnesses.
          */
         Predicate EX(const Predicate& pred) const;
-        Predicate EF(const Predicate& pred) const;
-        Predicate EG(const Predicate& pred) const;
-        Predicate EU(const Predicate& predl, const Predicate& predr) const;
-        Predicate ER(const Predicate& predl, const Predicate& predr) const;
+        Predicate EF(const Predicate& pred, const Predicate* init = NULL) const;
+        Predicate EG(const Predicate& pred, const Predicate* init = NULL) const;
+        Predicate EU(const Predicate& predl, const Predicate& predr,
+                     const Predicate* init = NULL) const;
+        Predicate ER(const Predicate& predl, const Predicate& predr,
+                     const Predicate* init = NULL) const;
         Predicate AX(const Predicate& pred) const;
-        Predicate AF(const Predicate& pred) const;
-        Predicate AG(const Predicate& pred) const;
-        Predicate AU(const Predicate& predl, const Predicate& predr) const;
-        Predicate AR(const Predicate& predl, const Predicate& predr) const;
+        Predicate AF(const Predicate& pred, const Predicate* init = NULL) const;
+        Predicate AG(const Predicate& pred, const Predicate* init = NULL) const;
+        Predicate AU(const Predicate& predl, const Predicate& predr,
+                     const Predicate* init = NULL) const;
+        Predicate AR(const Predicate& predl, const Predicate& predr,
+                     const Predicate* init = NULL) const;
 
         /** 
          * Add fairness constraints
          */
         void add_fairness(const Predicate& pred);
 
+        /**
+         * Spread the fairness constraints over up to `threads` threads when computing EG_fair,
+         * each with a BDD backend of its own that the operands are transferred to. The default of
+         * one thread computes them in turn in the current backend.
+         */
+        void set_fair_threads(unsigned threads);
+
+        /**
+         * Keep only the representation of the transition from u to v. Images in the other
+         * direction then rename their predicate to the other variables instead, which takes less
+         * memory but more time for each image. By default the representation from v to u is
+         * derived once, the first time it is needed.
+         */
+        void keep_one_relation(bool one);
+
+        /**
+         * Pick the states of witnesses and counterexamples at random, from a generator seeded with
+         * `seed`. By default the same states are picked each time for the same predicates.
+         */
+        void set_witness_seed(uint64_t seed);
+
+        /**
+         * Reduce the transition to the cone of influence of the given state bits, which is the
+         * smallest set of bits containing them and the support of the fairness constraints such
+         * that the next values of the bits in it depend only on bits in it and the inputs. The bits
+         * outside the cone are abstracted away in `reduced`, and on predicates over the cone its
+         * CTL operators agree with those of this transition. `bits` is extended to the cone. The
+         * fairness constraints, their number of threads and listeners are copied to `reduced`.
+         */
+        void cone_of_influence(std::vector<int>& bits, Transition& reduced) const;
+
+        /**
+         * Compute the images, CTL operators and fair states of this transition over an explicit
+         * graph of its states, enumerated once here, instead of with BDDs. The results are the
+         * same predicates, and fixpoints go through the same iterates. Returns false and keeps
+         * using BDDs if the graph would have more than `max_edges` edges. The graph is not copied,
+         * and is dropped when the transition is assigned to.
+         */
+        bool use_explicit(size_t max_edges);
+        bool is_explicit() const { return (bool) graph; }
+
+        /**
+         * Register or unregister a listener to be notified of the iterations of fixpoint
+         * computations. The listener is not owned by the Transition.
+         */
+        void add_listener(FixpointListener* listener);
+        void remove_listener(FixpointListener* listener);
+
+        /**
+         * Number of BDD nodes in each of the two representations of the transition. The one from v
+         * to u is 0 until it is derived.
+         */
+        size_t size_u_v() const;
+        size_t size_v_u() const;
+
+        /**
+         * The same relation over sp, which must have the bits of this one's space, with its BDDs
+         * transferred to the current backend. Fairness constraints and listeners are not copied.
+         */
+        Transition transfer(const StateSpace& sp) const;
+
         /**
          * Fair versions of above CTL operators
          */
@@ -236,31 +451,98 @@ class Transition
 
         /**
          * Genearating witnesses and cex. They take as input the formulae and subformulae for each top
-         * level quantifier, as well as the set of initial states.
-         */
-        Path gen_witness_EF(const Predicate& init, const Predicate& EFf, const Predicate& f) const;
-        Path gen_witness_EG(const Predicate& init, const Predicate& EGf, const Predicate& f) const;
-        Path gen_witness_EU(const Predicate& init, const Predicate& EfUg, const Predicate& f, 
-                            const Predicate& g) const;
-        Path gen_witness_ER(const Predicate& init, const Predicate& EfRg, const Predicate& f, 
-                            const Predicate& g) const;
-        Path gen_cex_AF(const Predicate& init, const Predicate& AFf, const Predicate& f) const;
-        Path gen_cex_AG(const Predicate& init, const Predicate& AGf, const Predicate& f) const;
-        Path gen_cex_AU(const Predicate& init, const Predicate& AfUg, const Predicate& f, 
-                            const Predicate& g) const;
-        Path gen_cex_AR(const Predicate& init, const Predicate& AfRg, const Predicate& f, 
-                            const Predicate& g) const;
+         * level quantifier, as well as the set of initial states, and write the path to `trace` as
+         * it is generated.
+         */
+        void gen_witness_EF(const Predicate& init, const Predicate& EFf, const Predicate& f,
+                            TraceWriter& trace) const;
+        void gen_witness_EG(const Predicate& init, const Predicate& EGf, const Predicate& f,
+                            TraceWriter& trace) const;
+        void gen_witness_EU(const Predicate& init, const Predicate& EfUg, const Predicate& f, 
+                            const Predicate& g, TraceWriter& trace) const;
+        void gen_witness_ER(const Predicate& init, const Predicate& EfRg, const Predicate& f, 
+                            const Predicate& g, TraceWriter& trace) const;
+        void gen_witness_reach(const Predicate& init, const Predicate& target, size_t depth,
+                               TraceWriter& trace) const;
+        void gen_cex_AF(const Predicate& init, const Predicate& AFf, const Predicate& f,
+                        TraceWriter& trace) const;
+        void gen_cex_AG(const Predicate& init, const Predicate& AGf, const Predicate& f,
+                        TraceWriter& trace) const;
+        void gen_cex_AU(const Predicate& init, const Predicate& AfUg, const Predicate& f, 
+                        const Predicate& g, TraceWriter& trace) const;
+        void gen_cex_AR(const Predicate& init, const Predicate& AfRg, const Predicate& f, 
+                        const Predicate& g, TraceWriter& trace) const;
 
         
     private:
-        Transition(const StateSpace& sp, const BDD& tuv, const BDD& tvu);
+        Transition(const StateSpace& sp, const BDD& tuv);
+
+        /**
+         * The representation from v to u, derived from the one from u to v when first needed
+         */
+        const BDD& reverse() const;
+
+        /**
+         * One step of the fair EG fixpoint, computes the states satisfying pred from which each
+         * fairness constraint can be reached within acc
+         */
+        Predicate EG_fair_step(const Predicate& pred, const Predicate& acc) const;
+
+        /**
+         * The fair EG fixpoint with the steps for each fairness constraint computed on worker
+         * threads. Their results are intersected in the current backend.
+         */
+        Predicate EG_fair_parallel(const Predicate& pred) const;
+
+        /**
+         * Returns true if init is given and the iterate of a least or greatest fixpoint already
+         * decides whether the fixpoint includes all of init
+         */
+        bool decided(const Predicate* init, const Predicate& acc, bool least) const;
+
+        /**
+         * Fixpoints over the explicit graph. A least fixpoint iterates `predr || (predl && X acc)`
+         * from false and a greatest one `predr && (predl || X acc)` from true, where X is AX if
+         * `universal` and EX otherwise. `init` stops them early as for the CTL operators.
+         */
+        Predicate explicit_fixpoint(const char* op, const Predicate& predl, const Predicate& predr,
+                                    bool universal, bool least, const Predicate* init) const;
+
+        /**
+         * Breadth first search over the explicit graph for reach, reach_layers and reachable.
+         * Returns whether target was met, and sets reached, the depth, and the layers if given.
+         */
+        bool explicit_search(const Predicate& init, const Predicate* target, Predicate& reached,
+                             size_t& depth, std::vector<Predicate>* layers) const;
+
+        /**
+         * Notify all listeners of the start of a fixpoint, a new iterate, or the end of a fixpoint
+         */
+        void notify_begin(const char* op) const;
+        void notify(const char* op, size_t iteration, const Predicate& prev, 
+                    const Predicate& next) const;
+        void notify_end(const char* op, size_t iterations) const;
+
+        /**
+         * Notify all listeners of a new iterate of the explicit engine, converting the iterates to
+         * predicates only if some listener wants them
+         */
+        void notify_sets(const char* op, size_t iteration, const StateSet& prev, 
+                         const StateSet& next) const;
         
-        BDD t_u_v;          // Repr for var -> var2
-        BDD t_v_u;          // Repr for var2 -> var
+        BDD t_u_v;              // Repr for var -> var2
+        mutable BDD t_v_u;      // Repr for var2 -> var, if have_v_u
+        mutable bool have_v_u;
+        bool one_relation;      // Never derive t_v_u
 
         std::vector<Predicate> fairness;
+        unsigned fair_threads;
+        mutable std::unique_ptr<std::mt19937_64> witness_rng;  // Set if witnesses are random
+        std::vector<FixpointListener*> listeners;
+        std::shared_ptr<const ExplicitGraph> graph;     // Set if operators are computed explicitly
 
     friend class Predicate;
+    friend class ModelCache;
 };
 
 
@@ -327,12 +609,46 @@ class Predicate
          */
         BDD get_bdd() const;
 
+        /**
+         * Check if every state satisfying this predicate satisfies the other, without building
+         * their combination
+         */
+        bool implies(const Predicate& other) const;
+
+        /**
+         * A predicate that agrees with this one on the states satisfying care, and is usually
+         * represented by fewer nodes. On other states its value is arbitrary.
+         */
+        Predicate restrict(const Predicate& care) const;
+
         /**
          * Get weather the predicate represents the constant true predicate or false predicate
          */
         bool is_true() const;
         bool is_false() const;
 
+        /**
+         * Number of BDD nodes used to represent the predicate
+         */
+        size_t node_count() const;
+
+        /**
+         * Number of states satisfying the predicate, in decimal. It is counted exactly, over the
+         * state variables of whichever representation the predicate is kept in.
+         */
+        std::string count_states() const;
+
+        /**
+         * Indices of the state bits the predicate depends on, in increasing order
+         */
+        std::vector<int> support() const;
+
+        /**
+         * The same predicate over sp, which must have the bits of this one's space, with its BDD
+         * transferred to the current backend
+         */
+        Predicate transfer(const StateSpace& sp) const;
+
  
 
     private:
@@ -343,7 +659,39 @@ class Predicate
         BDD p_v;                    // Representation as fn of var2
         bool is_p_u_repr;           // Is the correct representation on var u
 
+    friend class State;
     friend class Transition;
+    friend class ModelCache;
+    friend class ExplicitGraph;
+};
+
+
+/**
+ * Looks for states satisfying a target on random runs of a transition from its initial states,
+ * spread over threads that each have a BDD backend of its own. The copies of the transition and
+ * initial states the threads run on are made once, when the simulator is created, so that the
+ * targets of many properties can be looked for on the same model.
+ */
+class Simulator
+{
+    public:
+        Simulator(const Transition& trans, const Predicate& init, unsigned threads);
+        ~Simulator();
+
+        /**
+         * Look for a state satisfying target on up to `traces` random runs of at most `depth` steps.
+         * A run starts from a random initial state and steps to a random successor until it hits
+         * target, reaches the depth or has no successor. Run i is seeded from `seed` and i, and the
+         * run with the least i that hits target is the one returned in `path`, so the result does
+         * not depend on the number of threads. Returns false if no run hits target.
+         */
+        bool run(const Predicate& target, size_t traces, size_t depth, uint64_t seed,
+                 std::vector<State>& path);
+
+    private:
+        const StateSpace& space;
+        bool no_init;
+        std::vector<std::unique_ptr<SimWorker> > workers;
 };
 
 #endif
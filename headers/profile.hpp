@@ -0,0 +1,110 @@
+/**
+ * Header declaring a profiler that attributes the time, fixpoint iterations and result sizes of
+ * model checking to the individual CTL subformulae of each property.
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "headers/pred.hpp"
+
+#include <chrono>                   // Timestamps
+#include <ostream>                  // Output
+#include <string>
+#include <vector>
+
+
+
+/**
+ * Records, for each CTL node evaluated, its source location, the time spent evaluating it with and
+ * without its children, the number of fixpoint iterations it ran, and the BDD size of its result
+ * and the number of states satisfying it.
+ * Fixpoint iterations are attributed to the innermost node being evaluated, which it learns of by
+ * listening to the Transition. Optionally, it also records a timeline of nodes, fixpoints and
+ * their iterations that can be written out in the Chrome trace event format.
+ */
+class Profiler : public FixpointListener
+{
+    public:
+        /**
+         * Create a profiler listening to fixpoints of `trans`. If `trace` is set, a timeline of
+         * events is recorded for `write_trace`.
+         */
+        Profiler(Transition& trans, bool trace);
+        ~Profiler();
+
+        /**
+         * Mark the start of checking the property with given index, which is used to tag the
+         * records for nodes evaluated after this.
+         */
+        void begin_property(size_t index);
+
+        /**
+         * Mark the start and end of the evaluation of a CTL node, with `op` being the name of the
+         * operator at the root of the node and `location` its span in the source. Nodes without a
+         * location are reported with location `?`. Calls must be properly nested.
+         */
+        void begin_node(const std::string& op, const std::string& location);
+        void end_node(const Predicate& result);
+
+        bool wants_predicates() { return trace; }     // Only the trace records sizes
+        void on_begin(const char* op);
+        void on_iteration(const char* op, size_t iteration, const Predicate& prev, 
+                          const Predicate& next);
+        void on_end(const char* op, size_t iterations);
+
+        /**
+         * Print a table of all nodes evaluated so far, sorted by decreasing self time
+         */
+        void print_hotspots(std::ostream& out) const;
+
+        /**
+         * Write out the recorded timeline as a Chrome trace event JSON document
+         */
+        void write_trace(std::ostream& out) const;
+
+    private:
+        /**
+         * Record for a single evaluated node. Times are in microseconds.
+         */
+        struct NodeRecord
+        {
+            size_t property;
+            std::string op;
+            std::string location;
+            double total_time;
+            double child_time;
+            size_t iterations;
+            size_t result_nodes;
+            std::string result_states;  // In decimal
+        };
+
+        /**
+         * A complete event in the timeline. Times are in microseconds from the creation of the
+         * profiler.
+         */
+        struct TraceEvent
+        {
+            std::string name;
+            std::string category;
+            double start;
+            double duration;
+            std::string args;       // JSON object with extra info
+        };
+
+        double now() const;
+
+        Transition& trans;
+        bool trace;
+        std::chrono::steady_clock::time_point origin;
+        size_t property;
+
+        std::vector<NodeRecord> records;
+        std::vector<size_t> node_stack;         // Indices of records of nodes being evaluated
+        std::vector<double> node_starts;        // Start times of nodes being evaluated
+        std::vector<double> fixpoint_starts;    // Start times of fixpoints being computed
+        std::vector<double> iteration_starts;   // Start times of current iteration of each
+        std::vector<TraceEvent> events;
+};
+
+#endif
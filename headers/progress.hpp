@@ -0,0 +1,87 @@
+/**
+ * Header declaring a class that reports the progress of long running fixpoint computations on
+ * stderr, periodically and on receiving a signal.
+ */
+
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#include "headers/pred.hpp"
+
+#include <atomic>                   // Requesting sizes from the fixpoint thread
+#include <chrono>                   // Timing reports
+#include <condition_variable>       // Waking up the reporting thread
+#include <mutex>                    // Guarding the published state
+#include <ostream>
+#include <string>
+#include <thread>                   // Reporting thread
+#include <vector>
+
+
+
+/**
+ * Listens to the fixpoints of a Transition and publishes the current property, the stack of
+ * fixpoint operators being computed with their current iterations, the sizes of the current
+ * iterate and of the frontier (the states that changed in the last iteration), and the live nodes
+ * and memory of the manager. A background thread writes this as a single line to `out` every
+ * `interval` seconds, and whenever the process receives SIGUSR1. An interval of 0 disables the
+ * periodic reports. The sizes take a pass over the iterates, so they are only computed when a
+ * report is due, at the end of the iteration running at that time, which then writes the report.
+ */
+class ProgressReporter : public FixpointListener
+{
+    public:
+        ProgressReporter(Transition& trans, std::ostream& out, double interval);
+        ~ProgressReporter();
+
+        /**
+         * Mark the start of checking the property with given index
+         */
+        void begin_property(size_t index);
+
+        bool wants_predicates();
+        void on_begin(const char* op);
+        void on_iteration(const char* op, size_t iteration, const Predicate& prev, 
+                          const Predicate& next);
+        void on_end(const char* op, size_t iterations);
+
+    private:
+        /**
+         * Loop run by the reporting thread
+         */
+        void run();
+
+        /**
+         * Write out the currently published state. Must be called with `mtx` held.
+         */
+        void report();
+
+        /**
+         * Write out a report now if no fixpoint is running, else ask the fixpoint thread for one
+         * at the end of its current iteration. Must be called with `mtx` held.
+         */
+        void request();
+
+        Transition& trans;
+        std::ostream& out;
+        std::chrono::duration<double> interval;
+        std::chrono::steady_clock::time_point start;
+
+        // Published state, guarded by mtx
+        std::mutex mtx;
+        size_t property;
+        std::vector<std::string> ops;           // Fixpoints being computed, innermost last
+        std::vector<size_t> iterations;         // Current iteration of each of them
+        size_t current_nodes;
+        size_t frontier_nodes;
+        long live_nodes;
+        size_t memory_in_use;
+
+        std::atomic<bool> sizes_due;            // A report waits for the sizes of the iterates
+        bool sizes_wanted;                      // sizes_due as last told to the fixpoint thread
+        std::condition_variable wakeup;
+        bool stop;
+        std::thread reporter;
+};
+
+#endif
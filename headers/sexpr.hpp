@@ -0,0 +1,166 @@
+/**
+ * Header declaring a reader for the s-expressions used in specification files. The file is memory
+ * mapped and tokenized in place, so no part of it is copied. Large sections like the transition
+ * relation can be consumed directly from the Lexer as they are read, while small sections like
+ * properties can be parsed into a tree of SExpr nodes that refer back into the file.
+ */
+
+#ifndef SEXPR_H
+#define SEXPR_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+
+/**
+ * A view of a range of characters owned by someone else, usually a MappedFile
+ */
+struct StrRef
+{
+    const char* data;
+    size_t size;
+
+    StrRef() : data(NULL), size(0) {}
+    StrRef(const char* d, size_t s) : data(d), size(s) {}
+
+    /**
+     * Copy out the characters into a string
+     */
+    std::string str() const { return std::string(data, size); }
+
+    friend bool operator==(const StrRef& ref, const char* str);
+    friend bool operator!=(const StrRef& ref, const char* str);
+    friend bool operator==(const StrRef& refl, const StrRef& refr);
+    friend bool operator< (const StrRef& refl, const StrRef& refr);
+    friend std::ostream& operator<<(std::ostream& out, const StrRef& ref);
+};
+
+
+
+/**
+ * A read only memory mapping of a whole file. Throws a runtime_error if the file cannot be opened
+ * or mapped.
+ */
+class MappedFile
+{
+    public:
+        MappedFile(const std::string& path);
+        ~MappedFile();
+
+        const char* data() const { return addr; }
+        size_t size() const { return len; }
+
+    private:
+        MappedFile(const MappedFile&);
+        MappedFile& operator=(const MappedFile&);
+
+        const char* addr;
+        size_t len;
+};
+
+
+
+/**
+ * A token of an s-expression. Atoms are maximal runs of characters other than whitespace,
+ * parentheses and `;`. The offset is that of the first character of the token in the source.
+ */
+struct Token
+{
+    enum Kind { OPEN, CLOSE, ATOM, END };
+
+    Kind kind;
+    StrRef text;
+    size_t offset;
+};
+
+
+
+/**
+ * Splits a buffer into tokens in a single pass, skipping whitespace and comments, which run from a
+ * `;` to the end of the line. Tokens refer directly into the buffer.
+ */
+class Lexer
+{
+    public:
+        Lexer(const char* data, size_t size);
+
+        /**
+         * Consume and return the next token, or look at it without consuming it
+         */
+        Token next();
+        Token peek();
+
+        /**
+         * Consume the next token, throwing a runtime_error with `msg` if it is not of given kind
+         */
+        Token expect(Token::Kind kind, const std::string& msg);
+
+        /**
+         * Consume one complete expression, an atom or a balanced list, without interpreting it.
+         * Returns the offset one past its end.
+         */
+        size_t skip();
+
+        /**
+         * Current offset into the buffer, and going back to an earlier one
+         */
+        size_t position() const { return pos; }
+        void seek(size_t offset) { pos = offset; }
+
+        /**
+         * Returns `line:col` for an offset into the buffer. The first call indexes the lines of the
+         * whole buffer.
+         */
+        std::string location(size_t offset) const;
+
+        const char* source() const { return data; }
+
+    private:
+        void skip_space();
+
+        const char* data;
+        size_t size;
+        size_t pos;
+        mutable std::vector<size_t> line_starts;
+};
+
+
+
+/**
+ * A parsed s-expression, either an atom or a list of s-expressions. Atoms refer into the source
+ * instead of holding a copy.
+ */
+struct SExpr
+{
+    bool atom;
+    StrRef text;                    // Text of the atom, empty for lists
+    std::vector<SExpr> children;    // Elements of the list, empty for atoms
+    size_t begin;                   // Offsets of the first and one past the last character
+    size_t end;
+    std::string location;           // Span in the source as `line:col-line:col`
+
+    bool is_atom() const { return atom; }
+    size_t size() const { return children.size(); }
+    const SExpr& operator[](size_t i) const { return children[i]; }
+
+    /**
+     * The atom at the head of a list, or an empty string if there is none
+     */
+    StrRef head() const;
+
+    /**
+     * Render the expression with single spaces between elements
+     */
+    std::string to_string() const;
+};
+
+/**
+ * Parse a single complete expression from the lexer. Throws a runtime_error giving the location if
+ * the input is malformed.
+ */
+SExpr parse_sexpr(Lexer& lex);
+
+#endif
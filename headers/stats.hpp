@@ -0,0 +1,72 @@
+/**
+ * Header declaring a class that collects performance statistics for each property that is model
+ * checked, and writes them out as JSON.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include "headers/bdd.hpp"
+#include "headers/pred.hpp"
+
+#include <chrono>                   // Wall time
+#include <map>                      // Iteration counts per operator
+#include <ostream>                  // Output
+#include <string>
+
+
+
+/**
+ * Collects statistics over the checking of a single property at a time. It listens to the fixpoint
+ * iterations of a Transition to count iterations per CTL operator, and reads the counters of the
+ * BDD manager, including its peak number of nodes, at the start and end of each property. The sizes
+ * of the initial and reachable states of the model are measured once, and written with each
+ * property.
+ */
+class StatsCollector : public FixpointListener
+{
+    public:
+        /**
+         * Create a collector for properties checked over the given transition from the initial
+         * states `init`, writing one JSON object per line to `out`. The states reachable from
+         * `init` are computed here, before the collector registers itself as a listener on `trans`.
+         */
+        StatsCollector(Transition& trans, const Predicate& init, std::ostream& out);
+        ~StatsCollector();
+
+        /**
+         * Mark the start and end of checking a property. `end_property` writes out the statistics
+         * collected since the matching `begin_property`.
+         */
+        void begin_property();
+        void end_property(size_t index, bool sat);
+
+        /**
+         * Record that the current property is checked over `checked`, reduced to a cone of
+         * influence of `cone_bits` state bits. Its size is reported instead of that of the full
+         * transition.
+         */
+        void set_cone(const Transition& checked, int cone_bits);
+
+        bool wants_predicates() { return false; }
+        void on_iteration(const char* op, size_t iteration, const Predicate& prev, 
+                          const Predicate& next);
+
+    private:
+        Transition& trans;
+        std::ostream& out;
+
+        const Transition* checked;
+        int cone_bits;
+
+        std::string init_states;        // Counts of states are in decimal
+        size_t init_nodes;
+        std::string reachable_states;
+        size_t reachable_nodes;
+
+        std::chrono::steady_clock::time_point start_time;
+        ManagerStats start_stats;
+        std::map<std::string, size_t> iterations;
+};
+
+#endif
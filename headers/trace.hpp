@@ -0,0 +1,150 @@
+/**
+ * Header declaring the writers of witness and counterexample paths. Each writes the states of a
+ * path as the generators find them into a buffer that is written out in large blocks, in one of
+ * several formats: a table of the bits of each state, a VCD waveform, JSON, or a compact binary
+ * format that records only the bits changed by each step.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "headers/pred.hpp"
+
+#include <cstdint>
+#include <ostream>                  // Output
+#include <string>                   // Buffer
+#include <vector>
+
+
+
+/**
+ * Base of the writers, keeping the text written so far in a buffer that is written to the stream
+ * when it grows past a limit, and when the path ends. It also keeps the previous state of the path
+ * for the formats that only write what changed.
+ */
+class BufferedTraceWriter : public TraceWriter
+{
+    public:
+        BufferedTraceWriter(std::ostream& out);
+        ~BufferedTraceWriter();
+
+        /**
+         * Whether any path has been written
+         */
+        bool written() const { return n_paths > 0; }
+
+        void begin(const StateSpace& space, bool finite);
+        void end(size_t lasso_point);
+
+    protected:
+        /**
+         * Write out the buffer if it is large enough, or if `force` is set
+         */
+        void flush(bool force = false);
+
+        /**
+         * The indices of the bits that st has different from the previous state, in increasing
+         * order. st becomes the previous state.
+         */
+        const std::vector<int>& changed_bits(const State& st);
+
+        std::ostream& out;
+        std::string buf;
+        int state_bits;
+        bool finite;
+        size_t n_states;                // States in the current path
+        size_t n_paths;
+
+    private:
+        std::vector<uint64_t> prev;     // Packed bits of the previous state, all 0 at first
+        std::vector<int> changes;
+};
+
+
+/**
+ * Writes a path as a table with a row of 0s and 1s for each state, headed by the names of the bits
+ * and with a `Begin Loop` line before the loop of a lasso. As the loop is only known at the end,
+ * a lasso is kept in the buffer until then.
+ */
+class TextTraceWriter : public BufferedTraceWriter
+{
+    public:
+        TextTraceWriter(std::ostream& out) : BufferedTraceWriter(out) {}
+
+        void begin(const StateSpace& space, bool finite);
+        void state(const State& st);
+        void end(size_t lasso_point);
+
+    private:
+        std::vector<size_t> line_starts;    // Offsets of the rows of a lasso in the buffer
+};
+
+
+/**
+ * Writes a path as a VCD waveform with a one bit wire for each state bit, named as in the table,
+ * and one time step per state. Each step only lists the wires that changed. The loop of a lasso is
+ * marked by a comment at the end giving the time it starts at.
+ */
+class VcdTraceWriter : public BufferedTraceWriter
+{
+    public:
+        VcdTraceWriter(std::ostream& out) : BufferedTraceWriter(out) {}
+
+        void begin(const StateSpace& space, bool finite);
+        void state(const State& st);
+        void end(size_t lasso_point);
+
+    private:
+        std::vector<std::string> ids;       // Identifier of the wire of each bit
+};
+
+
+/**
+ * Writes a path as a JSON object with the fields `finite`, `state_bits`, `states`, an array with a
+ * string of 0s and 1s for each state, and for a lasso `lasso_point`.
+ */
+class JsonTraceWriter : public BufferedTraceWriter
+{
+    public:
+        JsonTraceWriter(std::ostream& out) : BufferedTraceWriter(out) {}
+
+        void begin(const StateSpace& space, bool finite);
+        void state(const State& st);
+        void end(size_t lasso_point);
+};
+
+
+/**
+ * Writes a path in a binary format made of unsigned LEB128 varints. It starts with the 8 bytes
+ * `CTLTRACE`, then the format version (1), the number of state bits and 1 if the path is finite or
+ * 0 if not. Each state follows as the number of bits it changes plus one, and the indices of
+ * those bits in increasing order, each given as its distance from the one before less one, the
+ * first being the index itself. The first state is compared against all bits 0. A 0 in place of a
+ * state ends the path, followed by the lasso point.
+ */
+class BinaryTraceWriter : public BufferedTraceWriter
+{
+    public:
+        BinaryTraceWriter(std::ostream& out) : BufferedTraceWriter(out) {}
+
+        void begin(const StateSpace& space, bool finite);
+        void state(const State& st);
+        void end(size_t lasso_point);
+
+    private:
+        void put_varint(uint64_t value);
+};
+
+
+/**
+ * Make a writer for the format with the given name, one of `text`, `vcd`, `json` and `binary`.
+ * Returns NULL if there is no such format.
+ */
+BufferedTraceWriter* make_trace_writer(const std::string& format, std::ostream& out);
+
+/**
+ * The usual file extension of the format with the given name
+ */
+std::string trace_extension(const std::string& format);
+
+#endif
@@ -0,0 +1,138 @@
+/**
+ * Header defining operations on words, which are vectors of bits representing unsigned integers,
+ * with the first bit least significant. A bit is either a Predicate or a Transition, so the same
+ * operations build arithmetic over the state in predicates and over the pair of states in
+ * transitions. Each operation uses the usual BDD construction: ripple carry for addition, a chain
+ * from the least significant bit for comparison, and a conjunction of bitwise xnors for equality.
+ * These stay linear in the width as long as the bits of the operands are interleaved in the
+ * variable order.
+ */
+
+#ifndef WORD_H
+#define WORD_H
+
+#include "headers/pred.hpp"
+
+#include <algorithm>
+#include <vector>
+
+
+
+typedef std::vector<Predicate> PredWord;
+typedef std::vector<Transition> TransWord;
+
+
+
+/**
+ * The word for the variable made of the given bits of the state, or of the state the transition
+ * goes from or to
+ */
+inline PredWord word_var(const StateSpace& sp, const std::vector<int>& bits)
+{
+    PredWord ret;
+    for(size_t i = 0; i < bits.size(); ++i) ret.push_back(Predicate(sp, bits[i]));
+    return ret;
+}
+
+inline TransWord word_var(const StateSpace& sp, const std::vector<int>& bits, bool to_var)
+{
+    TransWord ret;
+    for(size_t i = 0; i < bits.size(); ++i) ret.push_back(Transition(sp, bits[i], to_var));
+    return ret;
+}
+
+/**
+ * The word for an input variable made of the given input bits
+ */
+inline TransWord word_input(const StateSpace& sp, const std::vector<int>& bits)
+{
+    TransWord ret;
+    for(size_t i = 0; i < bits.size(); ++i) ret.push_back(Transition::input(sp, bits[i]));
+    return ret;
+}
+
+/**
+ * The word for a constant, with as many bits as needed to represent it
+ */
+template<class B> std::vector<B> word_const(const StateSpace& sp, unsigned long long value)
+{
+    std::vector<B> ret;
+    do
+    {
+        ret.push_back(B(sp, (value & 1) != 0));
+        value >>= 1;
+    }
+    while(value);
+    return ret;
+}
+
+/**
+ * Pad a word with zeros to given width
+ */
+template<class B> void word_extend(std::vector<B>& word, size_t width)
+{
+    while(word.size() < width) word.push_back(B(word[0].space, false));
+}
+
+/**
+ * Sum of two words, as wide as the wider of them, wrapping around on overflow
+ */
+template<class B> std::vector<B> word_add(std::vector<B> wordl, std::vector<B> wordr)
+{
+    size_t width = std::max(wordl.size(), wordr.size());
+    word_extend(wordl, width);
+    word_extend(wordr, width);
+    std::vector<B> ret;
+    B carry(wordl[0].space, false);
+    for(size_t i = 0; i < width; ++i)
+    {
+        B half = wordl[i] ^ wordr[i];
+        ret.push_back(half ^ carry);
+        carry = (wordl[i] && wordr[i]) || (half && carry);
+    }
+    return ret;
+}
+
+/**
+ * Bitwise if then else of two words on a condition
+ */
+template<class B> std::vector<B> word_ite(const B& cond, std::vector<B> wordt, std::vector<B> worde)
+{
+    size_t width = std::max(wordt.size(), worde.size());
+    word_extend(wordt, width);
+    word_extend(worde, width);
+    std::vector<B> ret;
+    for(size_t i = 0; i < width; ++i) ret.push_back((cond && wordt[i]) || (!cond && worde[i]));
+    return ret;
+}
+
+/**
+ * Comparisons of words, padding the narrower one with zeros
+ */
+template<class B> B word_eq(std::vector<B> wordl, std::vector<B> wordr)
+{
+    size_t width = std::max(wordl.size(), wordr.size());
+    word_extend(wordl, width);
+    word_extend(wordr, width);
+    B ret(wordl[0].space, true);
+    for(size_t i = width; i-- > 0; ) ret &= !(wordl[i] ^ wordr[i]);
+    return ret;
+}
+
+template<class B> B word_lt(std::vector<B> wordl, std::vector<B> wordr)
+{
+    size_t width = std::max(wordl.size(), wordr.size());
+    word_extend(wordl, width);
+    word_extend(wordr, width);
+    B ret(wordl[0].space, false);
+    for(size_t i = 0; i < width; ++i)
+        ret = (!wordl[i] && wordr[i]) || (!(wordl[i] ^ wordr[i]) && ret);
+    return ret;
+}
+
+template<class B> B word_le(const std::vector<B>& wordl, const std::vector<B>& wordr)
+{
+    return !word_lt(wordr, wordl);
+}
+
+#endif
@@ -0,0 +1,401 @@
+/**
+ * Implements the AIGER reader declared in `headers/aiger.hpp`
+ */
+
+#include "headers/aiger.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+
+
+/**
+ * Reads the lines of an AIGER file. Numbers on a line are separated by spaces, and the and gates of
+ * the binary format are read as pairs of variable length encoded deltas.
+ */
+class AigerCursor
+{
+    public:
+        AigerCursor(const char* data, size_t size) : data(data), size(size), pos(0), line(1) {}
+
+        [[noreturn]] void error(const std::string& msg) const
+        {
+            throw std::runtime_error("AIGER line " + std::to_string(line) + ": " + msg);
+        }
+
+        bool at_end() const { return pos >= size; }
+        bool at_line_end() const { return pos >= size || data[pos] == '\n'; }
+        char peek() const { return pos < size ? data[pos] : '\0'; }
+
+        /**
+         * Read an unsigned number, skipping spaces before it
+         */
+        unsigned number()
+        {
+            while(pos < size && data[pos] == ' ') ++pos;
+            if(pos >= size || data[pos] < '0' || data[pos] > '9') error("expected a number");
+            unsigned long long value = 0;
+            while(pos < size && data[pos] >= '0' && data[pos] <= '9')
+            {
+                value = value * 10 + (data[pos++] - '0');
+                if(value > 0x7fffffffull) error("number too large");
+            }
+            return value;
+        }
+
+        /**
+         * Expect the end of the current line, and move to the next
+         */
+        void end_line()
+        {
+            while(pos < size && (data[pos] == ' ' || data[pos] == '\r')) ++pos;
+            if(pos < size && data[pos] != '\n') error("unexpected characters at end of line");
+            if(pos < size) ++pos;
+            ++line;
+        }
+
+        /**
+         * Read the rest of the line as a string, and move to the next
+         */
+        std::string rest_of_line()
+        {
+            size_t start = pos;
+            while(pos < size && data[pos] != '\n') ++pos;
+            std::string ret(data + start, pos - start);
+            if(pos < size) ++pos;
+            ++line;
+            return ret;
+        }
+
+        /**
+         * A number in the binary encoding, 7 bits per byte with the high bit set on all but the
+         * last byte
+         */
+        unsigned delta()
+        {
+            unsigned long long value = 0;
+            for(int shift = 0; ; shift += 7)
+            {
+                if(pos >= size) error("unexpected end of file in binary and gates");
+                unsigned char byte = data[pos++];
+                value |= (unsigned long long)(byte & 0x7f) << shift;
+                if(value > 0xffffffffull) error("delta too large in binary and gates");
+                if(!(byte & 0x80)) return value;
+            }
+        }
+
+    private:
+        const char* data;
+        size_t size;
+        size_t pos;
+        size_t line;
+};
+
+
+
+/**
+ * Impl Aiger
+ */
+bool Aiger::is_aiger(const char* data, size_t size)
+{
+    return size >= 4 && (std::memcmp(data, "aag ", 4) == 0 || std::memcmp(data, "aig ", 4) == 0);
+}
+
+Aiger::Aiger(const char* data, size_t size)
+{
+    if(!is_aiger(data, size)) throw std::runtime_error("AIGER line 1: expected `aag` or `aig`");
+    bool binary = data[1] == 'i';
+    AigerCursor cur(data + 4, size - 4);
+
+    // Header `M I L O A` with the optional counts `B C J F`
+    max_var = cur.number();
+    unsigned n_inputs = cur.number(), n_latches = cur.number();
+    unsigned n_outputs = cur.number(), n_gates = cur.number();
+    unsigned counts[4] = { 0, 0, 0, 0 };
+    for(int i = 0; i < 4 && !cur.at_line_end(); ++i) counts[i] = cur.number();
+    if((unsigned long long)n_inputs + n_latches + n_gates > max_var)
+        cur.error("maximum variable index is less than I + L + A");
+    if(binary && n_inputs + n_latches + n_gates != max_var)
+        cur.error("maximum variable index must be I + L + A in binary files");
+    cur.end_line();
+
+    defs.assign(max_var + 1, VarDef());
+    defs[0].kind = CONSTANT;
+    funcs.resize(max_var + 1);
+    expanded.assign(max_var + 1, false);
+
+    // Inputs are implicit in the binary format
+    for(unsigned i = 0; i < n_inputs; ++i)
+    {
+        unsigned lit = 2 * (i + 1);
+        if(!binary) lit = cur.number();
+        check_literal(lit);
+        if(lit & 1 || lit == 0) cur.error("input must be a positive variable");
+        if(defs[lit / 2].kind != UNDEFINED) cur.error("variable defined twice");
+        if(!binary) cur.end_line();
+        define(lit, INPUT, i);
+        inputs.push_back(lit);
+    }
+
+    // Latches, with an optional reset value
+    for(unsigned i = 0; i < n_latches; ++i)
+    {
+        Latch latch;
+        latch.lit = binary ? 2 * (n_inputs + i + 1) : cur.number();
+        latch.next = cur.number();
+        latch.reset = 0;
+        if(!cur.at_line_end()) latch.reset = cur.number();
+        check_literal(latch.lit);
+        check_literal(latch.next);
+        if(latch.lit & 1 || latch.lit == 0) cur.error("latch must be a positive variable");
+        if(latch.reset > 1 && latch.reset != latch.lit)
+            cur.error("latch reset must be 0, 1 or the latch itself");
+        if(defs[latch.lit / 2].kind != UNDEFINED) cur.error("variable defined twice");
+        cur.end_line();
+        define(latch.lit, LATCH, i);
+        latches.push_back(latch);
+    }
+
+    // Outputs, bad states, constraints, justice and fairness are a literal per line, except that
+    // the justice section begins with the number of literals in each justice property
+    std::vector<unsigned>* sections[] = { &outputs, &bad, &constraints };
+    unsigned lengths[] = { n_outputs, counts[0], counts[1] };
+    for(int s = 0; s < 3; ++s)
+        for(unsigned i = 0; i < lengths[s]; ++i)
+        {
+            sections[s]->push_back(cur.number());
+            cur.end_line();
+        }
+    std::vector<unsigned> justice_sizes;
+    for(unsigned i = 0; i < counts[2]; ++i)
+    {
+        justice_sizes.push_back(cur.number());
+        cur.end_line();
+    }
+    for(unsigned i = 0; i < counts[2]; ++i)
+    {
+        justice.push_back(std::vector<unsigned>());
+        for(unsigned j = 0; j < justice_sizes[i]; ++j)
+        {
+            justice.back().push_back(cur.number());
+            cur.end_line();
+        }
+    }
+    for(unsigned i = 0; i < counts[3]; ++i)
+    {
+        fairness.push_back(cur.number());
+        cur.end_line();
+    }
+
+    // And gates. The binary format stores the differences lhs - rhs0 and rhs0 - rhs1, with the
+    // left hand sides following the latches in order.
+    for(unsigned i = 0; i < n_gates; ++i)
+    {
+        Gate gate;
+        if(binary)
+        {
+            gate.lhs = 2 * (n_inputs + n_latches + i + 1);
+            unsigned delta0 = cur.delta(), delta1 = cur.delta();
+            if(delta0 == 0 || delta0 > gate.lhs || delta1 > gate.lhs - delta0)
+                cur.error("invalid delta in binary and gates");
+            gate.rhs0 = gate.lhs - delta0;
+            gate.rhs1 = gate.rhs0 - delta1;
+        }
+        else
+        {
+            gate.lhs = cur.number();
+            gate.rhs0 = cur.number();
+            gate.rhs1 = cur.number();
+        }
+        check_literal(gate.lhs);
+        check_literal(gate.rhs0);
+        check_literal(gate.rhs1);
+        if(gate.lhs & 1 || gate.lhs == 0) cur.error("and gate must be a positive variable");
+        if(defs[gate.lhs / 2].kind != UNDEFINED) cur.error("variable defined twice");
+        if(!binary) cur.end_line();
+        define(gate.lhs, AND, i);
+        gates.push_back(gate);
+    }
+
+    // Every literal used must be defined
+    std::vector<unsigned> used(outputs);
+    used.insert(used.end(), bad.begin(), bad.end());
+    used.insert(used.end(), constraints.begin(), constraints.end());
+    used.insert(used.end(), fairness.begin(), fairness.end());
+    for(size_t i = 0; i < justice.size(); ++i)
+        used.insert(used.end(), justice[i].begin(), justice[i].end());
+    for(size_t i = 0; i < latches.size(); ++i) used.push_back(latches[i].next);
+    for(size_t i = 0; i < gates.size(); ++i)
+    {
+        used.push_back(gates[i].rhs0);
+        used.push_back(gates[i].rhs1);
+    }
+    for(std::vector<unsigned>::const_iterator i = used.begin(); i != used.end(); ++i)
+    {
+        check_literal(*i);
+        if(defs[*i / 2].kind == UNDEFINED)
+            throw std::runtime_error("AIGER: literal " + std::to_string(*i) + " is not defined");
+    }
+
+    // Symbol table, up to the comment section. Only the names of properties are kept.
+    output_syms.resize(outputs.size());
+    bad_syms.resize(bad.size());
+    justice_syms.resize(justice.size());
+    while(!cur.at_end())
+    {
+        char kind = cur.peek();
+        std::string entry = cur.rest_of_line();
+        if(kind == 'c' && entry.size() == 1) break;
+        size_t space = entry.find(' ');
+        if(space == std::string::npos || space < 2) continue;
+        unsigned long idx;
+        try { idx = std::stoul(entry.substr(1, space - 1)); }
+        catch(const std::exception& e) { continue; }
+        std::string name = entry.substr(space + 1);
+        if(kind == 'o' && idx < output_syms.size()) output_syms[idx] = name;
+        else if(kind == 'b' && idx < bad_syms.size()) bad_syms[idx] = name;
+        else if(kind == 'j' && idx < justice_syms.size()) justice_syms[idx] = name;
+    }
+
+    if(justice.size() > 1)
+        throw std::runtime_error("AIGER: only one justice property is supported");
+    make_properties();
+}
+
+void Aiger::define(unsigned lit, Kind kind, unsigned index)
+{
+    defs[lit / 2].kind = kind;
+    defs[lit / 2].index = index;
+}
+
+void Aiger::check_literal(unsigned lit) const
+{
+    if(lit / 2 > max_var)
+        throw std::runtime_error("AIGER: literal " + std::to_string(lit) +
+                                 " exceeds the maximum variable index");
+}
+
+void Aiger::make_properties()
+{
+    // Without bad state or justice literals, the outputs are the bad states as in AIGER 1.0
+    bool use_outputs = bad.empty() && justice.empty();
+    checked = use_outputs ? outputs : bad;
+    const std::vector<std::string>& syms = use_outputs ? output_syms : bad_syms;
+    const char* kind = use_outputs ? "output " : "bad state ";
+    props = "(properties\n";
+    for(size_t i = 0; i < checked.size(); ++i)
+    {
+        names.push_back("bad" + std::to_string(i));
+        descs.push_back(kind + std::to_string(i) + (syms[i].empty() ? "" : " " + syms[i]));
+        props += "    (AG (not " + names.back() + "))\n";
+    }
+    for(size_t i = 0; i < justice.size(); ++i)
+    {
+        descs.push_back("justice " + std::to_string(i) +
+                        (justice_syms[i].empty() ? "" : " " + justice_syms[i]));
+        props += "    (not (EG true))\n";
+    }
+    props += ")";
+}
+
+Transition Aiger::literal(const StateSpace& sp, unsigned lit)
+{
+    // Build the gates in the cone of the literal in depth first order, with an explicit stack as
+    // circuits can be far deeper than the call stack. A gate seen again while its operands are
+    // still being built is part of a cycle. The marks are never cleared, as every gate marked by a
+    // call that returns has been built by then, and built gates are not looked at again.
+    std::vector<unsigned> stack(1, lit / 2);
+    while(!stack.empty())
+    {
+        unsigned var = stack.back();
+        if(funcs[var])
+        {
+            stack.pop_back();
+            continue;
+        }
+        const VarDef& def = defs[var];
+        if(def.kind == CONSTANT)    funcs[var].reset(new Transition(sp, false));
+        else if(def.kind == INPUT)  funcs[var].reset(new Transition(Transition::input(sp, def.index)));
+        else if(def.kind == LATCH)  funcs[var].reset(new Transition(sp, def.index, false));
+        else
+        {
+            const Gate& gate = gates[def.index];
+            unsigned var0 = gate.rhs0 / 2, var1 = gate.rhs1 / 2;
+            if(!funcs[var0] || !funcs[var1])
+            {
+                if(expanded[var])
+                    throw std::runtime_error("AIGER: and gate " + std::to_string(gate.lhs) +
+                                             " depends on itself");
+                expanded[var] = true;
+                if(!funcs[var0]) stack.push_back(var0);
+                if(!funcs[var1]) stack.push_back(var1);
+                continue;
+            }
+            Transition rhs0 = gate.rhs0 & 1 ? !*funcs[var0] : *funcs[var0];
+            Transition rhs1 = gate.rhs1 & 1 ? !*funcs[var1] : *funcs[var1];
+            funcs[var].reset(new Transition(rhs0 && rhs1));
+        }
+        stack.pop_back();
+    }
+    return lit & 1 ? !*funcs[lit / 2] : *funcs[lit / 2];
+}
+
+Predicate Aiger::literal_states(const StateSpace& sp, unsigned lit)
+{
+    // The image of the function under EX abstracts the inputs and leaves the predicate over the
+    // state it depends on
+    Transition func = literal(sp, lit);
+    for(std::vector<unsigned>::const_iterator i = constraints.begin(); i != constraints.end(); ++i)
+        func &= literal(sp, *i);
+    return func.EX(Predicate(sp, true));
+}
+
+void Aiger::build_model(const StateSpace& sp, Predicate& init, Transition& trans)
+{
+    if(sp.state_bits != num_latches() || sp.input_bits != num_inputs())
+        throw std::runtime_error("State space does not match AIGER circuit");
+
+    // Initial states from the reset values, among those satisfying the constraints
+    init = Predicate(sp, true);
+    for(std::vector<Latch>::const_iterator i = latches.begin(); i != latches.end(); ++i)
+    {
+        int idx = i - latches.begin();
+        if(i->reset == 0)       init &= !Predicate(sp, idx);
+        else if(i->reset == 1)  init &= Predicate(sp, idx);
+    }
+    if(!constraints.empty()) init &= literal_states(sp, 1);
+
+    // One partition per latch, conjoined pairwise so that the intermediate products stay over
+    // few latches each, followed by the constraints on the inputs and the state gone from
+    std::vector<Transition> parts;
+    for(std::vector<Latch>::const_iterator i = latches.begin(); i != latches.end(); ++i)
+        parts.push_back(!(Transition(sp, i - latches.begin(), true) ^ literal(sp, i->next)));
+    for(std::vector<unsigned>::const_iterator i = constraints.begin(); i != constraints.end(); ++i)
+        parts.push_back(literal(sp, *i));
+    while(parts.size() > 1)
+    {
+        std::vector<Transition> merged;
+        for(size_t i = 0; i + 1 < parts.size(); i += 2) merged.push_back(parts[i] && parts[i + 1]);
+        if(parts.size() % 2) merged.push_back(parts.back());
+        parts.swap(merged);
+    }
+    trans = parts.empty() ? Transition(sp, true) : parts[0];
+
+    // The justice property is checked with its literals and the fairness constraints as the
+    // fairness of the system, while the other properties ignore them. With neither, every
+    // infinite path is fair.
+    if(justice.empty()) return;
+    std::vector<unsigned> fair(justice[0]);
+    fair.insert(fair.end(), fairness.begin(), fairness.end());
+    if(fair.empty()) trans.add_fairness(Predicate(sp, true));
+    for(std::vector<unsigned>::const_iterator i = fair.begin(); i != fair.end(); ++i)
+        trans.add_fairness(literal_states(sp, *i));
+}
+
+std::vector<Predicate> Aiger::build_signals(const StateSpace& sp)
+{
+    std::vector<Predicate> ret;
+    for(std::vector<unsigned>::const_iterator i = checked.begin(); i != checked.end(); ++i)
+        ret.push_back(literal_states(sp, *i));
+    return ret;
+}
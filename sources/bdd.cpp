@@ -3,83 +3,95 @@
  */
 
 #include "headers/bdd.hpp"
+#include "headers/cudd_backend.hpp"
 
-// For some reason cudd needs declarations in these headers but does not include these within
-// cudd.h.....
-#include <cstdio>
-#include <cstdlib>
-extern "C"
-{
-    #include <sys/types.h>
-    #include "cudd.h"
-}
-
+#include <algorithm>
+#include <bitset>
 #include <stdexcept>
+#include <cstdint>
+#include <unordered_map>
 
 
-// Initialize static vars, including manager
-DdManager* BDD::manager = Cudd_Init(0, 0, CUDD_UNIQUE_SLOTS, CUDD_CACHE_SLOTS, 0);
+// The backend for new BDDs, made when first needed so that it can be replaced before, and the one
+// overriding it on each thread
+BDDBackend* BDD::current = NULL;
+thread_local BDDBackend* BDD::thread_current = NULL;
+
+BDDBackend* BDD::current_backend()
+{
+    if(thread_current) return thread_current;
+    if(!current) current = new CuddBackend();
+    return current;
+}
+
+void BDD::set_backend(BDDBackend* backend) { current = backend; }
+void BDD::set_thread_backend(BDDBackend* backend) { thread_current = backend; }
+BDDBackend* BDD::new_backend() { return current_backend()->create(); }
 
 
 // Ctor, dtor and assignment
-BDD::BDD(int var_index)
+BDD::BDD(int var_index) : backend(current_backend())
 {
-    node = Cudd_bddIthVar(BDD::manager, var_index);
-    if(!node) throw std::runtime_error("DdNode for variable returned null");
-    Cudd_Ref(node);
+    node = backend->var(var_index);
+    backend->ref(node);
 }
 
-BDD::BDD(bool bconst)
+BDD::BDD(bool bconst) : backend(current_backend())
 {
-    node = bconst ? Cudd_ReadOne(BDD::manager) : Cudd_ReadLogicZero(BDD::manager);
-    Cudd_Ref(node);
+    node = backend->constant(bconst);
+    backend->ref(node);
 }
 
-BDD::BDD(DdNode* nd) : node(nd)
+BDD::BDD(BDDBackend* bk, BDDBackend::Node nd) : backend(bk), node(nd)
 {
-    Cudd_Ref(node);
+    backend->ref(node);
 }
 // TODO: Decide between potentially changing the vector vs copying it over
-BDD::BDD(std::vector<int>& var_indices) 
-    : BDD(Cudd_IndicesToCube(BDD::manager, var_indices.data(), var_indices.size())) {}
+BDD::BDD(std::vector<int>& var_indices) : BDD(true)
+{
+    for(size_t i = var_indices.size(); i-- > 0; ) *this &= BDD(var_indices[i]);
+}
 
-BDD::BDD(const BDD& other) : node(other.node)
+BDD::BDD(const BDD& other) : backend(other.backend), node(other.node)
 {
-    Cudd_Ref(node);
+    backend->ref(node);
 }
 
 BDD& BDD::operator=(const BDD& other)
 {
-    Cudd_RecursiveDeref(BDD::manager, node);
+    other.backend->ref(other.node);
+    backend->deref(node);
+    backend = other.backend;
     node = other.node;
-    Cudd_Ref(node);
     return *this;
 }
 
 BDD::~BDD()
 {
-    Cudd_RecursiveDeref(BDD::manager, node);
+    backend->deref(node);
 }
 
 
 // Wrappers
+static void check_backends(BDDBackend* bkl, BDDBackend* bkr)
+{
+    if(bkl != bkr) throw std::runtime_error("Operands of BDD operation have different backends");
+}
+
 BDD operator&&(const BDD& bddl, const BDD& bddr)
 {
-    DdNode* node = Cudd_bddAnd(BDD::manager, bddl.node, bddr.node);
-    if(!node) throw std::runtime_error("And of DdNodes returned null");
-    return BDD(node);
+    check_backends(bddl.backend, bddr.backend);
+    return BDD(bddl.backend, bddl.backend->apply_and(bddl.node, bddr.node));
 }
 BDD operator||(const BDD& bddl, const BDD& bddr)
 {
-    DdNode* node = Cudd_bddOr(BDD::manager, bddl.node, bddr.node);
-    if(!node) throw std::runtime_error("And of DdNodes returned null");
-    return BDD(node);
+    check_backends(bddl.backend, bddr.backend);
+    return BDD(bddl.backend, bddl.backend->apply_or(bddl.node, bddr.node));
 }
 BDD operator^(const BDD& bddl, const BDD& bddr)
 {
-    DdNode* node = Cudd_bddXor(BDD::manager, bddl.node, bddr.node);
-    if(!node) throw std::runtime_error("And of DdNodes returned null");
-    return BDD(node);
+    check_backends(bddl.backend, bddr.backend);
+    return BDD(bddl.backend, bddl.backend->apply_xor(bddl.node, bddr.node));
 }
 
 BDD& BDD::operator&=(const BDD& other)
@@ -99,29 +111,51 @@ BDD& BDD::operator^=(const BDD& other)
 }
 BDD BDD::operator!() const
 {
-   return BDD(Cudd_Not(node));
+   return BDD(backend, backend->negate(node));
 }
 
 
-// DdNode for a given BDD function is guaranteed to be unique
-bool operator==(const BDD& bddl, const BDD& bddr) { return bddl.node == bddr.node; }
-bool operator!=(const BDD& bddl, const BDD& bddr) { return bddl.node != bddr.node; }
-bool BDD::is_zero() const { return node == Cudd_ReadLogicZero(BDD::manager); }
-bool BDD::is_one()  const { return node == Cudd_ReadOne(BDD::manager);  }
+// Nodes for a given BDD function are guaranteed to be unique within a backend
+bool operator==(const BDD& bddl, const BDD& bddr)
+{
+    return bddl.backend == bddr.backend && bddl.node == bddr.node;
+}
+bool operator!=(const BDD& bddl, const BDD& bddr) { return !(bddl == bddr); }
+bool BDD::is_zero() const { return node == backend->constant(false); }
+bool BDD::is_one()  const { return node == backend->constant(true);  }
+bool BDD::leq(const BDD& other) const
+{
+    check_backends(backend, other.backend);
+    return backend->leq(node, other.node);
+}
 
 
-// Get a satisfying assignment
-std::vector<bool> BDD::get_assign()
+// Walk down one satisfying path, without building any BDDs on the way
+std::vector<bool> BDD::pick_minterm(const std::vector<int>& vars, std::mt19937_64* rng) const
 {
-    int* raw_cube;  // This will be managed by the returned DdGen struct, freed by Cudd_GenFree()
-    CUDD_VALUE_TYPE val;
     if(is_zero()) throw std::runtime_error("Cannot get assignment for an unsat BDD");
-    DdGen* gen = Cudd_FirstCube(BDD::manager, node, &raw_cube, &val);
-    if(!gen) throw std::runtime_error("First cube returns null generator");
-    std::vector<bool> ret(Cudd_ReadSize(BDD::manager));
-    for(size_t i = 0; i < ret.size(); i++)
-        ret[i] = raw_cube[i] != 0;
-    Cudd_GenFree(gen);
+    std::vector<bool> ret(vars.size(), true);
+    if(rng) for(size_t j = 0; j < ret.size(); ++j) ret[j] = (*rng)() & 1;
+    std::vector<int> pos(vars.empty() ? 0 : *std::max_element(vars.begin(), vars.end()) + 1, -1);
+    for(size_t j = 0; j < vars.size(); ++j) pos[vars[j]] = j;
+
+    // The edge followed is nonzero at each step, and a nonconstant node always has a nonzero child
+    BDDBackend::Node nd = node;
+    bool negate = false;
+    while(!backend->is_constant(backend->regular(nd)))
+    {
+        negate ^= backend->is_complement(nd);
+        BDDBackend::Node reg = backend->regular(nd);
+        BDDBackend::Node thn = backend->then_child(reg), els = backend->else_child(reg);
+        bool els_zero = backend->is_constant(backend->regular(els)) &&
+                        (negate ^ backend->is_complement(els));
+        bool thn_zero = backend->is_constant(backend->regular(thn)) &&
+                        (negate ^ backend->is_complement(thn));
+        bool take_then = els_zero || (!thn_zero && rng && ((*rng)() & 1));
+        int var = backend->var_index(reg);
+        if(var < (int) pos.size() && pos[var] >= 0) ret[pos[var]] = take_then;
+        nd = take_then ? thn : els;
+    }
     return ret;
 }
 
@@ -129,36 +163,373 @@ std::vector<bool> BDD::get_assign()
 // Wrapper for quantifier eleminations
 BDD BDD::existential_abstraction(int var_index) const
 {
-    return BDD(Cudd_bddExistAbstract(BDD::manager, node, Cudd_bddIthVar(BDD::manager, var_index)));
+    return existential_abstraction(BDD(var_index));
 }
 BDD BDD::universal_abstraction(int var_index) const
 {
-    return BDD(Cudd_bddUnivAbstract(BDD::manager, node, Cudd_bddIthVar(BDD::manager, var_index)));
+    return universal_abstraction(BDD(var_index));
 }
 BDD BDD::existential_abstraction(const BDD& cube) const
 {
-    return BDD(Cudd_bddExistAbstract(BDD::manager, node, cube.node));
+    check_backends(backend, cube.backend);
+    return BDD(backend, backend->exists(node, cube.node));
 }
 BDD BDD::universal_abstraction(const BDD& cube) const
 {
-    return BDD(Cudd_bddUnivAbstract(BDD::manager, node, cube.node));
+    check_backends(backend, cube.backend);
+    return BDD(backend, backend->forall(node, cube.node));
+}
+BDD BDD::and_abstraction(const BDD& other, const BDD& cube) const
+{
+    check_backends(backend, other.backend);
+    check_backends(backend, cube.backend);
+    return BDD(backend, backend->and_exists(node, other.node, cube.node));
+}
+BDD BDD::restrict(const BDD& care) const
+{
+    check_backends(backend, care.backend);
+    return BDD(backend, backend->restrict(node, care.node));
+}
+BDD BDD::permute(const std::vector<int>& perm) const
+{
+    return BDD(backend, backend->permute(node, perm));
 }
-BDD BDD::existential_abstraction(std::vector<int>& var_indices) const 
-{ 
+BDD BDD::existential_abstraction(std::vector<int>& var_indices) const
+{
     return existential_abstraction(BDD(var_indices));
 }
 BDD BDD::universal_abstraction(std::vector<int>& var_indices) const
-{ 
+{
     return universal_abstraction(BDD(var_indices));
 }
 
+std::vector<int> BDD::support() const { return backend->support(node); }
+
 
 // Utility functions
 void BDD::save_dot(const std::string& filename, bool draw_0_arc) const
 {
-    DdNode* nd = draw_0_arc ? node : Cudd_BddToAdd(BDD::manager, node);  // Node to draw
-    FILE* file = fopen(filename.c_str(), "w");                      // using c-file for compat
-    if(!file) throw std::runtime_error("Could not open file " + filename);
-    Cudd_DumpDot(BDD::manager, 1, &nd, NULL, NULL, file);
-    if(fclose(file) != 0) throw std::runtime_error("Could not safely close file " + filename); 
-} 
+    backend->save_dot(node, draw_0_arc, filename);
+}
+
+size_t BDD::node_count() const { return backend->node_count(node); }
+
+
+// Counts of minterms are unsigned integers of a fixed number of 32 bit words, least significant
+// first, wide enough for twice the number of assignments of the variables counted
+typedef std::vector<uint32_t> BigCount;
+
+static void big_add(BigCount& acc, const BigCount& other)
+{
+    uint64_t carry = 0;
+    for(size_t i = 0; i < acc.size(); ++i)
+    {
+        carry += uint64_t(acc[i]) + other[i];
+        acc[i] = carry;
+        carry >>= 32;
+    }
+}
+
+// Set acc to other - acc, which must not be negative
+static void big_sub_from(BigCount& acc, const BigCount& other)
+{
+    int64_t borrow = 0;
+    for(size_t i = 0; i < acc.size(); ++i)
+    {
+        int64_t diff = int64_t(other[i]) - acc[i] - borrow;
+        borrow = diff < 0;
+        acc[i] = diff + (borrow << 32);
+    }
+}
+
+static void big_halve(BigCount& acc)
+{
+    for(size_t i = 0; i < acc.size(); ++i)
+        acc[i] = (acc[i] >> 1) | (i + 1 < acc.size() ? acc[i + 1] << 31 : 0);
+}
+
+static std::string big_to_decimal(BigCount num)
+{
+    std::string digits;
+    bool zero;
+    do
+    {
+        // Divide by 10^9, keeping the remainder as the next nine digits
+        uint64_t rem = 0;
+        zero = true;
+        for(size_t i = num.size(); i-- > 0; )
+        {
+            uint64_t cur = (rem << 32) | num[i];
+            num[i] = cur / 1000000000;
+            rem = cur % 1000000000;
+            zero = zero && num[i] == 0;
+        }
+        for(int d = 0; d < 9 && (rem || !zero || digits.empty()); ++d, rem /= 10)
+            digits += char('0' + rem % 10);
+    }
+    while(!zero);
+    return std::string(digits.rbegin(), digits.rend());
+}
+
+// A node satisfied by count assignments has children whose counts, both over all of the variables,
+// add up to twice that. The counts of regular nodes are memoized.
+static BigCount count_node(BDDBackend& bk, BDDBackend::Node nd, const std::vector<bool>& counted,
+                           const BigCount& all, std::unordered_map<BDDBackend::Node, BigCount>& memo)
+{
+    BDDBackend::Node reg = bk.regular(nd);
+    BigCount ret;
+    std::unordered_map<BDDBackend::Node, BigCount>::const_iterator it = memo.find(reg);
+    if(it != memo.end()) ret = it->second;
+    else if(bk.is_constant(reg)) ret = all;
+    else
+    {
+        int var = bk.var_index(reg);
+        if(var >= (int) counted.size() || !counted[var])
+            throw std::runtime_error("BDD depends on a variable that is not counted");
+        ret = count_node(bk, bk.then_child(reg), counted, all, memo);
+        big_add(ret, count_node(bk, bk.else_child(reg), counted, all, memo));
+        big_halve(ret);
+        memo[reg] = ret;
+    }
+    if(bk.is_complement(nd)) big_sub_from(ret, all);
+    return ret;
+}
+
+std::string BDD::count_minterms(const std::vector<int>& vars) const
+{
+    std::vector<bool> counted(vars.empty() ? 0 : *std::max_element(vars.begin(), vars.end()) + 1);
+    for(std::vector<int>::const_iterator i = vars.begin(); i != vars.end(); ++i) counted[*i] = true;
+    BigCount all(vars.size() / 32 + 1, 0);
+    all[vars.size() / 32] = uint32_t(1) << (vars.size() % 32);
+    all.push_back(0);
+    std::unordered_map<BDDBackend::Node, BigCount> memo;
+    return big_to_decimal(count_node(*backend, node, counted, all, memo));
+}
+
+ManagerStats BDD::read_manager_stats() { return current_backend()->read_stats(); }
+
+
+// Transfer between backends. Each node of the source is rebuilt once from its rebuilt children.
+BDD BDD::transfer() const
+{
+    BDDBackend* bk = current_backend();
+    if(bk == backend) return *this;
+    struct Rebuild
+    {
+        BDDBackend& src;
+        BDDBackend* dst;
+        std::unordered_map<BDDBackend::Node, BDD> memo;
+        BDD operator()(BDDBackend::Node nd)
+        {
+            BDDBackend::Node reg = src.regular(nd);
+            std::unordered_map<BDDBackend::Node, BDD>::const_iterator it = memo.find(reg);
+            if(it == memo.end())
+            {
+                BDD rebuilt(true);
+                if(!src.is_constant(reg))
+                {
+                    BDD thn = (*this)(src.then_child(reg));
+                    BDD els = (*this)(src.else_child(reg));
+                    BDD var(src.var_index(reg));
+                    rebuilt = BDD(dst, dst->ite(var.node, thn.node, els.node));
+                }
+                else if(reg != src.constant(true)) rebuilt = BDD(false);
+                it = memo.insert(std::make_pair(reg, rebuilt)).first;
+            }
+            return src.is_complement(nd) ? !it->second : it->second;
+        }
+    } rebuild = { *backend, bk, std::unordered_map<BDDBackend::Node, BDD>() };
+    return rebuild(node);
+}
+
+
+// Serialization. A reference to a node is its position in the node list shifted left by one, with
+// the low bit set for complemented edges. Position 0 is the constant one node.
+typedef std::unordered_map<BDDBackend::Node, uint64_t> NodeIds;
+
+template<class T> static void write_raw(std::ostream& out, const T& val)
+{
+    out.write(reinterpret_cast<const char*>(&val), sizeof(T));
+}
+template<class T> static T read_raw(std::istream& in)
+{
+    T val;
+    if(!in.read(reinterpret_cast<char*>(&val), sizeof(T)))
+        throw std::runtime_error("Unexpected end of BDD stream");
+    return val;
+}
+
+// Number the nodes reachable from nd in post order, collecting them in order
+static uint64_t number_nodes(BDDBackend& bk, BDDBackend::Node nd, NodeIds& ids,
+                             std::vector<BDDBackend::Node>& order)
+{
+    BDDBackend::Node reg = bk.regular(nd);
+    uint64_t cmpl = bk.is_complement(nd) ? 1 : 0;
+    NodeIds::const_iterator it = ids.find(reg);
+    if(it != ids.end()) return (it->second << 1) | cmpl;
+    if(!bk.is_constant(reg))
+    {
+        number_nodes(bk, bk.then_child(reg), ids, order);
+        number_nodes(bk, bk.else_child(reg), ids, order);
+    }
+    uint64_t id = order.size();
+    ids[reg] = id;
+    order.push_back(reg);
+    return (id << 1) | cmpl;
+}
+
+void BDD::save(std::ostream& out, const std::vector<BDD>& roots)
+{
+    BDDBackend& bk = *current_backend();
+    NodeIds ids;
+    std::vector<BDDBackend::Node> order;
+    number_nodes(bk, bk.constant(true), ids, order);
+    std::vector<uint64_t> root_refs;
+    for(std::vector<BDD>::const_iterator i = roots.begin(); i != roots.end(); ++i)
+    {
+        check_backends(&bk, i->backend);
+        root_refs.push_back(number_nodes(bk, i->node, ids, order));
+    }
+
+    write_raw<uint64_t>(out, order.size() - 1);
+    for(size_t i = 1; i < order.size(); ++i)
+    {
+        write_raw<int32_t>(out, bk.var_index(order[i]));
+        write_raw<uint64_t>(out, number_nodes(bk, bk.then_child(order[i]), ids, order));
+        write_raw<uint64_t>(out, number_nodes(bk, bk.else_child(order[i]), ids, order));
+    }
+    write_raw<uint64_t>(out, root_refs.size());
+    for(size_t i = 0; i < root_refs.size(); ++i) write_raw<uint64_t>(out, root_refs[i]);
+}
+
+std::vector<BDD> BDD::load(std::istream& in, int n_vars)
+{
+    BDDBackend* bk = current_backend();
+    std::vector<BDD> nodes(1, BDD(true));
+    uint64_t n_nodes = read_raw<uint64_t>(in);
+
+    // Each node takes 20 bytes, so a count the rest of the stream cannot hold is corrupt, and is
+    // not used to allocate
+    std::streampos pos = in.tellg();
+    if(pos != std::streampos(-1))
+    {
+        in.seekg(0, std::ios::end);
+        uint64_t remaining = in.tellg() - pos;
+        in.seekg(pos);
+        if(n_nodes > remaining / 20) throw std::runtime_error("Malformed BDD stream");
+        nodes.reserve(n_nodes + 1);
+    }
+    // Resolve a reference to an already built node
+    struct Resolve
+    {
+        const std::vector<BDD>& nodes;
+        BDD operator()(uint64_t ref) const
+        {
+            if((ref >> 1) >= nodes.size()) throw std::runtime_error("Malformed BDD stream");
+            return (ref & 1) ? !nodes[ref >> 1] : nodes[ref >> 1];
+        }
+    } resolve = { nodes };
+    for(uint64_t i = 0; i < n_nodes; ++i)
+    {
+        int32_t var = read_raw<int32_t>(in);
+        BDD thn = resolve(read_raw<uint64_t>(in));
+        BDD els = resolve(read_raw<uint64_t>(in));
+        if(var < 0 || var >= n_vars) throw std::runtime_error("Malformed BDD stream");
+        BDD var_bdd(var);
+        nodes.push_back(BDD(bk, bk->ite(var_bdd.node, thn.node, els.node)));
+    }
+    uint64_t n_roots = read_raw<uint64_t>(in);
+    std::vector<BDD> roots;
+    for(uint64_t i = 0; i < n_roots; ++i) roots.push_back(resolve(read_raw<uint64_t>(in)));
+    return roots;
+}
+
+
+// Set the bits of table for the assignments that follow the path to nd, on which the variables in
+// fixed_mask are set to fixed, if the path ends in the constant one
+static void fill_table(BDDBackend& bk, BDDBackend::Node nd, bool negate, const std::vector<int>& pos,
+                       uint64_t fixed_mask, uint64_t fixed, uint64_t all_mask,
+                       std::vector<uint64_t>& table)
+{
+    BDDBackend::Node reg = bk.regular(nd);
+    negate ^= bk.is_complement(nd);
+    if(bk.is_constant(reg))
+    {
+        if(negate) return;
+        // Visit every subset of the free variables
+        uint64_t free = all_mask & ~fixed_mask;
+        for(uint64_t sub = free; ; sub = (sub - 1) & free)
+        {
+            uint64_t i = fixed | sub;
+            table[i / 64] |= uint64_t(1) << (i % 64);
+            if(!sub) break;
+        }
+        return;
+    }
+    int var = bk.var_index(reg);
+    if(var >= (int) pos.size() || pos[var] < 0)
+        throw std::runtime_error("BDD depends on a variable outside its truth table");
+    uint64_t bit = uint64_t(1) << pos[var];
+    fill_table(bk, bk.then_child(reg), negate, pos, fixed_mask | bit, fixed | bit, all_mask, table);
+    fill_table(bk, bk.else_child(reg), negate, pos, fixed_mask | bit, fixed, all_mask, table);
+}
+
+std::vector<uint64_t> BDD::truth_table(const std::vector<int>& vars) const
+{
+    std::vector<int> pos(backend->num_vars(), -1);
+    for(size_t j = 0; j < vars.size(); ++j) pos[vars[j]] = j;
+    uint64_t size = uint64_t(1) << vars.size();
+    std::vector<uint64_t> table((size + 63) / 64, 0);
+    fill_table(*backend, node, false, pos, 0, 0, size - 1, table);
+    return table;
+}
+
+BDD BDD::from_truth_table(const std::vector<int>& vars, const std::vector<uint64_t>& table)
+{
+    size_t size = size_t(1) << vars.size();
+    size_t ones = 0;
+    for(size_t i = 0; i < (size + 63) / 64; ++i) ones += std::bitset<64>(table[i]).count();
+
+    // A table with few entries set is cheaper to build one minterm at a time
+    if(ones * vars.size() < size)
+    {
+        BDD ret(false);
+        std::vector<int> values(vars.empty() ? 0 : *std::max_element(vars.begin(), vars.end()) + 1,
+                                2);
+        for(size_t i = 0; i < size; ++i)
+        {
+            if(!table[i / 64]) { i |= 63; continue; }
+            if(!((table[i / 64] >> (i % 64)) & 1)) continue;
+            for(size_t k = 0; k < vars.size(); ++k) values[vars[k]] = (i >> k) & 1;
+            ret |= from_cube(values);
+        }
+        return ret;
+    }
+
+    // Combine the functions of the table entries pairwise, from the last variable to the first,
+    // so that each step splits on a variable above the ones already built
+    BDDBackend* bk = current_backend();
+    std::vector<BDD> level;
+    level.reserve(size);
+    for(size_t i = 0; i < size; ++i) level.push_back(BDD(((table[i / 64] >> (i % 64)) & 1) != 0));
+    for(size_t k = vars.size(); k-- > 0; )
+    {
+        size_t half = size_t(1) << k;
+        BDD var(vars[k]);
+        for(size_t i = 0; i < half; ++i)
+            level[i] = BDD(bk, bk->ite(var.node, level[i + half].node, level[i].node));
+        level.resize(half, BDD(false));
+    }
+    return level[0];
+}
+
+BDD BDD::from_cube(const std::vector<int>& values)
+{
+    BDDBackend* bk = current_backend();
+    return BDD(bk, bk->cube(values));
+}
+
+void BDD::for_each_cube(const std::function<bool(const std::vector<int>&)>& visit) const
+{
+    backend->for_each_cube(node, visit);
+}
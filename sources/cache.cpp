@@ -0,0 +1,286 @@
+/**
+ * Implements the caches declared in `headers/cache.hpp`. Each entry starts with a header:
+ *
+ *      magic, format version, length of key, key
+ *
+ * For the ModelCache this is followed by:
+ *
+ *      number of state bits, number of fairness constraints, BDDs for init, t_u_v and each
+ *      fairness constraint
+ *
+ * with the BDDs in the format of BDD::save. For the ResultCache it is followed by:
+ *
+ *      verdict, length of report, report, length of trace, trace
+ */
+
+#include "headers/cache.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+
+#include <sys/stat.h>               // mkdir
+#include <unistd.h>                 // getpid
+
+
+
+static const char model_magic[8]  = { 'C', 'T', 'L', 'M', 'C', 'B', 'D', 'D' };
+static const char result_magic[8] = { 'C', 'T', 'L', 'M', 'C', 'R', 'E', 'S' };
+static const uint32_t format_version = 3;
+
+
+
+unsigned long long fnv1a_hash(const std::string& str)
+{
+    unsigned long long hash = 14695981039346656037ULL;
+    for(std::string::const_iterator i = str.begin(); i != str.end(); ++i)
+    {
+        hash ^= (unsigned char) *i;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+StreamHash::StreamHash() : hash_lo(14695981039346656037ULL), hash_hi(0x6c62272e07bb0142ULL) {}
+
+void StreamHash::add(const char* data, size_t size)
+{
+    for(size_t i = 0; i <= size; ++i)
+    {
+        unsigned char c = i < size ? data[i] : 0;
+        hash_lo = (hash_lo ^ c) * 1099511628211ULL;
+        hash_hi = (hash_hi ^ c) * 1099511628211ULL;
+        hash_hi ^= hash_hi >> 29;
+    }
+}
+
+std::string StreamHash::hex() const
+{
+    std::ostringstream out;
+    out << std::hex << std::setfill('0') << std::setw(16) << hash_hi << std::setw(16) << hash_lo;
+    return out.str();
+}
+
+
+
+/**
+ * Path of the entry for key in dir with given extension
+ */
+static std::string entry_path(const std::string& dir, const std::string& key, const char* ext)
+{
+    std::ostringstream name;
+    name << dir << "/" << std::hex << std::setw(16) << std::setfill('0') << fnv1a_hash(key) << ext;
+    return name.str();
+}
+
+/**
+ * Read and check the header of an entry, returns false if it does not match
+ */
+static bool read_header(std::istream& in, const char* magic, const std::string& key)
+{
+    char file_magic[8];
+    uint32_t version;
+    uint64_t key_len;
+    if(!in.read(file_magic, sizeof(file_magic)) || !std::equal(magic, magic + 8, file_magic))
+        return false;
+    if(!in.read(reinterpret_cast<char*>(&version), sizeof(version)) || version != format_version)
+        return false;
+    if(!in.read(reinterpret_cast<char*>(&key_len), sizeof(key_len)) || key_len != key.size())
+        return false;
+    std::string file_key(key_len, '\0');
+    return in.read(&file_key[0], key_len) && file_key == key;
+}
+
+/**
+ * Write the header of an entry
+ */
+static void write_header(std::ostream& out, const char* magic, const std::string& key)
+{
+    uint64_t key_len = key.size();
+    out.write(magic, 8);
+    out.write(reinterpret_cast<const char*>(&format_version), sizeof(format_version));
+    out.write(reinterpret_cast<const char*>(&key_len), sizeof(key_len));
+    out.write(key.data(), key.size());
+}
+
+/**
+ * Create dir along with any missing parents, throws a runtime_error if one cannot be created
+ */
+static void make_dir(const std::string& dir)
+{
+    for(size_t end = dir.find('/', 1); ; end = dir.find('/', end + 1))
+    {
+        std::string prefix = dir.substr(0, end);
+        if(mkdir(prefix.c_str(), 0777) != 0 && errno != EEXIST)
+            throw std::runtime_error("Could not create cache directory " + prefix);
+        if(end == std::string::npos) break;
+    }
+}
+
+/**
+ * Name of a temporary file next to final_path that no other run or store writes to at the same time
+ */
+static std::string temp_path(const std::string& final_path)
+{
+    static std::atomic<unsigned> counter(0);
+    std::ostringstream name;
+    name << final_path << ".tmp." << getpid() << "." << counter++;
+    return name.str();
+}
+
+/**
+ * Move a fully written temporary file into place. Writing to a temporary file first ensures that
+ * concurrent runs never see a partial entry.
+ */
+static void commit_entry(const std::string& tmp_path, const std::string& final_path)
+{
+    if(std::rename(tmp_path.c_str(), final_path.c_str()) != 0)
+    {
+        std::remove(tmp_path.c_str());
+        throw std::runtime_error("Could not move cache file into place at " + final_path);
+    }
+}
+
+
+
+/**
+ * Impl ModelCache
+ */
+ModelCache::ModelCache(const std::string& d) : dir(d) {}
+
+std::string ModelCache::path(const std::string& key) const { return entry_path(dir, key, ".model"); }
+
+
+bool ModelCache::load(const std::string& key, Predicate& init, Transition& trans) const
+{
+    std::ifstream in(path(key), std::ios::binary);
+    if(!in.is_open()) return false;
+    try
+    {
+        if(!read_header(in, model_magic, key)) return false;
+        int32_t state_bits;
+        uint64_t n_fair;
+        if(!in.read(reinterpret_cast<char*>(&state_bits), sizeof(state_bits)) || 
+                state_bits != init.space.state_bits) 
+            return false;
+        if(!in.read(reinterpret_cast<char*>(&n_fair), sizeof(n_fair))) return false;
+        std::vector<BDD> bdds = BDD::load(in, 2 * init.space.state_bits + init.space.input_bits);
+        if(bdds.size() != 2 + n_fair) return false;
+
+        init = Predicate(init.space, bdds[0], true);
+        trans = Transition(trans.space, bdds[1]);
+        for(size_t i = 0; i < n_fair; ++i) trans.add_fairness(Predicate(init.space, bdds[2 + i], true));
+        return true;
+    }
+    catch(const std::exception& e) { return false; }      // Corrupt counts may fail to allocate
+}
+
+void ModelCache::store(const std::string& key, const Predicate& init, const Transition& trans) const
+{
+    make_dir(dir);
+    std::string final_path = path(key);
+    std::string tmp_path = temp_path(final_path);
+    {
+        std::ofstream out(tmp_path, std::ios::binary);
+        if(!out.is_open()) throw std::runtime_error("Could not open cache file " + tmp_path);
+        int32_t state_bits = init.space.state_bits;
+        uint64_t n_fair = trans.fairness.size();
+        write_header(out, model_magic, key);
+        out.write(reinterpret_cast<const char*>(&state_bits), sizeof(state_bits));
+        out.write(reinterpret_cast<const char*>(&n_fair), sizeof(n_fair));
+        std::vector<BDD> bdds;
+        bdds.push_back(init.get_bdd());
+        bdds.push_back(trans.t_u_v);
+        for(std::vector<Predicate>::const_iterator i = trans.fairness.begin(); 
+                i != trans.fairness.end(); ++i)
+            bdds.push_back(i->get_bdd());
+        BDD::save(out, bdds);
+        if(!out)
+        {
+            out.close();
+            std::remove(tmp_path.c_str());
+            throw std::runtime_error("Could not write cache file " + tmp_path);
+        }
+    }
+    commit_entry(tmp_path, final_path);
+}
+
+
+
+/**
+ * Impl ResultCache
+ */
+ResultCache::ResultCache(const std::string& d) : dir(d) {}
+
+std::string ResultCache::path(const std::string& key) const { return entry_path(dir, key, ".result"); }
+
+/**
+ * Read a string stored as its length followed by its bytes, returns false if the stream ends first
+ */
+static bool read_string(std::istream& in, std::string& str)
+{
+    uint64_t len;
+    if(!in.read(reinterpret_cast<char*>(&len), sizeof(len))) return false;
+    str.assign(len, '\0');
+    return len == 0 || in.read(&str[0], len);
+}
+
+/**
+ * Write a string as its length followed by its bytes
+ */
+static void write_string(std::ostream& out, const std::string& str)
+{
+    uint64_t len = str.size();
+    out.write(reinterpret_cast<const char*>(&len), sizeof(len));
+    out.write(str.data(), str.size());
+}
+
+bool ResultCache::load(const std::string& key, bool& sat, std::string& report, 
+                       std::string& trace) const
+{
+    std::ifstream in(path(key), std::ios::binary);
+    if(!in.is_open() || !read_header(in, result_magic, key)) return false;
+    try
+    {
+        char verdict;
+        std::string file_report, file_trace;
+        if(!in.read(&verdict, 1) || !read_string(in, file_report) || !read_string(in, file_trace))
+            return false;
+        sat = verdict != 0;
+        report = file_report;
+        trace = file_trace;
+        return true;
+    }
+    catch(const std::exception& e) { return false; }      // Corrupt length may fail to allocate
+}
+
+void ResultCache::store(const std::string& key, bool sat, const std::string& report, 
+                        const std::string& trace) const
+{
+    make_dir(dir);
+    std::string final_path = path(key);
+    std::string tmp_path = temp_path(final_path);
+    {
+        std::ofstream out(tmp_path, std::ios::binary);
+        if(!out.is_open()) throw std::runtime_error("Could not open cache file " + tmp_path);
+        write_header(out, result_magic, key);
+        char verdict = sat ? 1 : 0;
+        out.write(&verdict, 1);
+        write_string(out, report);
+        write_string(out, trace);
+        if(!out)
+        {
+            out.close();
+            std::remove(tmp_path.c_str());
+            throw std::runtime_error("Could not write cache file " + tmp_path);
+        }
+    }
+    commit_entry(tmp_path, final_path);
+}
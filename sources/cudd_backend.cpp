@@ -0,0 +1,176 @@
+/**
+ * This file implements the CUDD backend declared in `headers/cudd_backend.hpp`.
+ */
+
+#include "headers/cudd_backend.hpp"
+
+// For some reason cudd needs declarations in these headers but does not include these within
+// cudd.h.....
+#include <cstdio>
+#include <cstdlib>
+extern "C"
+{
+    #include <sys/types.h>
+    #include "cudd.h"
+}
+
+#include <algorithm>
+#include <stdexcept>
+
+
+
+// Conversions between handles and nodes
+static inline DdNode* dd(BDDBackend::Node nd) { return reinterpret_cast<DdNode*>(nd); }
+static inline BDDBackend::Node handle(DdNode* nd) { return reinterpret_cast<BDDBackend::Node>(nd); }
+
+// Check the result of a CUDD operation
+static inline BDDBackend::Node checked(DdNode* nd, const char* op)
+{
+    if(!nd) throw std::runtime_error(std::string(op) + " of DdNodes returned null");
+    return handle(nd);
+}
+
+
+// Ctor and dtor
+CuddBackend::CuddBackend() : manager(Cudd_Init(0, 0, CUDD_UNIQUE_SLOTS, CUDD_CACHE_SLOTS, 0))
+{
+    if(!manager) throw std::runtime_error("Could not initialize CUDD manager");
+}
+
+CuddBackend::~CuddBackend()
+{
+    Cudd_Quit(manager);
+}
+
+BDDBackend* CuddBackend::create() const { return new CuddBackend(); }
+
+
+// Constants and variables
+BDDBackend::Node CuddBackend::constant(bool value)
+{
+    return handle(value ? Cudd_ReadOne(manager) : Cudd_ReadLogicZero(manager));
+}
+BDDBackend::Node CuddBackend::var(int index)
+{
+    return checked(Cudd_bddIthVar(manager, index), "Variable");
+}
+int CuddBackend::num_vars() { return Cudd_ReadSize(manager); }
+BDDBackend::Node CuddBackend::cube(const std::vector<int>& values)
+{
+    // CUDD wants a value for every variable, so the variables of the cube are created first
+    if((int) values.size() > Cudd_ReadSize(manager)) var(values.size() - 1);
+    std::vector<int> full(Cudd_ReadSize(manager), 2);
+    std::copy(values.begin(), values.end(), full.begin());
+    return checked(Cudd_CubeArrayToBdd(manager, full.data()), "Cube");
+}
+
+void CuddBackend::ref(Node nd) { Cudd_Ref(dd(nd)); }
+void CuddBackend::deref(Node nd) { Cudd_RecursiveDeref(manager, dd(nd)); }
+
+
+// Operations
+BDDBackend::Node CuddBackend::negate(Node f) { return handle(Cudd_Not(dd(f))); }
+BDDBackend::Node CuddBackend::apply_and(Node f, Node g)
+{
+    return checked(Cudd_bddAnd(manager, dd(f), dd(g)), "And");
+}
+BDDBackend::Node CuddBackend::apply_or(Node f, Node g)
+{
+    return checked(Cudd_bddOr(manager, dd(f), dd(g)), "Or");
+}
+BDDBackend::Node CuddBackend::apply_xor(Node f, Node g)
+{
+    return checked(Cudd_bddXor(manager, dd(f), dd(g)), "Xor");
+}
+BDDBackend::Node CuddBackend::ite(Node f, Node g, Node h)
+{
+    return checked(Cudd_bddIte(manager, dd(f), dd(g), dd(h)), "Ite");
+}
+bool CuddBackend::leq(Node f, Node g) { return Cudd_bddLeq(manager, dd(f), dd(g)); }
+BDDBackend::Node CuddBackend::exists(Node f, Node cube)
+{
+    return checked(Cudd_bddExistAbstract(manager, dd(f), dd(cube)), "Existential abstraction");
+}
+BDDBackend::Node CuddBackend::forall(Node f, Node cube)
+{
+    return checked(Cudd_bddUnivAbstract(manager, dd(f), dd(cube)), "Universal abstraction");
+}
+BDDBackend::Node CuddBackend::and_exists(Node f, Node g, Node cube)
+{
+    return checked(Cudd_bddAndAbstract(manager, dd(f), dd(g), dd(cube)), "And abstraction");
+}
+BDDBackend::Node CuddBackend::restrict(Node f, Node care)
+{
+    return checked(Cudd_bddRestrict(manager, dd(f), dd(care)), "Restrict");
+}
+BDDBackend::Node CuddBackend::permute(Node f, const std::vector<int>& perm)
+{
+    // CUDD wants an entry for every variable, so variables moved to are created first
+    int top = perm.empty() ? -1 : *std::max_element(perm.begin(), perm.end());
+    if(top >= Cudd_ReadSize(manager)) var(top);
+    std::vector<int> full(Cudd_ReadSize(manager));
+    for(size_t i = 0; i < full.size(); ++i) full[i] = i < perm.size() ? perm[i] : i;
+    return checked(Cudd_bddPermute(manager, dd(f), full.data()), "Permute");
+}
+
+
+// Structure
+bool CuddBackend::is_complement(Node nd) { return Cudd_IsComplement(dd(nd)); }
+BDDBackend::Node CuddBackend::regular(Node nd) { return handle(Cudd_Regular(dd(nd))); }
+bool CuddBackend::is_constant(Node nd) { return Cudd_IsConstant(Cudd_Regular(dd(nd))); }
+int CuddBackend::var_index(Node nd) { return Cudd_NodeReadIndex(dd(nd)); }
+BDDBackend::Node CuddBackend::then_child(Node nd) { return handle(Cudd_T(dd(nd))); }
+BDDBackend::Node CuddBackend::else_child(Node nd) { return handle(Cudd_E(dd(nd))); }
+
+std::vector<int> CuddBackend::support(Node f)
+{
+    int* indices;
+    int n = Cudd_SupportIndices(manager, dd(f), &indices);
+    if(n < 0) throw std::runtime_error("Could not compute support of BDD");
+    std::vector<int> ret(indices, indices + n);
+    free(indices);
+    return ret;
+}
+
+size_t CuddBackend::node_count(Node f) { return Cudd_DagSize(dd(f)); }
+
+void CuddBackend::for_each_cube(Node f, const std::function<bool(const std::vector<int>&)>& visit)
+{
+    if(dd(f) == Cudd_ReadLogicZero(manager)) return;
+    int* raw_cube;  // This will be managed by the returned DdGen struct, freed by Cudd_GenFree()
+    CUDD_VALUE_TYPE val;
+    DdGen* gen = Cudd_FirstCube(manager, dd(f), &raw_cube, &val);
+    if(!gen) throw std::runtime_error("First cube returns null generator");
+    std::vector<int> cube(Cudd_ReadSize(manager));
+    do
+    {
+        cube.assign(raw_cube, raw_cube + cube.size());
+        if(!visit(cube)) break;
+    }
+    while(Cudd_NextCube(gen, &raw_cube, &val));
+    Cudd_GenFree(gen);
+}
+
+void CuddBackend::save_dot(Node f, bool draw_0_arc, const std::string& filename)
+{
+    DdNode* nd = draw_0_arc ? dd(f) : Cudd_BddToAdd(manager, dd(f));  // Node to draw
+    FILE* file = fopen(filename.c_str(), "w");                      // using c-file for compat
+    if(!file) throw std::runtime_error("Could not open file " + filename);
+    Cudd_DumpDot(manager, 1, &nd, NULL, NULL, file);
+    if(fclose(file) != 0) throw std::runtime_error("Could not safely close file " + filename);
+}
+
+ManagerStats CuddBackend::read_stats()
+{
+    ManagerStats st;
+    st.live_nodes       = Cudd_ReadNodeCount(manager);
+    st.peak_nodes       = Cudd_ReadPeakNodeCount(manager);
+    st.cache_lookups    = Cudd_ReadCacheLookUps(manager);
+    st.cache_hits       = Cudd_ReadCacheHits(manager);
+    st.gc_count         = Cudd_ReadGarbageCollections(manager);
+    st.gc_time          = Cudd_ReadGarbageCollectionTime(manager);
+    st.reorder_count    = Cudd_ReadReorderings(manager);
+    st.reorder_time     = Cudd_ReadReorderingTime(manager);
+    st.memory_in_use    = Cudd_ReadMemoryInUse(manager);
+    return st;
+}
@@ -0,0 +1,357 @@
+/**
+ * Implements the explicit state sets and graphs declared in `headers/explicit.hpp`.
+ */
+
+#include "headers/explicit.hpp"
+
+#include <algorithm>
+#include <bitset>
+#include <stdexcept>
+
+
+
+/**
+ * Impl StateSet
+ */
+
+StateSet::StateSet(size_t size, bool full)
+    : n_states(size), words((size + 63) / 64, full ? ~uint64_t(0) : 0)
+{
+    if(full && size % 64) words.back() = (uint64_t(1) << (size % 64)) - 1;
+}
+
+StateSet& StateSet::operator&=(const StateSet& other)
+{
+    for(size_t i = 0; i < words.size(); ++i) words[i] &= other.words[i];
+    return *this;
+}
+StateSet& StateSet::operator|=(const StateSet& other)
+{
+    for(size_t i = 0; i < words.size(); ++i) words[i] |= other.words[i];
+    return *this;
+}
+StateSet& StateSet::operator^=(const StateSet& other)
+{
+    for(size_t i = 0; i < words.size(); ++i) words[i] ^= other.words[i];
+    return *this;
+}
+StateSet StateSet::operator~() const
+{
+    StateSet ret(n_states, true);
+    for(size_t i = 0; i < words.size(); ++i) ret.words[i] &= ~words[i];
+    return ret;
+}
+
+bool operator==(const StateSet& setl, const StateSet& setr) { return setl.words == setr.words; }
+bool operator!=(const StateSet& setl, const StateSet& setr) { return setl.words != setr.words; }
+
+bool StateSet::subset_of(const StateSet& other) const
+{
+    for(size_t i = 0; i < words.size(); ++i) if(words[i] & ~other.words[i]) return false;
+    return true;
+}
+bool StateSet::intersects(const StateSet& other) const
+{
+    for(size_t i = 0; i < words.size(); ++i) if(words[i] & other.words[i]) return true;
+    return false;
+}
+bool StateSet::empty() const
+{
+    for(size_t i = 0; i < words.size(); ++i) if(words[i]) return false;
+    return true;
+}
+size_t StateSet::count() const
+{
+    size_t ret = 0;
+    for(size_t i = 0; i < words.size(); ++i) ret += std::bitset<64>(words[i]).count();
+    return ret;
+}
+
+void StateSet::swap(StateSet& other)
+{
+    std::swap(n_states, other.n_states);
+    words.swap(other.words);
+}
+
+
+
+/**
+ * Impl ExplicitGraph
+ */
+
+ExplicitGraph::ExplicitGraph(const StateSpace& sp) : space(sp), succ_start(1, 0), pred_start(1, 0)
+{
+    for(int i = 0; i < space.state_bits; ++i) u_vars.push_back(i * 2);
+}
+
+// Visit every subset of the bits in mask, added to base
+template<class F> static void for_each_subset(uint32_t base, uint32_t mask, F visit)
+{
+    for(uint32_t sub = mask; ; sub = (sub - 1) & mask)
+    {
+        visit(base | sub);
+        if(!sub) break;
+    }
+}
+
+bool ExplicitGraph::build(const BDD& t_u_v, size_t max_edges)
+{
+    if(space.state_bits > 30) return false;
+    std::vector<int> in_vars;
+    for(int j = 0; j < space.input_bits; ++j) in_vars.push_back(space.state_bits * 2 + j);
+    BDD rel = in_vars.empty() ? t_u_v : t_u_v.existential_abstraction(in_vars);
+
+    // Each cube of the relation fixes some bits of the states it goes from and to, and is the
+    // product of the states agreeing with it on each side. The cubes are disjoint, so each edge
+    // is found once. The first pass counts the edges of each state, and the second fills them in.
+    size_t n = size_t(1) << space.state_bits;
+    std::vector<uint32_t> out_deg(n + 1, 0), in_deg(n + 1, 0);
+    size_t edges = 0;
+    for(int pass = 0; pass < 2 && edges <= max_edges; ++pass)
+    {
+        rel.for_each_cube([&](const std::vector<int>& cube)
+        {
+            uint32_t u_fixed = 0, u_free = 0, v_fixed = 0, v_free = 0;
+            for(int i = 0; i < space.state_bits; ++i)
+            {
+                uint32_t bit = uint32_t(1) << i;
+                if(cube[i * 2] == 2) u_free |= bit;
+                else if(cube[i * 2]) u_fixed |= bit;
+                if(cube[i * 2 + 1] == 2) v_free |= bit;
+                else if(cube[i * 2 + 1]) v_fixed |= bit;
+            }
+            size_t n_u = size_t(1) << std::bitset<32>(u_free).count();
+            size_t n_v = size_t(1) << std::bitset<32>(v_free).count();
+            if(pass == 0)
+            {
+                edges += n_u * n_v;
+                if(edges > max_edges) return false;
+                for_each_subset(u_fixed, u_free, [&](uint32_t u) { out_deg[u] += n_v; });
+                for_each_subset(v_fixed, v_free, [&](uint32_t v) { in_deg[v] += n_u; });
+                return true;
+            }
+            for_each_subset(u_fixed, u_free, [&](uint32_t u)
+            {
+                for_each_subset(v_fixed, v_free, [&](uint32_t v)
+                {
+                    succs[--out_deg[u]] = v;
+                    preds[--in_deg[v]] = u;
+                });
+            });
+            return true;
+        });
+        if(pass == 0 && edges <= max_edges)
+        {
+            // Turn the degrees into the end of the list of each state, which the second pass
+            // counts down to its start
+            for(size_t s = 1; s <= n; ++s)
+            {
+                out_deg[s] += out_deg[s - 1];
+                in_deg[s] += in_deg[s - 1];
+            }
+            succs.resize(edges);
+            preds.resize(edges);
+        }
+    }
+    if(edges > max_edges)
+    {
+        succs.clear();
+        preds.clear();
+        return false;
+    }
+    succ_start.swap(out_deg);
+    pred_start.swap(in_deg);
+    return true;
+}
+
+// Conversions
+StateSet ExplicitGraph::to_set(const Predicate& pred) const
+{
+    StateSet ret;
+    ret.n_states = num_states();
+    ret.words = pred.get_bdd().truth_table(u_vars);
+    return ret;
+}
+Predicate ExplicitGraph::to_pred(const StateSet& set) const
+{
+    return Predicate(space, BDD::from_truth_table(u_vars, set.words), true);
+}
+
+// Images
+StateSet ExplicitGraph::EX(const StateSet& set) const
+{
+    StateSet ret(num_states());
+    for(size_t s = 0; s < num_states(); ++s)
+        for(uint32_t e = succ_start[s]; e < succ_start[s + 1]; ++e)
+            if(set.test(succs[e])) { ret.set(s); break; }
+    return ret;
+}
+StateSet ExplicitGraph::AX(const StateSet& set) const
+{
+    StateSet ret(num_states(), true);
+    for(size_t s = 0; s < num_states(); ++s)
+        for(uint32_t e = succ_start[s]; e < succ_start[s + 1]; ++e)
+            if(!set.test(succs[e])) { ret.reset(s); break; }
+    return ret;
+}
+StateSet ExplicitGraph::post(const StateSet& set) const
+{
+    StateSet ret(num_states());
+    for(size_t w = 0; w < set.words.size(); ++w)
+    {
+        if(!set.words[w]) continue;
+        for(size_t s = w * 64; s < std::min(num_states(), w * 64 + 64); ++s)
+            if(set.test(s))
+                for(uint32_t e = succ_start[s]; e < succ_start[s + 1]; ++e) ret.set(succs[e]);
+    }
+    return ret;
+}
+
+// Forward search
+bool ExplicitGraph::search(const StateSet& init, const StateSet* target, StateSet& reached,
+                           const std::function<void(const StateSet&, const StateSet&,
+                                                    const StateSet&)>& step) const
+{
+    reached = init;
+    StateSet layer = init;
+    while(!(target && layer.intersects(*target)))
+    {
+        StateSet next_layer = post(layer) & ~reached;
+        if(next_layer.empty()) return false;
+        StateSet nxt = reached | next_layer;
+        step(reached, nxt, next_layer);
+        reached.swap(nxt);
+        layer.swap(next_layer);
+    }
+    return true;
+}
+
+// Fixpoints by frontiers
+StateSet ExplicitGraph::fixpoint(const StateSet& setl, const StateSet& setr, bool universal, 
+                                 bool least, const StateSet* init, size_t& iterations,
+                                 const std::function<void(const StateSet&, const StateSet&)>& step)
+                                 const
+{
+    // A state can only change once, when X acc changes at it. For AX in a least fixpoint and EX
+    // in a greatest one this is when the last successor outside (or inside) acc changes, so
+    // `count` tracks how many are left. Otherwise it is when the first successor changes.
+    size_t n = num_states();
+    bool counted = universal == least;
+    std::vector<uint32_t> count;
+    if(counted)
+        for(size_t s = 0; s < n; ++s) count.push_back(succ_start[s + 1] - succ_start[s]);
+    StateSet acc(n, !least);
+    StateSet nxt;
+    std::vector<uint32_t> frontier, changed;
+    iterations = 0;
+    while(!(init && init->subset_of(acc) == least))
+    {
+        if(iterations == 0)
+        {
+            // The first iterate is computed directly
+            StateSet x = universal ? AX(acc) : EX(acc);
+            nxt = least ? (setr | (setl & x)) : (setr & (setl | x));
+            for(size_t s = 0; s < n; ++s) if(nxt.test(s) != acc.test(s)) changed.push_back(s);
+        }
+        else
+        {
+            nxt = acc;
+            for(size_t i = 0; i < frontier.size(); ++i)
+                for(uint32_t e = pred_start[frontier[i]]; e < pred_start[frontier[i] + 1]; ++e)
+                {
+                    uint32_t p = preds[e];
+                    bool ready = !counted || --count[p] == 0;
+                    // Only states in acc and not in setl can leave a greatest fixpoint, and only
+                    // states not in acc and in setl can join a least one
+                    if(!ready || acc.test(p) == least || setl.test(p) != least || 
+                       nxt.test(p) != acc.test(p)) 
+                        continue;
+                    if(least) nxt.set(p);
+                    else nxt.reset(p);
+                    changed.push_back(p);
+                }
+        }
+        if(changed.empty()) break;
+        ++iterations;
+        step(acc, nxt);
+        acc.swap(nxt);
+        frontier.swap(changed);
+        changed.clear();
+    }
+    return acc;
+}
+
+// Fair states by strongly connected components
+StateSet ExplicitGraph::EG_fair(const StateSet& set, const std::vector<StateSet>& fairness) const
+{
+    // Tarjan's algorithm on the graph restricted to set, with an explicit stack of the states
+    // being visited and the next edge of each to follow
+    const uint32_t unvisited = ~uint32_t(0);
+    size_t n = num_states();
+    std::vector<uint32_t> index(n, unvisited), low(n);
+    StateSet on_stack(n);
+    std::vector<uint32_t> component;
+    std::vector<std::pair<uint32_t, uint32_t> > frames;
+    StateSet fair(n);
+    uint32_t counter = 0;
+    for(uint32_t root = 0; root < n; ++root)
+    {
+        if(!set.test(root) || index[root] != unvisited) continue;
+        index[root] = low[root] = counter++;
+        component.push_back(root);
+        on_stack.set(root);
+        frames.push_back(std::make_pair(root, succ_start[root]));
+        while(!frames.empty())
+        {
+            uint32_t v = frames.back().first;
+            uint32_t& e = frames.back().second;
+            if(e < succ_start[v + 1])
+            {
+                uint32_t w = succs[e++];
+                if(!set.test(w)) continue;
+                if(index[w] == unvisited)
+                {
+                    index[w] = low[w] = counter++;
+                    component.push_back(w);
+                    on_stack.set(w);
+                    frames.push_back(std::make_pair(w, succ_start[w]));
+                }
+                else if(on_stack.test(w)) low[v] = std::min(low[v], index[w]);
+                continue;
+            }
+            frames.pop_back();
+            if(!frames.empty()) low[frames.back().first] = std::min(low[frames.back().first], low[v]);
+            if(low[v] != index[v]) continue;
+
+            // v is the root of a component, which is on top of the stack. It is fair if it has an
+            // edge, so that paths can stay in it forever, and meets every fairness set.
+            size_t begin = component.size();
+            while(component[--begin] != v) {}
+            bool has_edge = component.size() - begin > 1;
+            for(uint32_t e = succ_start[v]; e < succ_start[v + 1] && !has_edge; ++e)
+                has_edge = succs[e] == v;
+            std::vector<bool> met(fairness.size(), false);
+            for(size_t i = begin; i < component.size(); ++i)
+                for(size_t f = 0; f < fairness.size(); ++f)
+                    met[f] = met[f] || fairness[f].test(component[i]);
+            bool is_fair = has_edge && std::find(met.begin(), met.end(), false) == met.end();
+            for(size_t i = begin; i < component.size(); ++i)
+            {
+                on_stack.reset(component[i]);
+                if(is_fair) fair.set(component[i]);
+            }
+            component.resize(begin);
+        }
+    }
+
+    // The states that reach a fair component within set
+    std::vector<uint32_t> queue;
+    for(uint32_t s = 0; s < n; ++s) if(fair.test(s)) queue.push_back(s);
+    for(size_t i = 0; i < queue.size(); ++i)
+        for(uint32_t e = pred_start[queue[i]]; e < pred_start[queue[i] + 1]; ++e)
+        {
+            uint32_t p = preds[e];
+            if(set.test(p) && !fair.test(p)) { fair.set(p); queue.push_back(p); }
+        }
+    return fair;
+}
@@ -5,15 +5,29 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <cstdio>
 #include <cstdlib>
 #include <exception>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <thread>
 
-#include "cudd.h"
-#define SEXPRESSO_OPT_OUT_PIKESTYLE
-#include "sexpresso/sexpresso.hpp"
-
+#include "headers/sexpr.hpp"
 #include "headers/bdd.hpp"
+#include "headers/parallel_bdd.hpp"
 #include "headers/pred.hpp"
+#include "headers/stats.hpp"
+#include "headers/profile.hpp"
+#include "headers/progress.hpp"
+#include "headers/cache.hpp"
+#include "headers/word.hpp"
+#include "headers/aiger.hpp"
+#include "headers/trace.hpp"
 
 
 
@@ -22,703 +36,2427 @@
  */
 void print_usage()
 {
-    std::cout <<   "usage: cudd-ctl-mc <spec_path>"                                 << std::endl;
+    std::cout <<   "usage: cudd-ctl-mc [options] <spec_path>"                       << std::endl;
     std::cout <<   "where:"                                                         << std::endl;
     std::cout <<   "    spec_path       -   the path to model and property"         << std::endl;
     std::cout <<   "                        specification"                          << std::endl;
+    std::cout <<   "options:"                                                       << std::endl;
+    std::cout <<   "    --stats=json    -   write performance statistics for each"  << std::endl;
+    std::cout <<   "                        property as a line of json"             << std::endl;
+    std::cout <<   "    --stats-file=<path>"                                        << std::endl;
+    std::cout <<   "                    -   file to write statistics to, defaults"  << std::endl;
+    std::cout <<   "                        to stderr"                              << std::endl;
+    std::cout <<   "    --profile       -   print a table of the time, iterations"  << std::endl;
+    std::cout <<   "                        and result size of each CTL subformula" << std::endl;
+    std::cout <<   "    --profile-trace=<path>"                                     << std::endl;
+    std::cout <<   "                    -   also write a Chrome trace event json"   << std::endl;
+    std::cout <<   "                        timeline of the profile to path"        << std::endl;
+    std::cout <<   "    --progress[=<seconds>]"                                     << std::endl;
+    std::cout <<   "                    -   report progress of fixpoints on stderr" << std::endl;
+    std::cout <<   "                        every 10 or given seconds, and on"      << std::endl;
+    std::cout <<   "                        SIGUSR1. 0 seconds reports only on"     << std::endl;
+    std::cout <<   "                        SIGUSR1"                                << std::endl;
+    std::cout <<   "    --model-cache=<dir>"                                        << std::endl;
+    std::cout <<   "                    -   reuse the BDDs for the model built by"  << std::endl;
+    std::cout <<   "                        earlier runs, storing them in dir"      << std::endl;
+    std::cout <<   "    --result-cache=<dir>"                                       << std::endl;
+    std::cout <<   "                    -   reuse results of properties checked by" << std::endl;
+    std::cout <<   "                        earlier runs on the same model, storing" << std::endl;
+    std::cout <<   "                        them in dir"                            << std::endl;
+    std::cout <<   "    --no-cone       -   check properties over all of the state"  << std::endl;
+    std::cout <<   "                        instead of their cone of influence"     << std::endl;
+    std::cout <<   "    --care-set      -   evaluate subformulae only on states"    << std::endl;
+    std::cout <<   "                        reachable from the initial states"      << std::endl;
+    std::cout <<   "                        where they can affect the result"       << std::endl;
+    std::cout <<   "    --one-relation  -   keep the transition relation in one"    << std::endl;
+    std::cout <<   "                        direction only, renaming states to"     << std::endl;
+    std::cout <<   "                        compute images in the other"            << std::endl;
+    std::cout <<   "    --explicit-bits=<n>"                                        << std::endl;
+    std::cout <<   "                    -   check models with at most n state bits" << std::endl;
+    std::cout <<   "                        on an explicit graph of their states"   << std::endl;
+    std::cout <<   "                        instead of BDDs, 16 by default"         << std::endl;
+    std::cout <<   "    --bdd=<cudd|parallel>"                                      << std::endl;
+    std::cout <<   "                    -   BDD package to use, cudd by default"    << std::endl;
+    std::cout <<   "    --bdd-threads=<n>"                                          << std::endl;
+    std::cout <<   "                    -   threads used by the parallel BDD"       << std::endl;
+    std::cout <<   "                        package, all cores by default"          << std::endl;
+    std::cout <<   "    --threads=<n>   -   threads that the fairness constraints"  << std::endl;
+    std::cout <<   "                        of fair CTL and wide transition"        << std::endl;
+    std::cout <<   "                        relations are spread over, each with"   << std::endl;
+    std::cout <<   "                        its own BDDs, all cores by default"     << std::endl;
+    std::cout <<   "    --trace-format=<text|vcd|json|binary>"                      << std::endl;
+    std::cout <<   "                    -   format of witnesses and"                << std::endl;
+    std::cout <<   "                        counterexamples, text by default. The"  << std::endl;
+    std::cout <<   "                        others are written to files"            << std::endl;
+    std::cout <<   "    --trace-dir=<dir>"                                          << std::endl;
+    std::cout <<   "                    -   directory to write them to, the"        << std::endl;
+    std::cout <<   "                        current one by default"                 << std::endl;
+    std::cout <<   "    --simulate[=<n>]"                                           << std::endl;
+    std::cout <<   "                    -   look for violations of invariants on n" << std::endl;
+    std::cout <<   "                        random runs, 1000 by default, before"   << std::endl;
+    std::cout <<   "                        checking them symbolically"             << std::endl;
+    std::cout <<   "    --simulate-depth=<n>"                                       << std::endl;
+    std::cout <<   "                    -   steps of each random run, 100 by"       << std::endl;
+    std::cout <<   "                        default"                                << std::endl;
+    std::cout <<   "    --witness-seed=<n>"                                         << std::endl;
+    std::cout <<   "                    -   pick the states of witnesses and"       << std::endl;
+    std::cout <<   "                        counterexamples at random, seeded by n" << std::endl;
 }
 
 
 
 /**
- * we firstly parse the command line arguements into the following parameters
- *
- * spec_path        -   a string with the path to the filename from where to load the model and
- *                      property specifications.
- *
- * returns true if arguments were successfully parsed. else, prints out command line usage and
- * returns false.
+ * Command line options, see print_usage for their meaning
  */
-bool parse_args(int argc, char** argv, std::string& spec_path)
+struct Options
 {
-    if(argc < 2) { print_usage(); return false; }
-    spec_path = argv[1];
-    return true;
-}
+    std::string spec_path;      // Path to model and property specification
+    bool stats_json;            // Write out statistics as json
+    std::string stats_path;     // File to write statistics to, stderr if empty
+    bool profile;               // Profile evaluation of CTL subformulae
+    std::string trace_path;     // File to write profile timeline to, none if empty
+    bool progress;              // Report progress on stderr
+    double progress_interval;   // Seconds between progress reports
+    std::string cache_dir;      // Directory to cache model BDDs in, no caching if empty
+    std::string result_dir;     // Directory to cache property results in, no caching if empty
+    bool cone;                  // Reduce the model to the cone of influence of each property
+    bool care;                  // Evaluate subformulae only on the states that can matter
+    bool one_relation;          // Keep the transition relation in one direction only
+    int explicit_bits;          // Largest number of state bits checked on an explicit graph
+    std::string backend;        // BDD package, cudd or parallel
+    unsigned bdd_threads;       // Threads used by the parallel BDD package
+    unsigned threads;           // Threads independent BDD computations are spread over
+    std::string trace_format;   // Format of witnesses and counterexamples
+    std::string trace_dir;      // Directory to write them to, unless they are text
+    size_t simulate_runs;       // Random runs to look for violations of invariants on, or 0
+    size_t simulate_depth;      // Steps of each
+    bool random_witness;        // Pick witness states at random
+    unsigned long long witness_seed;    // Seed for picking them
+
+    Options() : stats_json(false), profile(false), progress(false), progress_interval(10), 
+                cone(true), care(false), one_relation(false), explicit_bits(16), backend("cudd"),
+                bdd_threads(std::max(1u, std::thread::hardware_concurrency())),
+                threads(bdd_threads), trace_format("text"), trace_dir("."), simulate_runs(0),
+                simulate_depth(100), random_witness(false), witness_seed(0) {}
+};
+
 
 
 /**
- * Parse the given s-expr into a predicate. throws a runtime_error containing string representation
- * of problematic s-expr on failure.
+ * we firstly parse the command line arguements into the options given above.
+ *
+ * returns true if arguments were successfully parsed. else, prints out command line usage and
+ * returns false.
  */
-Predicate parse_predicate(const StateSpace& sp, const sexpresso::Sexp& expr)
+bool parse_args(int argc, char** argv, Options& opts)
 {
-    if(expr.isString())
-    {
-        if(expr.value.str == "true")        return Predicate(sp, true);
-        else if(expr.value.str == "false")  return Predicate(sp, false);
-
-        std::cout << "Constant predicate must be true or false" << std::endl;
-        throw std::runtime_error(expr.toString());
-    }
-    const std::string& fn = expr.value.sexp[0].value.str;
-    if(fn == std::string("or"))
+    for(int i = 1; i < argc; i++)
     {
-        if(expr.childCount() < 3)
+        std::string arg = argv[i];
+        if(arg == "--stats=json")                       opts.stats_json = true;
+        else if(arg.compare(0, 13, "--stats-file=") == 0) opts.stats_path = arg.substr(13);
+        else if(arg == "--profile")                     opts.profile = true;
+        else if(arg.compare(0, 16, "--profile-trace=") == 0)
         {
-            std::cout << "Or takes atleast two arguments" << std::endl;
-            throw std::runtime_error(expr.toString());
+            opts.profile = true;
+            opts.trace_path = arg.substr(16);
         }
-        Predicate ret = parse_predicate(sp, expr.value.sexp[1]);
-        for(size_t i = 2; i < expr.childCount(); i++) ret |= parse_predicate(sp, expr.value.sexp[i]);
-        return ret;
-    }
-    else if(fn == std::string("and"))
-    {
-        if(expr.childCount() < 3)
+        else if(arg.compare(0, 14, "--model-cache=") == 0) opts.cache_dir = arg.substr(14);
+        else if(arg.compare(0, 15, "--result-cache=") == 0) opts.result_dir = arg.substr(15);
+        else if(arg == "--progress")                    opts.progress = true;
+        else if(arg == "--no-cone")                     opts.cone = false;
+        else if(arg == "--care-set")                    opts.care = true;
+        else if(arg == "--one-relation")                opts.one_relation = true;
+        else if(arg.compare(0, 16, "--explicit-bits=") == 0)
         {
-            std::cout << "And takes atleast two arguments" << std::endl;
-            throw std::runtime_error(expr.toString());
+            try { opts.explicit_bits = std::stoi(arg.substr(16)); }
+            catch(const std::exception& e)
+            {
+                std::cout << "Explicit state bits must be a number" << std::endl;
+                return false;
+            }
         }
-        Predicate ret = parse_predicate(sp, expr.value.sexp[1]);
-        for(size_t i = 2; i < expr.childCount(); i++) ret &= parse_predicate(sp, expr.value.sexp[i]);
-        return ret;
-    }
-    else if(fn == std::string("xor"))
-    {
-        if(expr.childCount() < 3)
+        else if(arg.compare(0, 6, "--bdd=") == 0)
         {
-            std::cout << "Xor takes atleast two arguments" << std::endl;
-            throw std::runtime_error(expr.toString());
+            opts.backend = arg.substr(6);
+            if(opts.backend != "cudd" && opts.backend != "parallel")
+            {
+                std::cout << "Unknown BDD package " << opts.backend << std::endl;
+                return false;
+            }
         }
-        Predicate ret = parse_predicate(sp, expr.value.sexp[1]);
-        for(size_t i = 2; i < expr.childCount(); i++) ret ^= parse_predicate(sp, expr.value.sexp[i]);
-        return ret;
-    }
-    else if(fn == std::string("not"))
-    {
-        if(expr.childCount() != 2)
+        else if(arg.compare(0, 14, "--bdd-threads=") == 0)
         {
-            std::cout << "Not takes exactly one argument" << std::endl;
-            throw std::runtime_error(expr.toString());
+            int threads = 0;
+            try { threads = std::stoi(arg.substr(14)); }
+            catch(const std::exception& e) {}
+            if(threads < 1)
+            {
+                std::cout << "BDD threads must be a positive number" << std::endl;
+                return false;
+            }
+            opts.bdd_threads = threads;
         }
-        return !parse_predicate(sp, expr.value.sexp[1]);
-    }
-    else if(fn == std::string("var"))
-    {
-        if(!(expr.childCount() == 2 && expr.value.sexp[1].isString()))
+        else if(arg.compare(0, 10, "--threads=") == 0)
         {
-            std::cout << "variable expression must be of form (var <index>)" << std::endl;
-            throw std::runtime_error(expr.toString());
+            int threads = 0;
+            try { threads = std::stoi(arg.substr(10)); }
+            catch(const std::exception& e) {}
+            if(threads < 1)
+            {
+                std::cout << "Threads must be a positive number" << std::endl;
+                return false;
+            }
+            opts.threads = threads;
         }
-        int var_index;
-        try { var_index = std::stoi(expr.value.sexp[1].value.str); }
-        catch(const std::invalid_argument& e)
+        else if(arg.compare(0, 15, "--trace-format=") == 0)
         {
-            std::cout << "variable index must be an int" << std::endl;
-            throw std::runtime_error(expr.toString());
+            opts.trace_format = arg.substr(15);
+            if(opts.trace_format != "text" && opts.trace_format != "vcd" && 
+                    opts.trace_format != "json" && opts.trace_format != "binary")
+            {
+                std::cout << "Unknown trace format " << opts.trace_format << std::endl;
+                return false;
+            }
         }
-        catch(const std::out_of_range& e)
+        else if(arg.compare(0, 12, "--trace-dir=") == 0) opts.trace_dir = arg.substr(12);
+        else if(arg == "--simulate")                    opts.simulate_runs = 1000;
+        else if(arg.compare(0, 11, "--simulate=") == 0)
         {
-            std::cout << "variable index must be less than size of bit vector" << std::endl;
-            throw std::runtime_error(expr.toString());
+            long long runs = 0;
+            try { runs = std::stoll(arg.substr(11)); }
+            catch(const std::exception& e) {}
+            if(runs < 1)
+            {
+                std::cout << "Simulation runs must be a positive number" << std::endl;
+                return false;
+            }
+            opts.simulate_runs = runs;
         }
-        if(var_index >= sp.state_bits)
+        else if(arg.compare(0, 17, "--simulate-depth=") == 0)
         {
-            std::cout << "variable index must be less than size of bit vector" << std::endl;
-            throw std::runtime_error(expr.toString());
+            long long depth = -1;
+            try { depth = std::stoll(arg.substr(17)); }
+            catch(const std::exception& e) {}
+            if(depth < 0)
+            {
+                std::cout << "Simulation depth must be a number" << std::endl;
+                return false;
+            }
+            opts.simulate_depth = depth;
         }
-        return Predicate(sp, var_index);
+        else if(arg.compare(0, 15, "--witness-seed=") == 0)
+        {
+            opts.random_witness = true;
+            try { opts.witness_seed = std::stoull(arg.substr(15)); }
+            catch(const std::exception& e)
+            {
+                std::cout << "Witness seed must be a number" << std::endl;
+                return false;
+            }
+        }
+        else if(arg.compare(0, 11, "--progress=") == 0)
+        {
+            opts.progress = true;
+            try { opts.progress_interval = std::stod(arg.substr(11)); }
+            catch(const std::exception& e)
+            {
+                std::cout << "Progress interval must be a number of seconds" << std::endl;
+                return false;
+            }
+        }
+        else if(arg.compare(0, 2, "--") == 0 || !opts.spec_path.empty())
+        {
+            std::cout << "Unrecognized argument: " << arg << std::endl;
+            print_usage(); 
+            return false;
+        }
+        else opts.spec_path = arg;
     }
-    else
+    if(opts.spec_path.empty()) { print_usage(); return false; }
+    return true;
+}
+
+
+
+/**
+ * Stream parse errors are printed to on this thread. Threads building parts of a model in parallel
+ * hold theirs back until it is known which error comes first.
+ */
+thread_local std::ostream* parse_error_out = &std::cout;
+
+/**
+ * Print msg and throw a runtime_error giving the location in the source of the malformed
+ * expression starting at offset
+ */
+[[noreturn]] void parse_error(const Lexer& lex, size_t offset, const std::string& msg)
+{
+    *parse_error_out << msg << std::endl;
+    throw std::runtime_error("Malformed expression at " + lex.location(offset));
+}
+
+/**
+ * Parse the index of a variable from the given token, checking it is within the state space
+ */
+int parse_index(const StateSpace& sp, const Lexer& lex, const Token& tok)
+{
+    if(tok.kind != Token::ATOM) parse_error(lex, tok.offset, "Variable index must be an int");
+    int var_index;
+    try { var_index = std::stoi(tok.text.str()); }
+    catch(const std::invalid_argument& e)
+    {
+        parse_error(lex, tok.offset, "Variable index must be an int");
+    }
+    catch(const std::out_of_range& e)
     {
-        std::cout << "function in initial state predicate must be or, and, xor, var" << std::endl;
-        throw std::runtime_error(expr.toString());
+        parse_error(lex, tok.offset, "Variable index must be less than size of bit vector");
     }
+    if(var_index < 0 || var_index >= sp.state_bits)
+        parse_error(lex, tok.offset, "Variable index must be less than size of bit vector");
+    return var_index;
 }
 
 
 
 /**
- * parse the given s-expr into a transition. throws a string error on failure.
+ * Scopes of names introduced by define and let
+ */
+struct Scope;
+
+/**
+ * A named expression introduced by define or let. Only the offset of the expression in the source
+ * is kept, and it is built the first time the name is used. The result is shared by all later uses.
+ * As the same definition may be used as a predicate, a transition, a term or a property, a result
+ * is kept for each. A predicate built by a front end other than the specification reader, like the
+ * bad states of a circuit, is a definition with no source.
+ */
+struct Definition
+{
+    static const size_t NO_SOURCE = ~size_t(0);
+
+    const Scope* scope;                         // Scope the expression is evaluated in
+    size_t offset;                              // Start of the expression in the source
+    bool building;                              // Set while the expression is built or checked
+    std::unique_ptr<Predicate> pred;
+    std::unique_ptr<Transition> trans;
+    std::unique_ptr<PredWord> pred_term;
+    std::unique_ptr<TransWord> trans_term;
+    std::unique_ptr<SExpr> prop;                // Parsed property, once checked
+    std::unique_ptr<Predicate> prop_pred;       // Value of the property
+    std::unique_ptr<Predicate> prop_pred_fair;  // Value of the property under fairness
+};
+
+/**
+ * The names visible at some point in the source. The outermost scope holds the defines, and each
+ * let opens a scope extending the enclosing one. Names bound in the same scope may refer to each
+ * other in any order, but not recursively.
  */
-Transition parse_transition(const StateSpace& sp, const sexpresso::Sexp& expr)
+struct Scope
 {
-    if(expr.isString())
+    Lexer& lex;
+    const Scope* parent;
+    std::map<StrRef, std::unique_ptr<Definition> > defs;
+
+    Scope(Lexer& lex, const Scope* parent) : lex(lex), parent(parent) {}
+
+    /**
+     * Bind name to the expression at offset. Returns false if the name is already bound in this
+     * scope or is a constant.
+     */
+    bool bind(const StrRef& name, size_t offset)
     {
-        if(expr.value.str == "true")        return Transition(sp, true);
-        else if(expr.value.str == "false")  return Transition(sp, false);
+        if(name == "true" || name == "false" || defs.count(name)) return false;
+        std::unique_ptr<Definition> def(new Definition());
+        def->scope = this;
+        def->offset = offset;
+        def->building = false;
+        defs[name] = std::move(def);
+        return true;
+    }
 
-        std::cout << "constant in transition must be `true` or `false`" << std::endl;
-        throw std::runtime_error(expr.toString());
+    /**
+     * Bind name to a predicate built without a source expression. It can be used wherever a
+     * predicate or property is expected.
+     */
+    bool bind(const StrRef& name, const Predicate& pred)
+    {
+        if(!bind(name, Definition::NO_SOURCE)) return false;
+        defs[name]->pred.reset(new Predicate(pred));
+        defs[name]->prop_pred.reset(new Predicate(pred));
+        return true;
     }
-    const std::string& fn = expr.value.sexp[0].value.str;
-    if(fn == std::string("or"))
+
+    /**
+     * Find the innermost definition of name, NULL if there is none
+     */
+    Definition* find(const StrRef& name) const
     {
-        if(expr.childCount() < 3)
+        for(const Scope* sc = this; sc; sc = sc->parent)
         {
-            std::cout << "Or takes atleast two arguments" << std::endl;
-            throw std::runtime_error(expr.toString());
+            std::map<StrRef, std::unique_ptr<Definition> >::const_iterator i = sc->defs.find(name);
+            if(i != sc->defs.end()) return i->second.get();
         }
-        Transition ret = parse_transition(sp, expr.value.sexp[1]);
-        for(size_t i = 2; i < expr.childCount(); i++) ret |= parse_transition(sp, expr.value.sexp[i]);
-        return ret;
+        return NULL;
     }
-    else if(fn == std::string("and"))
+};
+
+/**
+ * Read the list of bindings `((name expr)..)` of a let from the lexer into scope, skipping over the
+ * expressions
+ */
+void read_bindings(Lexer& lex, Scope& scope)
+{
+    Token tok = lex.next();
+    if(tok.kind != Token::OPEN)
+        parse_error(lex, tok.offset, "Let must be of form (let ((name expr)..) body)");
+    while(lex.peek().kind != Token::CLOSE)
     {
-        if(expr.childCount() < 3)
-        {
-            std::cout << "And takes atleast two arguments" << std::endl;
-            throw std::runtime_error(expr.toString());
-        }
-        Transition ret = parse_transition(sp, expr.value.sexp[1]);
-        for(size_t i = 2; i < expr.childCount(); i++) ret &= parse_transition(sp, expr.value.sexp[i]);
-        return ret;
+        Token open = lex.next();
+        Token name = lex.next();
+        if(open.kind != Token::OPEN || name.kind != Token::ATOM)
+            parse_error(lex, open.offset, "Binding in let must be of form (name expr)");
+        if(!scope.bind(name.text, lex.peek().offset))
+            parse_error(lex, name.offset, "Name already bound or a constant: " + name.text.str());
+        lex.skip();
+        if(lex.next().kind != Token::CLOSE)
+            parse_error(lex, open.offset, "Binding in let must be of form (name expr)");
     }
-    else if(fn == std::string("xor"))
+    lex.next();
+}
+
+Predicate parse_predicate(const StateSpace& sp, Lexer& lex, const Scope& scope);
+Transition parse_transition(const StateSpace& sp, Lexer& lex, const Scope& scope);
+
+/**
+ * The predicate a definition stands for, built from the source on first use
+ */
+const Predicate& definition_predicate(const StateSpace& sp, Definition& def)
+{
+    if(!def.pred)
     {
-        if(expr.childCount() < 3)
-        {
-            std::cout << "Xor takes atleast two arguments" << std::endl;
-            throw std::runtime_error(expr.toString());
-        }
-        Transition ret = parse_transition(sp, expr.value.sexp[1]);
-        for(size_t i = 2; i < expr.childCount(); i++) ret ^= parse_transition(sp, expr.value.sexp[i]);
-        return ret;
+        Lexer& lex = def.scope->lex;
+        if(def.building) parse_error(lex, def.offset, "Definition refers to itself");
+        def.building = true;
+        size_t pos = lex.position();
+        lex.seek(def.offset);
+        def.pred.reset(new Predicate(parse_predicate(sp, lex, *def.scope)));
+        lex.seek(pos);
+        def.building = false;
     }
-    else if(fn == std::string("not"))
+    return *def.pred;
+}
+
+/**
+ * The transition a definition stands for, built from the source on first use
+ */
+const Transition& definition_transition(const StateSpace& sp, Definition& def)
+{
+    if(!def.trans)
     {
-        if(expr.childCount() != 2)
-        {
-            std::cout << "Not takes exactly one argument" << std::endl;
-            throw std::runtime_error(expr.toString());
-        }
-        return !parse_transition(sp, expr.value.sexp[1]);
+        Lexer& lex = def.scope->lex;
+        if(def.building) parse_error(lex, def.offset, "Definition refers to itself");
+        def.building = true;
+        size_t pos = lex.position();
+        lex.seek(def.offset);
+        def.trans.reset(new Transition(parse_transition(sp, lex, *def.scope)));
+        lex.seek(pos);
+        def.building = false;
     }
-    else if(fn == std::string("var"))
+    return *def.trans;
+}
+
+
+
+/**
+ * Read a constant from an atom, which is either a number or the name of an enumerated value.
+ * Returns false if it is neither.
+ */
+bool parse_constant(const StateSpace& sp, const Lexer& lex, const Token& tok, 
+                    unsigned long long& value)
+{
+    if(tok.text.size > 0 && std::isdigit((unsigned char) tok.text.data[0]))
     {
-        if(!(expr.childCount() == 3 && expr.value.sexp[1].isString() && expr.value.sexp[2].isString()))
-        {
-            std::cout << "Variable expression must be of form (var <var_type> <index>)" << std::endl;
-            throw std::runtime_error("Variable expr malformed");
-        }
-        int var_index;
-        try { var_index = std::stoi(expr.value.sexp[2].value.str); }
-        catch(const std::invalid_argument& e)
-        {
-            std::cout << "Variable index must be an int" << std::endl;
-            throw std::runtime_error(expr.toString());
-        }
+        size_t end;
+        try { value = std::stoull(tok.text.str(), &end); }
         catch(const std::out_of_range& e)
         {
-            std::cout << "Variable index must be less than size of bit vector" << std::endl;
-            throw std::runtime_error(expr.toString());
-        }
-        if(var_index >= sp.state_bits)
-        {
-            std::cout << "Variable index must be less than size of bit vector" << std::endl;
-            throw std::runtime_error(expr.toString());
+            parse_error(lex, tok.offset, "Constant does not fit in 64 bits");
         }
-        if( expr.value.sexp[1].value.str != std::string("from") &&
-            expr.value.sexp[1].value.str != std::string("to")   )
-        {
-            std::cout << "Variable type for transition must be to or from" << std::endl;
-            throw std::runtime_error(expr.toString());
-        } 
-        return Transition(sp, var_index, expr.value.sexp[1].value.str == std::string("to"));
+        if(end != tok.text.size) parse_error(lex, tok.offset, "Constant must be a number");
+        return true;
+    }
+    return sp.find_value(tok.text.str(), value);
+}
+
+PredWord parse_pred_term(const StateSpace& sp, Lexer& lex, const Scope& scope);
+TransWord parse_trans_term(const StateSpace& sp, Lexer& lex, const Scope& scope);
+
+/**
+ * The words a definition stands for in predicates and transitions, built on first use
+ */
+const PredWord& definition_pred_term(const StateSpace& sp, Definition& def)
+{
+    if(!def.pred_term)
+    {
+        Lexer& lex = def.scope->lex;
+        if(def.building) parse_error(lex, def.offset, "Definition refers to itself");
+        def.building = true;
+        size_t pos = lex.position();
+        lex.seek(def.offset);
+        def.pred_term.reset(new PredWord(parse_pred_term(sp, lex, *def.scope)));
+        lex.seek(pos);
+        def.building = false;
     }
-    else 
-    { 
-        std::cout << "Function in transition must be or, and, xor, var" << std::endl;
-        throw std::runtime_error(expr.toString());
+    return *def.pred_term;
+}
+
+const TransWord& definition_trans_term(const StateSpace& sp, Definition& def)
+{
+    if(!def.trans_term)
+    {
+        Lexer& lex = def.scope->lex;
+        if(def.building) parse_error(lex, def.offset, "Definition refers to itself");
+        def.building = true;
+        size_t pos = lex.position();
+        lex.seek(def.offset);
+        def.trans_term.reset(new TransWord(parse_trans_term(sp, lex, *def.scope)));
+        lex.seek(pos);
+        def.building = false;
     }
+    return *def.trans_term;
 }
 
 
 
 /**
- * Given a property this function checks if the s-expression is of correct syntax
+ * Parse the next term from the lexer into a word of predicates, one for each bit of the integer the
+ * term evaluates to in a state. Throws a runtime_error on failure.
  */
-bool check_property(const StateSpace& sp, const sexpresso::Sexp& expr)
+PredWord parse_pred_term(const StateSpace& sp, Lexer& lex, const Scope& scope)
 {
-    if(expr.isString())
+    Token tok = lex.next();
+    if(tok.kind == Token::ATOM)
     {
-        if(expr.value.str == "true" || expr.value.str == "false") return true;
+        unsigned long long value;
+        if(parse_constant(sp, lex, tok, value)) return word_const<Predicate>(sp, value);
+        const StateSpace::Variable* var = sp.find_variable(tok.text.str());
+        if(var && var->input) parse_error(lex, tok.offset, "Inputs can only be used in transitions");
+        if(var) return word_var(sp, var->bits);
+        if(Definition* def = scope.find(tok.text)) return definition_pred_term(sp, *def);
 
-        std::cout << "Constant in property must be true or false" << std::endl;
-        return false;
+        parse_error(lex, tok.offset, "Term must be a number, variable, value or a defined name");
     }
-    const std::string& fn = expr.value.sexp[0].value.str;
-    if(     fn == std::string("or")     || 
-            fn == std::string("and")    ||
-            fn == std::string("xor")    )
+    if(tok.kind != Token::OPEN) parse_error(lex, tok.offset, "Expected a term");
+    StrRef fn = lex.next().text;
+    if(fn == "+")
     {
-        if(expr.childCount() < 3)
-        {
-            std::cout << fn << " takes atleast two arguments" << std::endl;
-            return false;
-        }
-        bool ret = true;
-        for(size_t i = 1; i < expr.childCount(); i++) ret &= check_property(sp, expr.value.sexp[i]);
+        PredWord ret = parse_pred_term(sp, lex, scope);
+        size_t n_args = 1;
+        for(; lex.peek().kind != Token::CLOSE; ++n_args) 
+            ret = word_add(ret, parse_pred_term(sp, lex, scope));
+        if(n_args < 2) parse_error(lex, tok.offset, "+ takes atleast two arguments");
+        lex.next();
         return ret;
     }
-    else if(fn == std::string("not"))
+    else if(fn == "ite")
     {
-        if(expr.childCount() != 2)
-        {
-            std::cout << fn << " takes exacly one argument" << std::endl;
-            return false;
-        }
-        return check_property(sp, expr.value.sexp[1]);
+        Predicate cond = parse_predicate(sp, lex, scope);
+        PredWord wordt = parse_pred_term(sp, lex, scope);
+        PredWord worde = parse_pred_term(sp, lex, scope);
+        if(lex.next().kind != Token::CLOSE)
+            parse_error(lex, tok.offset, "Ite must be of form (ite <cond> <then> <else>)");
+        return word_ite(cond, wordt, worde);
     }
-    else if(fn == std::string("EX")     || 
-            fn == std::string("EF")     ||
-            fn == std::string("EG")     ||
-            fn == std::string("AX")     ||
-            fn == std::string("AF")     ||
-            fn == std::string("AG")     )
+    else if(fn == "let")
     {
-        if(expr.childCount() != 2)
-        {
-            std::cout << fn << " takes exactly one argument" <<
-                std::endl;
-            return false;
-        }
-        return check_property(sp, expr.value.sexp[1]);
+        Scope inner(lex, &scope);
+        read_bindings(lex, inner);
+        PredWord ret = parse_pred_term(sp, lex, inner);
+        if(lex.next().kind != Token::CLOSE)
+            parse_error(lex, tok.offset, "Let must be of form (let ((name expr)..) body)");
+        return ret;
     }
-    else if(fn == std::string("EU")     || 
-            fn == std::string("ER")     ||
-            fn == std::string("AU")     ||
-            fn == std::string("AR")     )
+    else parse_error(lex, tok.offset, "Function in term must be +, ite, let");
+}
+
+/**
+ * Parse the next term from the lexer into a word of transitions, one for each bit of the integer
+ * the term evaluates to on a pair of states. Variables are referred to by (from <name>) and
+ * (to <name>). Throws a runtime_error on failure.
+ */
+TransWord parse_trans_term(const StateSpace& sp, Lexer& lex, const Scope& scope)
+{
+    Token tok = lex.next();
+    if(tok.kind == Token::ATOM)
     {
-        if(expr.childCount() != 3)
-        {
-            std::cout << expr.value.sexp[0].value.str << " takes exactly two arguments" <<
-                std::endl;
-            return false;
-        }
-        return check_property(sp, expr.value.sexp[1]) && check_property(sp, expr.value.sexp[2]);
+        unsigned long long value;
+        if(parse_constant(sp, lex, tok, value)) return word_const<Transition>(sp, value);
+        const StateSpace::Variable* var = sp.find_variable(tok.text.str());
+        if(var && var->input) return word_input(sp, var->bits);
+        if(var)
+            parse_error(lex, tok.offset, 
+                        "Variable in transition must be (from <name>) or (to <name>)");
+        if(Definition* def = scope.find(tok.text)) return definition_trans_term(sp, *def);
+
+        parse_error(lex, tok.offset, "Term must be a number, variable, value or a defined name");
     }
-    else if(fn == std::string("var"))
+    if(tok.kind != Token::OPEN) parse_error(lex, tok.offset, "Expected a term");
+    StrRef fn = lex.next().text;
+    if(fn == "from" || fn == "to")
     {
-        if(!(expr.childCount() == 2 && expr.value.sexp[1].isString()))
-        {
-            std::cout << "Variable expression must be of form (var <index>)" << std::endl;
-            return false;
-        }
-        int var_index;
-        try { var_index = std::stoi(expr.value.sexp[1].value.str); }
-        catch(const std::invalid_argument& e)
-        {
-            std::cout << "Variable index must be an int" << std::endl;
-            return false;
-        }
-        catch(const std::out_of_range& e)
-        {
-            std::cout << "Variable index must be less than size of bit vector" << std::endl;
-            return false;
-        }
-        if(var_index >= sp.state_bits)
-        {
-            std::cout << "Variable index must be less than size of bit vector" << std::endl;
-            return false;
-        }
-        return true;
+        Token name = lex.next();
+        const StateSpace::Variable* var = sp.find_variable(name.text.str());
+        if(name.kind != Token::ATOM || !var) parse_error(lex, name.offset, "Unknown variable");
+        if(var->input) parse_error(lex, name.offset, "Inputs are referred to by name only");
+        if(lex.next().kind != Token::CLOSE)
+            parse_error(lex, tok.offset, "Variable must be of form (from <name>) or (to <name>)");
+        return word_var(sp, var->bits, fn == "to");
     }
-    else
+    else if(fn == "+")
     {
-        std::cout << "Function in property must be or, and, xor, var or a CTL operator" << std::endl;
-        return false;
+        TransWord ret = parse_trans_term(sp, lex, scope);
+        size_t n_args = 1;
+        for(; lex.peek().kind != Token::CLOSE; ++n_args) 
+            ret = word_add(ret, parse_trans_term(sp, lex, scope));
+        if(n_args < 2) parse_error(lex, tok.offset, "+ takes atleast two arguments");
+        lex.next();
+        return ret;
+    }
+    else if(fn == "ite")
+    {
+        Transition cond = parse_transition(sp, lex, scope);
+        TransWord wordt = parse_trans_term(sp, lex, scope);
+        TransWord worde = parse_trans_term(sp, lex, scope);
+        if(lex.next().kind != Token::CLOSE)
+            parse_error(lex, tok.offset, "Ite must be of form (ite <cond> <then> <else>)");
+        return word_ite(cond, wordt, worde);
+    }
+    else if(fn == "let")
+    {
+        Scope inner(lex, &scope);
+        read_bindings(lex, inner);
+        TransWord ret = parse_trans_term(sp, lex, inner);
+        if(lex.next().kind != Token::CLOSE)
+            parse_error(lex, tok.offset, "Let must be of form (let ((name expr)..) body)");
+        return ret;
     }
+    else parse_error(lex, tok.offset, "Function in term must be from, to, +, ite, let");
 }
 
 
 
 /**
- * Converts the CTL expression to a Predicate. Assumes expression to be syntaxially valid
+ * Parse the next expression from the lexer into a predicate. The BDD is built as each
+ * subexpression is read, so the expression is never held in memory. Throws a runtime_error
+ * containing the location of the problematic expression on failure.
  */
-Predicate ctl_to_pred(const StateSpace& sp, const Transition& trans, const sexpresso::Sexp& expr)
+Predicate parse_predicate(const StateSpace& sp, Lexer& lex, const Scope& scope)
 {
-    if(expr.isString())
+    Token tok = lex.next();
+    if(tok.kind == Token::ATOM)
     {
-        if(expr.value.str == "true")        return Predicate(sp, true);
-        else if(expr.value.str == "false")  return Predicate(sp, false);
+        if(tok.text == "true")          return Predicate(sp, true);
+        else if(tok.text == "false")    return Predicate(sp, false);
+        else if(Definition* def = scope.find(tok.text)) return definition_predicate(sp, *def);
 
-        std::cout << "Constant predicate must be true or false" << std::endl;
-        throw std::runtime_error(expr.toString());
+        parse_error(lex, tok.offset, "Constant predicate must be true, false or a defined name");
     }
-    const std::string& fn = expr.value.sexp[0].value.str;
-    if      (fn == "var")   return Predicate(sp, std::stoi(expr.value.sexp[1].value.str));
-    else if (fn == "and")
+    if(tok.kind != Token::OPEN) parse_error(lex, tok.offset, "Expected a predicate");
+    StrRef fn = lex.next().text;
+    if(fn == "or")
     {
-        Predicate ret = ctl_to_pred(sp, trans, expr.value.sexp[1]);
-        for(size_t i = 2; i < expr.childCount(); i++) ret &= ctl_to_pred(sp, trans, expr.value.sexp[i]);
+        Predicate ret = parse_predicate(sp, lex, scope);
+        size_t n_args = 1;
+        for(; lex.peek().kind != Token::CLOSE; ++n_args) ret |= parse_predicate(sp, lex, scope);
+        if(n_args < 2) parse_error(lex, tok.offset, "Or takes atleast two arguments");
+        lex.next();
         return ret;
     }
-    else if (fn == "or")
+    else if(fn == "and")
     {
-        Predicate ret = ctl_to_pred(sp, trans, expr.value.sexp[1]);
-        for(size_t i = 1; i < expr.childCount(); i++) ret |= ctl_to_pred(sp, trans, expr.value.sexp[i]);
+        Predicate ret = parse_predicate(sp, lex, scope);
+        size_t n_args = 1;
+        for(; lex.peek().kind != Token::CLOSE; ++n_args) ret &= parse_predicate(sp, lex, scope);
+        if(n_args < 2) parse_error(lex, tok.offset, "And takes atleast two arguments");
+        lex.next();
         return ret;
     }
-    else if (fn == "xor")
+    else if(fn == "xor")
     {
-        Predicate ret = ctl_to_pred(sp, trans, expr.value.sexp[1]);
-        for(size_t i = 1; i < expr.childCount(); i++) ret ^= ctl_to_pred(sp, trans, expr.value.sexp[i]);
+        Predicate ret = parse_predicate(sp, lex, scope);
+        size_t n_args = 1;
+        for(; lex.peek().kind != Token::CLOSE; ++n_args) ret ^= parse_predicate(sp, lex, scope);
+        if(n_args < 2) parse_error(lex, tok.offset, "Xor takes atleast two arguments");
+        lex.next();
         return ret;
     }
-    else if (fn == "not")   return !ctl_to_pred(sp, trans, expr.value.sexp[1]);
-    else if (fn == "EX")    return trans.EX(ctl_to_pred(sp, trans, expr.value.sexp[1]));
-    else if (fn == "EF")    return trans.EF(ctl_to_pred(sp, trans, expr.value.sexp[1]));
-    else if (fn == "EG")    return trans.EG(ctl_to_pred(sp, trans, expr.value.sexp[1]));
-    else if (fn == "EU")    return trans.EU(ctl_to_pred(sp, trans, expr.value.sexp[1]),
-                                            ctl_to_pred(sp, trans, expr.value.sexp[2]));
-    else if (fn == "ER")    return trans.ER(ctl_to_pred(sp, trans, expr.value.sexp[1]),
-                                            ctl_to_pred(sp, trans, expr.value.sexp[2]));
-    else if (fn == "AX")    return trans.AX(ctl_to_pred(sp, trans, expr.value.sexp[1]));
-    else if (fn == "AF")    return trans.AF(ctl_to_pred(sp, trans, expr.value.sexp[1]));
-    else if (fn == "AG")    return trans.AG(ctl_to_pred(sp, trans, expr.value.sexp[1]));
-    else if (fn == "AU")    return trans.AU(ctl_to_pred(sp, trans, expr.value.sexp[1]),
-                                            ctl_to_pred(sp, trans, expr.value.sexp[2]));
-    else if (fn == "AR")    return trans.AR(ctl_to_pred(sp, trans, expr.value.sexp[1]),
-                                            ctl_to_pred(sp, trans, expr.value.sexp[2]));
-    else throw std::runtime_error("Unknown function in property specification");
+    else if(fn == "not")
+    {
+        Predicate ret = !parse_predicate(sp, lex, scope);
+        if(lex.next().kind != Token::CLOSE) 
+            parse_error(lex, tok.offset, "Not takes exactly one argument");
+        return ret;
+    }
+    else if(fn == "var")
+    {
+        int var_index = parse_index(sp, lex, lex.next());
+        if(lex.next().kind != Token::CLOSE)
+            parse_error(lex, tok.offset, "Variable expression must be of form (var <index>)");
+        return Predicate(sp, var_index);
+    }
+    else if(fn == "=" || fn == "<" || fn == "<=")
+    {
+        PredWord wordl = parse_pred_term(sp, lex, scope);
+        PredWord wordr = parse_pred_term(sp, lex, scope);
+        if(lex.next().kind != Token::CLOSE)
+            parse_error(lex, tok.offset, "Comparison takes exactly two terms");
+        if(fn == "=")   return word_eq(wordl, wordr);
+        if(fn == "<")   return word_lt(wordl, wordr);
+        return word_le(wordl, wordr);
+    }
+    else if(fn == "let")
+    {
+        Scope inner(lex, &scope);
+        read_bindings(lex, inner);
+        Predicate ret = parse_predicate(sp, lex, inner);
+        if(lex.next().kind != Token::CLOSE)
+            parse_error(lex, tok.offset, "Let must be of form (let ((name expr)..) body)");
+        return ret;
+    }
+    else parse_error(lex, tok.offset, 
+                     "Function in predicate must be or, and, xor, not, var, let, =, <, <=");
 }
 
+
+
 /**
- * Version of previous function modified to handle fairness constraints
- */ 
-Predicate ctl_to_pred_fair(const StateSpace& sp, const Transition& trans, const sexpresso::Sexp& expr)
+ * Parse the next expression from the lexer into a transition, building it as it is read like
+ * parse_predicate. Throws a runtime_error on failure.
+ */
+Transition parse_transition(const StateSpace& sp, Lexer& lex, const Scope& scope)
 {
-    if(expr.isString())
+    Token tok = lex.next();
+    if(tok.kind == Token::ATOM)
     {
-        if(expr.value.str == "true")        return Predicate(sp, true);
-        else if(expr.value.str == "false")  return Predicate(sp, false);
+        if(tok.text == "true")          return Transition(sp, true);
+        else if(tok.text == "false")    return Transition(sp, false);
+        else if(Definition* def = scope.find(tok.text)) return definition_transition(sp, *def);
 
-        std::cout << "Constant predicate must be true or false" << std::endl;
-        throw std::runtime_error(expr.toString());
+        parse_error(lex, tok.offset, 
+                    "Constant in transition must be `true`, `false` or a defined name");
     }
-    const std::string& fn = expr.value.sexp[0].value.str;
-    if      (fn == "var")   return Predicate(sp, std::stoi(expr.value.sexp[1].value.str)) &&
-                                    trans.EG_fair(Predicate(sp, true));
-    else if (fn == "and")
+    if(tok.kind != Token::OPEN) parse_error(lex, tok.offset, "Expected a transition");
+    StrRef fn = lex.next().text;
+    if(fn == "or")
     {
-        Predicate ret = ctl_to_pred_fair(sp, trans, expr.value.sexp[1]);
-        for(size_t i = 2; i < expr.childCount(); i++) ret &= ctl_to_pred_fair(sp, trans, expr.value.sexp[i]);
+        Transition ret = parse_transition(sp, lex, scope);
+        size_t n_args = 1;
+        for(; lex.peek().kind != Token::CLOSE; ++n_args) ret |= parse_transition(sp, lex, scope);
+        if(n_args < 2) parse_error(lex, tok.offset, "Or takes atleast two arguments");
+        lex.next();
         return ret;
     }
-    else if (fn == "or")
+    else if(fn == "and")
     {
-        Predicate ret = ctl_to_pred_fair(sp, trans, expr.value.sexp[1]);
-        for(size_t i = 1; i < expr.childCount(); i++) ret |= ctl_to_pred_fair(sp, trans, expr.value.sexp[i]);
+        Transition ret = parse_transition(sp, lex, scope);
+        size_t n_args = 1;
+        for(; lex.peek().kind != Token::CLOSE; ++n_args) ret &= parse_transition(sp, lex, scope);
+        if(n_args < 2) parse_error(lex, tok.offset, "And takes atleast two arguments");
+        lex.next();
         return ret;
     }
-    else if (fn == "xor")
+    else if(fn == "xor")
     {
-        Predicate ret = ctl_to_pred_fair(sp, trans, expr.value.sexp[1]);
-        for(size_t i = 1; i < expr.childCount(); i++) ret ^= ctl_to_pred_fair(sp, trans, expr.value.sexp[i]);
+        Transition ret = parse_transition(sp, lex, scope);
+        size_t n_args = 1;
+        for(; lex.peek().kind != Token::CLOSE; ++n_args) ret ^= parse_transition(sp, lex, scope);
+        if(n_args < 2) parse_error(lex, tok.offset, "Xor takes atleast two arguments");
+        lex.next();
         return ret;
     }
-    else if (fn == "not")   return !ctl_to_pred_fair(sp, trans, expr.value.sexp[1]);
-    else if (fn == "EX")    return trans.EX_fair(ctl_to_pred_fair(sp, trans, expr.value.sexp[1]));
-    else if (fn == "EF")    return trans.EF_fair(ctl_to_pred_fair(sp, trans, expr.value.sexp[1]));
-    else if (fn == "EG")    return trans.EG_fair(ctl_to_pred_fair(sp, trans, expr.value.sexp[1]));
-    else if (fn == "EU")    return trans.EU_fair(ctl_to_pred_fair(sp, trans, expr.value.sexp[1]),
-                                                 ctl_to_pred_fair(sp, trans, expr.value.sexp[2]));
-    else if (fn == "ER")    return trans.ER_fair(ctl_to_pred_fair(sp, trans, expr.value.sexp[1]),
-                                                 ctl_to_pred_fair(sp, trans, expr.value.sexp[2]));
-    else if (fn == "AX")    return trans.AX_fair(ctl_to_pred_fair(sp, trans, expr.value.sexp[1]));
-    else if (fn == "AF")    return trans.AF_fair(ctl_to_pred_fair(sp, trans, expr.value.sexp[1]));
-    else if (fn == "AG")    return trans.AG_fair(ctl_to_pred_fair(sp, trans, expr.value.sexp[1]));
-    else if (fn == "AU")    return trans.AU_fair(ctl_to_pred_fair(sp, trans, expr.value.sexp[1]),
-                                                 ctl_to_pred_fair(sp, trans, expr.value.sexp[2]));
-    else if (fn == "AR")    return trans.AR_fair(ctl_to_pred_fair(sp, trans, expr.value.sexp[1]),
-                                                 ctl_to_pred_fair(sp, trans, expr.value.sexp[2]));
-    else throw std::runtime_error("Unknown function in property specification");
+    else if(fn == "not")
+    {
+        Transition ret = !parse_transition(sp, lex, scope);
+        if(lex.next().kind != Token::CLOSE) 
+            parse_error(lex, tok.offset, "Not takes exactly one argument");
+        return ret;
+    }
+    else if(fn == "var")
+    {
+        Token type = lex.next();
+        if(type.text != "from" && type.text != "to")
+            parse_error(lex, type.offset, "Variable type for transition must be to or from");
+        int var_index = parse_index(sp, lex, lex.next());
+        if(lex.next().kind != Token::CLOSE)
+            parse_error(lex, tok.offset, 
+                        "Variable expression must be of form (var <var_type> <index>)");
+        return Transition(sp, var_index, type.text == "to");
+    }
+    else if(fn == "=" || fn == "<" || fn == "<=")
+    {
+        TransWord wordl = parse_trans_term(sp, lex, scope);
+        TransWord wordr = parse_trans_term(sp, lex, scope);
+        if(lex.next().kind != Token::CLOSE)
+            parse_error(lex, tok.offset, "Comparison takes exactly two terms");
+        if(fn == "=")   return word_eq(wordl, wordr);
+        if(fn == "<")   return word_lt(wordl, wordr);
+        return word_le(wordl, wordr);
+    }
+    else if(fn == "let")
+    {
+        Scope inner(lex, &scope);
+        read_bindings(lex, inner);
+        Transition ret = parse_transition(sp, lex, inner);
+        if(lex.next().kind != Token::CLOSE)
+            parse_error(lex, tok.offset, "Let must be of form (let ((name expr)..) body)");
+        return ret;
+    }
+    else parse_error(lex, tok.offset, 
+                     "Function in transition must be or, and, xor, not, var, let, =, <, <=");
 }
 
+
 /**
- * Main method
+ * Fewest arguments of the top level `or` or `and` of the transition relation given to each thread
+ * building it
  */
-int main(int argc, char** argv)
+const size_t min_chunk_args = 8;
+
+/**
+ * Consume the next expression from the lexer, returning whether it uses a name bound in scope
+ */
+bool uses_scope(Lexer& lex, const Scope& scope)
 {
-    try
+    bool uses = false;
+    size_t depth = 0;
+    do
     {
-        // Read command line arguments
-        std::string spec_path;
-        if(!parse_args(argc, argv, spec_path)) return EXIT_FAILURE;
-        
-        std::cout << "Loading specification from file: " << spec_path << std::endl;
+        Token tok = lex.next();
+        if(tok.kind == Token::END) parse_error(lex, tok.offset, "Unexpected end of file");
+        if(tok.kind == Token::CLOSE && depth-- == 0) parse_error(lex, tok.offset, "Unexpected `)`");
+        if(tok.kind == Token::OPEN) ++depth;
+        if(tok.kind == Token::ATOM && scope.find(tok.text)) uses = true;
+    }
+    while(depth > 0);
+    return uses;
+}
 
+/**
+ * A chunk of the arguments of the transition relation, built on a thread with a BDD backend and a
+ * lexer of its own. The backend is declared first so that it is freed after the BDDs in it.
+ */
+struct TransitionChunk
+{
+    std::unique_ptr<BDDBackend> backend;
+    Lexer lex;
+    std::vector<size_t> args;               // Offsets of the arguments in the chunk
+    std::unique_ptr<Transition> result;
+    size_t error_offset;                    // Offset of the argument that failed, if any
+    std::exception_ptr error;
+    std::ostringstream error_out;           // What parse_error printed for it
 
-        // Read specification file
-        std::string spec_str;
-        std::ifstream spec_file(spec_path);
-        if(!spec_file.is_open())
-        {
-            std::cout << "Failed to open specification file" << std::endl;
-            return EXIT_FAILURE;
+    TransitionChunk(const Lexer& lex) : backend(BDD::new_backend()), lex(lex), error_offset(0) {}
+};
+
+/**
+ * Parse the transition relation of the system like parse_transition. The arguments of a top level
+ * `or` or `and` are split into chunks built on up to `threads` threads, and the chunks are merged
+ * pairwise in a tree, each merge transferring one of the pair into the backend of the other.
+ * Arguments that use a name from scope are built on this thread, as definitions are built on first
+ * use and shared. Errors are the same as those of parse_transition.
+ */
+Transition parse_system_transition(const StateSpace& sp, Lexer& lex, const Scope& scope,
+                                   unsigned threads)
+{
+    size_t start = lex.position();
+    Token open = lex.next();
+    StrRef fn = lex.next().text;
+    bool is_or = fn == "or";
+    if(threads < 2 || open.kind != Token::OPEN || (!is_or && fn != "and"))
+    {
+        lex.seek(start);
+        return parse_transition(sp, lex, scope);
+    }
+
+    // Find the arguments and which of them use names from scope. Malformed input is left to
+    // parse_transition to report.
+    std::vector<size_t> local, shared;
+    try
+    {
+        while(lex.peek().kind != Token::CLOSE)
+        {
+            size_t offset = lex.peek().offset;
+            (uses_scope(lex, scope) ? shared : local).push_back(offset);
         }
-        { 
-            std::string line; 
-            while(std::getline(spec_file, line)) spec_str += line.substr(0, line.find(';'));
+    }
+    catch(const std::runtime_error& e)
+    {
+        lex.seek(start);
+        return parse_transition(sp, lex, scope);
+    }
+    size_t end = lex.position();
+    size_t n_chunks = std::min<size_t>(threads, local.size() / min_chunk_args);
+    if(n_chunks < 2)
+    {
+        lex.seek(start);
+        return parse_transition(sp, lex, scope);
+    }
+
+    // Combine an argument into a partial result
+    auto combine = [is_or](std::unique_ptr<Transition>& acc, const Transition& arg)
+    {
+        if(!acc) acc.reset(new Transition(arg));
+        else if(is_or) *acc |= arg;
+        else *acc &= arg;
+    };
+
+    // Build the chunks on their threads, and the arguments using names here meanwhile
+    std::vector<std::unique_ptr<TransitionChunk> > chunks;
+    for(size_t c = 0; c < n_chunks; ++c)
+    {
+        chunks.push_back(std::unique_ptr<TransitionChunk>(new TransitionChunk(lex)));
+        chunks[c]->args.assign(local.begin() + c * local.size() / n_chunks,
+                               local.begin() + (c + 1) * local.size() / n_chunks);
+    }
+    std::function<void(size_t)> build = [&](size_t c)
+    {
+        TransitionChunk& ch = *chunks[c];
+        BDD::set_thread_backend(ch.backend.get());
+        parse_error_out = &ch.error_out;
+        try
+        {
+            for(std::vector<size_t>::const_iterator i = ch.args.begin(); i != ch.args.end(); ++i)
+            {
+                ch.error_offset = *i;
+                ch.lex.seek(*i);
+                combine(ch.result, parse_transition(sp, ch.lex, scope));
+            }
+        }
+        catch(...) { ch.error = std::current_exception(); }
+        BDD::set_thread_backend(NULL);
+    };
+    std::vector<std::thread> workers;
+    for(size_t c = 0; c < n_chunks; ++c) workers.push_back(std::thread(build, c));
+    std::unique_ptr<Transition> ret;
+    size_t error_offset = end;
+    std::exception_ptr error;
+    std::ostringstream error_out;
+    parse_error_out = &error_out;
+    try
+    {
+        for(std::vector<size_t>::const_iterator i = shared.begin(); i != shared.end(); ++i)
+        {
+            error_offset = *i;
+            lex.seek(*i);
+            combine(ret, parse_transition(sp, lex, scope));
+        }
+    }
+    catch(...) { error = std::current_exception(); }
+    parse_error_out = &std::cout;
+    for(size_t c = 0; c < n_chunks; ++c) workers[c].join();
+
+    // Report the error of the first argument that failed, as parse_transition would
+    if(!error) error_offset = end;
+    std::string error_msg = error_out.str();
+    for(size_t c = 0; c < n_chunks; ++c)
+        if(chunks[c]->error && chunks[c]->error_offset < error_offset)
+        {
+            error = chunks[c]->error;
+            error_offset = chunks[c]->error_offset;
+            error_msg = chunks[c]->error_out.str();
+        }
+    if(error)
+    {
+        std::cout << error_msg;
+        std::rethrow_exception(error);
+    }
+
+    // Merge the chunks pairwise, each into the backend of the first of the pair
+    std::function<void(size_t, size_t)> merge = [&](size_t c, size_t d)
+    {
+        TransitionChunk& ch = *chunks[c];
+        BDD::set_thread_backend(ch.backend.get());
+        try { combine(ch.result, chunks[d]->result->transfer(sp)); }
+        catch(...) { ch.error = std::current_exception(); }
+        BDD::set_thread_backend(NULL);
+    };
+    for(size_t step = 1; step < n_chunks; step *= 2)
+    {
+        std::vector<std::thread> mergers;
+        for(size_t c = 0; c + step < n_chunks; c += 2 * step)
+            mergers.push_back(std::thread(merge, c, c + step));
+        for(size_t m = 0; m < mergers.size(); ++m) mergers[m].join();
+        for(size_t c = 0; c + step < n_chunks; c += 2 * step)
+        {
+            if(chunks[c]->error) std::rethrow_exception(chunks[c]->error);
+            chunks[c + step].reset();
+        }
+    }
+    combine(ret, chunks[0]->result->transfer(sp));
+    chunks.clear();
+    lex.seek(end);
+    lex.next();
+    return *ret;
+}
+
+
+
+/**
+ * Consume the next expression from the lexer without interpreting it, adding its tokens to hash
+ */
+void hash_expr(Lexer& lex, StreamHash& hash)
+{
+    size_t depth = 0;
+    do
+    {
+        Token tok = lex.next();
+        if(tok.kind == Token::END) parse_error(lex, tok.offset, "Unexpected end of file");
+        if(tok.kind == Token::CLOSE && depth-- == 0) parse_error(lex, tok.offset, "Unexpected `)`");
+        if(tok.kind == Token::OPEN) ++depth;
+        hash.add(tok.text.data, tok.text.size);
+    }
+    while(depth > 0);
+}
+
+
+
+bool check_property(const StateSpace& sp, const SExpr& expr, const Scope& scope);
+
+/**
+ * Parse and check the property a definition stands for, keeping it on success. Returns false if it
+ * is not a valid property.
+ */
+bool check_definition(const StateSpace& sp, Definition& def)
+{
+    if(def.prop || def.offset == Definition::NO_SOURCE) return true;
+    if(def.building)
+    {
+        std::cout << "Definition refers to itself" << std::endl;
+        return false;
+    }
+    Lexer& lex = def.scope->lex;
+    size_t pos = lex.position();
+    lex.seek(def.offset);
+    std::unique_ptr<SExpr> prop(new SExpr(parse_sexpr(lex)));
+    lex.seek(pos);
+    def.building = true;
+    bool ok = check_property(sp, *prop, *def.scope);
+    def.building = false;
+    if(ok) def.prop = std::move(prop);
+    return ok;
+}
+
+/**
+ * Bind the bindings `((name expr)..)` of a let in a property into scope. Returns false, printing
+ * the problem, if they are malformed.
+ */
+bool bind_property(const SExpr& bindings, Scope& scope)
+{
+    if(bindings.is_atom())
+    {
+        std::cout << "Let must be of form (let ((name expr)..) body)" << std::endl;
+        return false;
+    }
+    for(size_t i = 0; i < bindings.size(); ++i)
+    {
+        if(bindings[i].is_atom() || bindings[i].size() != 2 || !bindings[i][0].is_atom())
+        {
+            std::cout << "Binding in let must be of form (name expr)" << std::endl;
+            return false;
+        }
+        if(!scope.bind(bindings[i][0].text, bindings[i][1].begin))
+        {
+            std::cout << "Name already bound or a constant: " << bindings[i][0].text << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+
+
+/**
+ * A variable declared before the system. It is given its bits once the size of the state is known.
+ * Variables declared together by an interleave share a group, and have their bits interleaved.
+ * Inputs are given input bits instead.
+ */
+struct Declaration
+{
+    StrRef name;
+    size_t width;
+    std::vector<std::string> values;    // Names of values of an enum, empty for words
+    bool input;
+    size_t group;
+    size_t offset;                      // Start of the declaration in the source
+};
+
+/**
+ * Read the rest of a word, input, enum or interleave form, following its head, into decls. Throws a
+ * runtime_error on failure.
+ */
+void read_declaration(Lexer& lex, const Token& open, const StrRef& head, size_t group,
+                      std::vector<Declaration>& decls)
+{
+    if(head == "interleave")
+    {
+        while(lex.peek().kind != Token::CLOSE)
+        {
+            Token inner = lex.next();
+            Token inner_head = lex.next();
+            if(inner.kind != Token::OPEN || (inner_head.text != "word" && inner_head.text != "enum"))
+                parse_error(lex, inner.offset, "Interleave takes word and enum declarations");
+            read_declaration(lex, inner, inner_head.text, group, decls);
+        }
+        lex.next();
+        return;
+    }
+
+    Declaration decl;
+    decl.group = group;
+    decl.offset = open.offset;
+    Token name = lex.next();
+    if(name.kind != Token::ATOM)
+        parse_error(lex, open.offset, "Declaration must be of form (word <name> <width>), "
+                                      "(input <name> <width>) or (enum <name> <value1>..)");
+    decl.name = name.text;
+    decl.input = head == "input";
+    if(head == "word" || head == "input")
+    {
+        Token width = lex.next();
+        decl.width = 0;
+        for(size_t i = 0; width.kind == Token::ATOM && i < width.text.size; ++i)
+        {
+            if(!std::isdigit((unsigned char) width.text.data[i]) || decl.width > 64) break;
+            decl.width = decl.width * 10 + (width.text.data[i] - '0');
+        }
+        if(decl.width < 1 || decl.width > 64 || width.kind != Token::ATOM || 
+                !std::isdigit((unsigned char) width.text.data[width.text.size - 1]))
+            parse_error(lex, width.offset, "Width of word must be a number from 1 to 64");
+        if(lex.next().kind != Token::CLOSE)
+            parse_error(lex, open.offset, "Declaration must be of form (word <name> <width>) or "
+                                          "(input <name> <width>)");
+    }
+    else
+    {
+        while(lex.peek().kind != Token::CLOSE)
+        {
+            Token value = lex.next();
+            if(value.kind != Token::ATOM) 
+                parse_error(lex, value.offset, "Values of enum must be names");
+            decl.values.push_back(value.text.str());
+        }
+        lex.next();
+        if(decl.values.empty()) parse_error(lex, open.offset, "Enum must have atleast one value");
+        decl.width = 1;
+        while((1ULL << decl.width) < decl.values.size()) ++decl.width;
+    }
+    decls.push_back(decl);
+}
+
+/**
+ * Number of input bits needed by the declared inputs
+ */
+int count_input_bits(const std::vector<Declaration>& decls)
+{
+    int ret = 0;
+    for(std::vector<Declaration>::const_iterator i = decls.begin(); i != decls.end(); ++i)
+        if(i->input) ret += i->width;
+    return ret;
+}
+
+/**
+ * Give each declared variable its bits, starting from bit 0 in order of declaration. Within a group,
+ * bits of equal significance are placed next to each other, which keeps arithmetic between the
+ * variables of the group small. Inputs are given input bits in order of declaration. Throws a
+ * runtime_error if the state is too small or a name is already used.
+ */
+void declare_variables(StateSpace& sp, const Lexer& lex, const Scope& globals,
+                       const std::vector<Declaration>& decls)
+{
+    int next_bit = 0;
+    int next_input = 0;
+    for(size_t first = 0, last = 0; first < decls.size(); first = last)
+    {
+        size_t width = 0;
+        for(last = first; last < decls.size() && decls[last].group == decls[first].group; ++last)
+            width = std::max(width, decls[last].width);
+
+        std::vector<StateSpace::Variable> vars(last - first);
+        for(size_t bit = 0; bit < width; ++bit)
+            for(size_t i = first; i < last; ++i)
+                if(bit < decls[i].width) 
+                    vars[i - first].bits.push_back(decls[i].input ? next_input++ : next_bit++);
+        if(next_bit > sp.state_bits)
+            parse_error(lex, decls[first].offset, "Declared variables need more bits than n_bits");
+
+        for(size_t i = first; i < last; ++i)
+        {
+            vars[i - first].values = decls[i].values;
+            vars[i - first].input = decls[i].input;
+            bool defined = globals.find(decls[i].name) != NULL;
+            for(size_t j = 0; j < decls[i].values.size(); ++j)
+            {
+                const std::string& value = decls[i].values[j];
+                defined |= globals.find(StrRef(value.data(), value.size())) != NULL;
+            }
+            if(defined || !sp.add_variable(decls[i].name.str(), vars[i - first]))
+                parse_error(lex, decls[i].offset, "Name of variable or value is already used");
+        }
+    }
+}
+
+
+
+/**
+ * Evaluate a comparison of terms in a property into a predicate. As comparisons hold no CTL
+ * operators, this parses them from the source like the initial state predicate.
+ */
+Predicate property_comparison(const StateSpace& sp, const SExpr& expr, const Scope& scope)
+{
+    size_t pos = scope.lex.position();
+    scope.lex.seek(expr.begin);
+    Predicate ret = parse_predicate(sp, scope.lex, scope);
+    scope.lex.seek(pos);
+    return ret;
+}
+
+
+
+/**
+ * Given a property this function checks if the s-expression is of correct syntax
+ */
+bool check_property(const StateSpace& sp, const SExpr& expr, const Scope& scope)
+{
+    if(expr.is_atom())
+    {
+        if(expr.text == "true" || expr.text == "false") return true;
+        if(Definition* def = scope.find(expr.text)) return check_definition(sp, *def);
+
+        std::cout << "Constant in property must be true, false or a defined name" << std::endl;
+        return false;
+    }
+    StrRef fn = expr.head();
+    if(     fn == "or"     || 
+            fn == "and"    ||
+            fn == "xor"    )
+    {
+        if(expr.size() < 3)
+        {
+            std::cout << fn << " takes atleast two arguments" << std::endl;
+            return false;
+        }
+        bool ret = true;
+        for(size_t i = 1; i < expr.size(); i++) ret &= check_property(sp, expr[i], scope);
+        return ret;
+    }
+    else if(fn == "not")
+    {
+        if(expr.size() != 2)
+        {
+            std::cout << fn << " takes exacly one argument" << std::endl;
+            return false;
+        }
+        return check_property(sp, expr[1], scope);
+    }
+    else if(fn == "EX"     || 
+            fn == "EF"     ||
+            fn == "EG"     ||
+            fn == "AX"     ||
+            fn == "AF"     ||
+            fn == "AG"     )
+    {
+        if(expr.size() != 2)
+        {
+            std::cout << fn << " takes exactly one argument" <<
+                std::endl;
+            return false;
+        }
+        return check_property(sp, expr[1], scope);
+    }
+    else if(fn == "EU"     || 
+            fn == "ER"     ||
+            fn == "AU"     ||
+            fn == "AR"     )
+    {
+        if(expr.size() != 3)
+        {
+            std::cout << expr[0].text << " takes exactly two arguments" <<
+                std::endl;
+            return false;
+        }
+        return check_property(sp, expr[1], scope) && check_property(sp, expr[2], scope);
+    }
+    else if(fn == "var")
+    {
+        if(!(expr.size() == 2 && expr[1].is_atom()))
+        {
+            std::cout << "Variable expression must be of form (var <index>)" << std::endl;
+            return false;
+        }
+        int var_index;
+        try { var_index = std::stoi(expr[1].text.str()); }
+        catch(const std::invalid_argument& e)
+        {
+            std::cout << "Variable index must be an int" << std::endl;
+            return false;
+        }
+        catch(const std::out_of_range& e)
+        {
+            std::cout << "Variable index must be less than size of bit vector" << std::endl;
+            return false;
+        }
+        if(var_index < 0 || var_index >= sp.state_bits)
+        {
+            std::cout << "Variable index must be less than size of bit vector" << std::endl;
+            return false;
+        }
+        return true;
+    }
+    else if(fn == "=" || fn == "<" || fn == "<=")
+    {
+        try { property_comparison(sp, expr, scope); }
+        catch(const std::runtime_error& e)
+        {
+            std::cout << e.what() << std::endl;
+            return false;
+        }
+        return true;
+    }
+    else if(fn == "let")
+    {
+        if(expr.size() != 3)
+        {
+            std::cout << "Let must be of form (let ((name expr)..) body)" << std::endl;
+            return false;
+        }
+        Scope inner(scope.lex, &scope);
+        if(!bind_property(expr[1], inner)) return false;
+        for(std::map<StrRef, std::unique_ptr<Definition> >::const_iterator i = inner.defs.begin();
+                i != inner.defs.end(); ++i)
+            if(!check_definition(sp, *i->second)) return false;
+        return check_property(sp, expr[2], inner);
+    }
+    else
+    {
+        std::cout << "Function in property must be or, and, xor, var, let, =, <, <= or a CTL " <<
+            "operator" << std::endl;
+        return false;
+    }
+}
+
+
+/**
+ * Mark the state bits that the propositional parts of a valid property depend on in `in_support`.
+ * The temporal operators only bring in more bits through the transition relation, so these are
+ * the bits whose cone of influence the property is checked over.
+ */
+void property_support(const StateSpace& sp, const SExpr& expr, const Scope& scope,
+                      std::vector<bool>& in_support)
+{
+    std::vector<int> supp;
+    if(expr.is_atom())
+    {
+        Definition* def = scope.find(expr.text);
+        if(!def) return;
+        if(def->offset != Definition::NO_SOURCE)
+        {
+            check_definition(sp, *def);
+            property_support(sp, *def->prop, *def->scope, in_support);
+            return;
+        }
+        supp = def->pred->support();
+    }
+    else if(expr.head() == "var")    supp.push_back(std::stoi(expr[1].text.str()));
+    else if(expr.head() == "=" || expr.head() == "<" || expr.head() == "<=")
+        supp = property_comparison(sp, expr, scope).support();
+    else if(expr.head() == "let")
+    {
+        Scope inner(scope.lex, &scope);
+        bind_property(expr[1], inner);
+        property_support(sp, expr[2], inner, in_support);
+    }
+    else for(size_t i = 1; i < expr.size(); ++i) property_support(sp, expr[i], scope, in_support);
+    for(std::vector<int>::const_iterator i = supp.begin(); i != supp.end(); ++i)
+        in_support[*i] = true;
+}
+
+/**
+ * Returns true if a valid property has no temporal operators, so that it is a predicate on single
+ * states
+ */
+bool is_propositional(const StateSpace& sp, const SExpr& expr, const Scope& scope)
+{
+    if(expr.is_atom())
+    {
+        Definition* def = scope.find(expr.text);
+        if(!def || def->offset == Definition::NO_SOURCE) return true;
+        return check_definition(sp, *def) && is_propositional(sp, *def->prop, *def->scope);
+    }
+    StrRef fn = expr.head();
+    if(fn == "var" || fn == "=" || fn == "<" || fn == "<=") return true;
+    if(fn == "let")
+    {
+        Scope inner(scope.lex, &scope);
+        bind_property(expr[1], inner);
+        return is_propositional(sp, expr[2], inner);
+    }
+    if(fn != "and" && fn != "or" && fn != "xor" && fn != "not") return false;
+    for(size_t i = 1; i < expr.size(); ++i) 
+        if(!is_propositional(sp, expr[i], scope)) return false;
+    return true;
+}
+
+/**
+ * Converts the CTL expression to a Predicate. Assumes expression to be syntaxially valid. If a
+ * profiler is given, the evaluation of each node of the expression is recorded with it.
+ */
+Predicate ctl_to_pred(const StateSpace& sp, const Transition& trans, const SExpr& expr,
+                      const Scope& scope, Profiler* prof = NULL);
+Predicate ctl_to_pred_fair(const StateSpace& sp, const Transition& trans, 
+                           const SExpr& expr, const Scope& scope, Profiler* prof = NULL);
+
+/**
+ * Evaluates the operator at the root of the CTL expression, with the subexpressions evaluated by
+ * ctl_to_pred.
+ */
+Predicate ctl_node_to_pred(const StateSpace& sp, const Transition& trans, 
+                           const SExpr& expr, const Scope& scope, Profiler* prof)
+{
+    if(expr.is_atom())
+    {
+        if(expr.text == "true")        return Predicate(sp, true);
+        else if(expr.text == "false")  return Predicate(sp, false);
+        else if(Definition* def = scope.find(expr.text))
+        {
+            // Definitions are evaluated once, and shared by all their uses
+            if(!def->prop_pred)
+            {
+                if(!check_definition(sp, *def)) throw std::runtime_error(expr.to_string());
+                def->prop_pred.reset(new Predicate(
+                            ctl_to_pred(sp, trans, *def->prop, *def->scope, prof)));
+            }
+            return *def->prop_pred;
+        }
+
+        std::cout << "Constant predicate must be true or false" << std::endl;
+        throw std::runtime_error(expr.to_string());
+    }
+    StrRef fn = expr.head();
+    if      (fn == "var")   return Predicate(sp, std::stoi(expr[1].text.str()));
+    else if (fn == "=" || fn == "<" || fn == "<=")
+                            return property_comparison(sp, expr, scope);
+    else if (fn == "and")
+    {
+        Predicate ret = ctl_to_pred(sp, trans, expr[1], scope, prof);
+        for(size_t i = 2; i < expr.size(); i++)
+            ret &= ctl_to_pred(sp, trans, expr[i], scope, prof);
+        return ret;
+    }
+    else if (fn == "or")
+    {
+        Predicate ret = ctl_to_pred(sp, trans, expr[1], scope, prof);
+        for(size_t i = 2; i < expr.size(); i++)
+            ret |= ctl_to_pred(sp, trans, expr[i], scope, prof);
+        return ret;
+    }
+    else if (fn == "xor")
+    {
+        Predicate ret = ctl_to_pred(sp, trans, expr[1], scope, prof);
+        for(size_t i = 2; i < expr.size(); i++)
+            ret ^= ctl_to_pred(sp, trans, expr[i], scope, prof);
+        return ret;
+    }
+    else if (fn == "not")   return !ctl_to_pred(sp, trans, expr[1], scope, prof);
+    else if (fn == "EX")    return trans.EX(ctl_to_pred(sp, trans, expr[1], scope, prof));
+    else if (fn == "EF")    return trans.EF(ctl_to_pred(sp, trans, expr[1], scope, prof));
+    else if (fn == "EG")    return trans.EG(ctl_to_pred(sp, trans, expr[1], scope, prof));
+    else if (fn == "EU")    return trans.EU(ctl_to_pred(sp, trans, expr[1], scope, prof),
+                                            ctl_to_pred(sp, trans, expr[2], scope, prof));
+    else if (fn == "ER")    return trans.ER(ctl_to_pred(sp, trans, expr[1], scope, prof),
+                                            ctl_to_pred(sp, trans, expr[2], scope, prof));
+    else if (fn == "AX")    return trans.AX(ctl_to_pred(sp, trans, expr[1], scope, prof));
+    else if (fn == "AF")    return trans.AF(ctl_to_pred(sp, trans, expr[1], scope, prof));
+    else if (fn == "AG")    return trans.AG(ctl_to_pred(sp, trans, expr[1], scope, prof));
+    else if (fn == "AU")    return trans.AU(ctl_to_pred(sp, trans, expr[1], scope, prof),
+                                            ctl_to_pred(sp, trans, expr[2], scope, prof));
+    else if (fn == "AR")    return trans.AR(ctl_to_pred(sp, trans, expr[1], scope, prof),
+                                            ctl_to_pred(sp, trans, expr[2], scope, prof));
+    else if (fn == "let")
+    {
+        Scope inner(scope.lex, &scope);
+        bind_property(expr[1], inner);
+        return ctl_to_pred(sp, trans, expr[2], inner, prof);
+    }
+    else throw std::runtime_error("Unknown function in property specification");
+}
+
+/**
+ * Version of previous function modified to handle fairness constraints
+ */ 
+Predicate ctl_node_to_pred_fair(const StateSpace& sp, const Transition& trans, 
+                                const SExpr& expr, const Scope& scope, Profiler* prof)
+{
+    if(expr.is_atom())
+    {
+        if(expr.text == "true")        return Predicate(sp, true);
+        else if(expr.text == "false")  return Predicate(sp, false);
+        else if(Definition* def = scope.find(expr.text))
+        {
+            // Definitions are evaluated once, and shared by all their uses
+            if(!def->prop_pred_fair && def->offset == Definition::NO_SOURCE)
+                def->prop_pred_fair.reset(new Predicate(*def->pred && 
+                                                        trans.EG_fair(Predicate(sp, true))));
+            else if(!def->prop_pred_fair)
+            {
+                if(!check_definition(sp, *def)) throw std::runtime_error(expr.to_string());
+                def->prop_pred_fair.reset(new Predicate(
+                            ctl_to_pred_fair(sp, trans, *def->prop, *def->scope, prof)));
+            }
+            return *def->prop_pred_fair;
+        }
+
+        std::cout << "Constant predicate must be true or false" << std::endl;
+        throw std::runtime_error(expr.to_string());
+    }
+    StrRef fn = expr.head();
+    if      (fn == "var")   return Predicate(sp, std::stoi(expr[1].text.str())) &&
+                                    trans.EG_fair(Predicate(sp, true));
+    else if (fn == "=" || fn == "<" || fn == "<=")
+                            return property_comparison(sp, expr, scope) && 
+                                    trans.EG_fair(Predicate(sp, true));
+    else if (fn == "and")
+    {
+        Predicate ret = ctl_to_pred_fair(sp, trans, expr[1], scope, prof);
+        for(size_t i = 2; i < expr.size(); i++)
+            ret &= ctl_to_pred_fair(sp, trans, expr[i], scope, prof);
+        return ret;
+    }
+    else if (fn == "or")
+    {
+        Predicate ret = ctl_to_pred_fair(sp, trans, expr[1], scope, prof);
+        for(size_t i = 2; i < expr.size(); i++)
+            ret |= ctl_to_pred_fair(sp, trans, expr[i], scope, prof);
+        return ret;
+    }
+    else if (fn == "xor")
+    {
+        Predicate ret = ctl_to_pred_fair(sp, trans, expr[1], scope, prof);
+        for(size_t i = 2; i < expr.size(); i++)
+            ret ^= ctl_to_pred_fair(sp, trans, expr[i], scope, prof);
+        return ret;
+    }
+    else if (fn == "not")   return !ctl_to_pred_fair(sp, trans, expr[1], scope, prof);
+    else if (fn == "EX")    return trans.EX_fair(ctl_to_pred_fair(sp, trans, expr[1], scope, prof));
+    else if (fn == "EF")    return trans.EF_fair(ctl_to_pred_fair(sp, trans, expr[1], scope, prof));
+    else if (fn == "EG")    return trans.EG_fair(ctl_to_pred_fair(sp, trans, expr[1], scope, prof));
+    else if (fn == "EU")    return trans.EU_fair(ctl_to_pred_fair(sp, trans, expr[1], scope, prof),
+                                                 ctl_to_pred_fair(sp, trans, expr[2], scope, prof));
+    else if (fn == "ER")    return trans.ER_fair(ctl_to_pred_fair(sp, trans, expr[1], scope, prof),
+                                                 ctl_to_pred_fair(sp, trans, expr[2], scope, prof));
+    else if (fn == "AX")    return trans.AX_fair(ctl_to_pred_fair(sp, trans, expr[1], scope, prof));
+    else if (fn == "AF")    return trans.AF_fair(ctl_to_pred_fair(sp, trans, expr[1], scope, prof));
+    else if (fn == "AG")    return trans.AG_fair(ctl_to_pred_fair(sp, trans, expr[1], scope, prof));
+    else if (fn == "AU")    return trans.AU_fair(ctl_to_pred_fair(sp, trans, expr[1], scope, prof),
+                                                 ctl_to_pred_fair(sp, trans, expr[2], scope, prof));
+    else if (fn == "AR")    return trans.AR_fair(ctl_to_pred_fair(sp, trans, expr[1], scope, prof),
+                                                 ctl_to_pred_fair(sp, trans, expr[2], scope, prof));
+    else if (fn == "let")
+    {
+        Scope inner(scope.lex, &scope);
+        bind_property(expr[1], inner);
+        return ctl_to_pred_fair(sp, trans, expr[2], inner, prof);
+    }
+    else throw std::runtime_error("Unknown function in property specification");
+}
+
+/**
+ * Name of the operator at the root of a CTL expression, used to label it in profiles
+ */
+std::string ctl_op_name(const SExpr& expr)
+{
+    return expr.is_atom() ? expr.text.str() : expr.head().str();
+}
+
+Predicate ctl_to_pred(const StateSpace& sp, const Transition& trans, const SExpr& expr,
+                      const Scope& scope, Profiler* prof)
+{
+    if(!prof) return ctl_node_to_pred(sp, trans, expr, scope, prof);
+    prof->begin_node(ctl_op_name(expr), expr.location);
+    Predicate ret = ctl_node_to_pred(sp, trans, expr, scope, prof);
+    prof->end_node(ret);
+    return ret;
+}
+
+Predicate ctl_to_pred_fair(const StateSpace& sp, const Transition& trans, 
+                           const SExpr& expr, const Scope& scope, Profiler* prof)
+{
+    if(!prof) return ctl_node_to_pred_fair(sp, trans, expr, scope, prof);
+    prof->begin_node(ctl_op_name(expr), expr.location);
+    Predicate ret = ctl_node_to_pred_fair(sp, trans, expr, scope, prof);
+    prof->end_node(ret);
+    return ret;
+}
+
+/**
+ * Converts the CTL expression to a Predicate that agrees with the one from ctl_to_pred on the
+ * states satisfying `care`, and is restricted to them to keep it small. `reach` must contain care
+ * and every state reachable from it. Each operand is only evaluated on the states where it can
+ * decide the operator on care: successors of care for EX and AX, all of reach for the fixpoints,
+ * and for and and or, the states where the operands before it have not decided the result yet.
+ */
+Predicate ctl_to_pred_care(const StateSpace& sp, const Transition& trans, const SExpr& expr,
+                           const Scope& scope, const Predicate& care, const Predicate& reach,
+                           Profiler* prof = NULL);
+
+/**
+ * Evaluates the operator at the root of the CTL expression on care, with the subexpressions
+ * evaluated by ctl_to_pred_care. Atoms, propositions and definitions are evaluated in full by
+ * ctl_node_to_pred, as they are cheap or shared by all their uses, and so is everything when all
+ * states are cared about.
+ */
+Predicate ctl_node_to_pred_care(const StateSpace& sp, const Transition& trans, 
+                                const SExpr& expr, const Scope& scope, const Predicate& care,
+                                const Predicate& reach, Profiler* prof)
+{
+    if(expr.is_atom() || care.is_true()) return ctl_node_to_pred(sp, trans, expr, scope, prof);
+    StrRef fn = expr.head();
+    if      (fn == "and")
+    {
+        Predicate ret = ctl_to_pred_care(sp, trans, expr[1], scope, care, reach, prof);
+        for(size_t i = 2; i < expr.size() && !care.implies(!ret); i++)
+            ret &= ctl_to_pred_care(sp, trans, expr[i], scope, care && ret, reach, prof);
+        return ret;
+    }
+    else if (fn == "or")
+    {
+        Predicate ret = ctl_to_pred_care(sp, trans, expr[1], scope, care, reach, prof);
+        for(size_t i = 2; i < expr.size() && !care.implies(ret); i++)
+            ret |= ctl_to_pred_care(sp, trans, expr[i], scope, care && !ret, reach, prof);
+        return ret;
+    }
+    else if (fn == "xor")
+    {
+        Predicate ret = ctl_to_pred_care(sp, trans, expr[1], scope, care, reach, prof);
+        for(size_t i = 2; i < expr.size(); i++)
+            ret ^= ctl_to_pred_care(sp, trans, expr[i], scope, care, reach, prof);
+        return ret;
+    }
+    else if (fn == "not")   return !ctl_to_pred_care(sp, trans, expr[1], scope, care, reach, prof);
+    else if (fn == "EX")    return trans.EX(ctl_to_pred_care(sp, trans, expr[1], scope, 
+                                                             trans.post(care), reach, prof));
+    else if (fn == "AX")    return trans.AX(ctl_to_pred_care(sp, trans, expr[1], scope, 
+                                                             trans.post(care), reach, prof));
+    else if (fn == "EF")    return trans.EF(ctl_to_pred_care(sp, trans, expr[1], scope, reach, 
+                                                             reach, prof));
+    else if (fn == "EG")    return trans.EG(ctl_to_pred_care(sp, trans, expr[1], scope, reach, 
+                                                             reach, prof));
+    else if (fn == "EU")    return trans.EU(ctl_to_pred_care(sp, trans, expr[1], scope, reach, 
+                                                             reach, prof),
+                                            ctl_to_pred_care(sp, trans, expr[2], scope, reach,
+                                                             reach, prof));
+    else if (fn == "ER")    return trans.ER(ctl_to_pred_care(sp, trans, expr[1], scope, reach, 
+                                                             reach, prof),
+                                            ctl_to_pred_care(sp, trans, expr[2], scope, reach,
+                                                             reach, prof));
+    else if (fn == "AF")    return trans.AF(ctl_to_pred_care(sp, trans, expr[1], scope, reach, 
+                                                             reach, prof));
+    else if (fn == "AG")    return trans.AG(ctl_to_pred_care(sp, trans, expr[1], scope, reach, 
+                                                             reach, prof));
+    else if (fn == "AU")    return trans.AU(ctl_to_pred_care(sp, trans, expr[1], scope, reach, 
+                                                             reach, prof),
+                                            ctl_to_pred_care(sp, trans, expr[2], scope, reach,
+                                                             reach, prof));
+    else if (fn == "AR")    return trans.AR(ctl_to_pred_care(sp, trans, expr[1], scope, reach, 
+                                                             reach, prof),
+                                            ctl_to_pred_care(sp, trans, expr[2], scope, reach,
+                                                             reach, prof));
+    else if (fn == "let")
+    {
+        Scope inner(scope.lex, &scope);
+        bind_property(expr[1], inner);
+        return ctl_to_pred_care(sp, trans, expr[2], inner, care, reach, prof);
+    }
+    else return ctl_node_to_pred(sp, trans, expr, scope, prof);
+}
+
+Predicate ctl_to_pred_care(const StateSpace& sp, const Transition& trans, const SExpr& expr,
+                           const Scope& scope, const Predicate& care, const Predicate& reach,
+                           Profiler* prof)
+{
+    // Nothing is needed of a subformula that no state cares about
+    if(care.is_false()) return Predicate(sp, false);
+    if(prof) prof->begin_node(ctl_op_name(expr), expr.location);
+    Predicate ret = ctl_node_to_pred_care(sp, trans, expr, scope, care, reach, prof).restrict(care);
+    if(prof) prof->end_node(ret);
+    return ret;
+}
+
+/**
+ * Returns a canonical string for a CTL expression, used to identify properties in the result
+ * cache. Operands of the commutative operators and, or and xor are sorted so that reordering them
+ * does not change the string.
+ */
+std::string normalize_ctl(const SExpr& expr)
+{
+    if(expr.is_atom()) return expr.text.str();
+    std::string fn = expr.head().str();
+    std::vector<std::string> args;
+    for(size_t i = 1; i < expr.size(); ++i) args.push_back(normalize_ctl(expr[i]));
+    if(fn == "and" || fn == "or" || fn == "xor") std::sort(args.begin(), args.end());
+    std::string ret = "(" + fn;
+    for(size_t i = 0; i < args.size(); ++i) ret += " " + args[i];
+    return ret + ")";
+}
+
+/**
+ * Model checks a property without fairness constraints, writing out a witness or counterexample
+ * when possible to `trace`, and other messages to `out`. Names in the property are looked up in
+ * scope. Returns true if the property holds on all initial states. The evaluation is recorded with
+ * the profiler if one is given. The property is evaluated over `trans`, which may be reduced to the
+ * cone of influence of the property, while witnesses are generated over the `full` transition so
+ * that they are paths of the whole state.
+ */
+bool model_check_property(const StateSpace& space, const Transition& trans, const Transition& full,
+                          const Predicate& init, const SExpr& prop, const Scope& scope, bool care,
+                          Profiler* prof, std::ostream& out, TraceWriter& trace)
+{
+    // Look through lets and names at the top level so that witnesses can still be generated for
+    // the property they stand for
+    if(prop.head() == "let")
+    {
+        Scope inner(scope.lex, &scope);
+        bind_property(prop[1], inner);
+        return model_check_property(space, trans, full, init, prop[2], inner, care, prof, out,
+                                    trace);
+    }
+    Definition* def = prop.is_atom() ? scope.find(prop.text) : NULL;
+    if(def && def->offset != Definition::NO_SOURCE && check_definition(space, *def))
+        return model_check_property(space, trans, full, init, *def->prop, *def->scope, care,
+                                    prof, out, trace);
+    if(prop.is_atom())
+    {
+        bool sat = init.implies(ctl_to_pred(space, trans, prop, scope, prof));
+        out << "Could not generate witness or counterexample. " << std::endl;
+        return sat;
+    }
+    StrRef fn = prop.head();
+    if(prof) prof->begin_node(fn.str(), prop.location);
+    // Invariants are checked by a forward search from the initial states that stops at the first
+    // state found violating them, which also gives the shortest counterexample. Reachability of a
+    // predicate is checked the same way when there is a single initial state.
+    bool single_init = fn == "EF" && !init.is_false() && Predicate(State(init)) == init;
+    if((fn == "AG" || single_init) && is_propositional(space, prop[1], scope))
+    {
+        Predicate subpred = ctl_to_pred(space, trans, prop[1], scope, prof);
+        Predicate target = fn == "AG" ? !subpred : subpred;
+        size_t depth;
+        bool found = trans.reach(init, target, depth);
+        if(prof) prof->end_node(subpred);
+        if(found)
+        {
+            out << (fn == "AG" ? "Counterexample: " : "Witness: ") << std::endl;
+            full.gen_witness_reach(init, target, depth, trace);
+        }
+        else out << "Cannot generate " << (fn == "AG" ? "witness for AG" : "counterexample for EF")
+                 << std::endl;
+        return (fn == "AG") != found;
+    }
+    // With care sets, the operands of the outermost operator are only needed on the states
+    // reachable from the initial states
+    Predicate reach(space, true);
+    if(care && !is_propositional(space, prop, scope)) reach = trans.reachable(init);
+    // Case split over each outer level connective to handle each connective differently for
+    // cex/witness generation
+    // The outer fixpoint is given the initial states so that it stops as soon as the verdict is
+    // known. Its result is then only an iterate, but one that still guides the witness.
+    if(fn == "EF")
+    {
+        const SExpr& subprop = prop[1];
+        Predicate subpred = ctl_to_pred_care(space, trans, subprop, scope, reach, reach, prof);
+        Predicate pred = trans.EF(subpred, &init);
+        if(prof) prof->end_node(pred);
+        if(init.implies(pred))
+        {
+            out << "Witness: " << std::endl;
+            full.gen_witness_EF(init, pred, subpred, trace);
+            return true;
+        }
+        out << "Cannot generate counterexample for EF" << std::endl;
+        return false;
+    }
+    else if(fn == "EG")
+    {
+        const SExpr& subprop = prop[1];
+        Predicate subpred = ctl_to_pred_care(space, trans, subprop, scope, reach, reach, prof);
+        Predicate pred = trans.EG(subpred, &init);
+        if(prof) prof->end_node(pred);
+        if(init.implies(pred))
+        {
+            out << "Witness: " << std::endl;
+            full.gen_witness_EG(init, pred, subpred, trace);
+            return true;
+        }
+        out << "Cannot generate counterexample for EG" << std::endl;
+        return false;
+    }    
+    else if(fn == "EU")
+    {
+        const SExpr& subpropl = prop[1];
+        const SExpr& subpropr = prop[2];
+        Predicate subpredl = ctl_to_pred_care(space, trans, subpropl, scope, reach, reach, prof);
+        Predicate subpredr = ctl_to_pred_care(space, trans, subpropr, scope, reach, reach, prof);
+        Predicate pred = trans.EU(subpredl, subpredr, &init);
+        if(prof) prof->end_node(pred);
+        if(init.implies(pred))
+        {
+            out << "Witness: " << std::endl;
+            full.gen_witness_EU(init, pred, subpredl, subpredr, trace);
+            return true;
+        }
+        out << "Cannot generate counterexample for EU" << std::endl;
+        return false;
+    }
+    else if(fn == "ER")
+    {
+        const SExpr& subpropl = prop[1];
+        const SExpr& subpropr = prop[2];
+        Predicate subpredl = ctl_to_pred_care(space, trans, subpropl, scope, reach, reach, prof);
+        Predicate subpredr = ctl_to_pred_care(space, trans, subpropr, scope, reach, reach, prof);
+        Predicate pred = trans.ER(subpredl, subpredr, &init);
+        if(prof) prof->end_node(pred);
+        if(init.implies(pred))
+        {
+            out << "Witness: " << std::endl;
+            full.gen_witness_ER(init, pred, subpredl, subpredr, trace);
+            return true;
         }
-
-
-        // Parse file and build StateSpace, init Predicate and Transition
-        sexpresso::Sexp spec = sexpresso::parse(spec_str);
-        if(spec.isString())
+        out << "Cannot generate counterexample for ER" << std::endl;
+        return false;
+    }
+    else if(fn == "AF")
+    {
+        const SExpr& subprop = prop[1];
+        Predicate subpred = ctl_to_pred_care(space, trans, subprop, scope, reach, reach, prof);
+        Predicate pred = trans.AF(subpred, &init);
+        if(prof) prof->end_node(pred);
+        if(!init.implies(pred))
         {
-            std::cout << "Top level cannot be a string" << std::endl;
-            return EXIT_FAILURE;
+            out << "Counterexample: " << std::endl;
+            full.gen_cex_AF(init, pred, subpred, trace);
+            return false;
         }
-        spec = spec.value.sexp[0];
-        if(!spec.isSexp() || spec.value.sexp[0].value.str != std::string("system")
-                          || (spec.childCount() != 5 && spec.childCount() != 6)) 
-        { 
-            std::cout << "Top level must be of form (system n_bits init trans props [fairness])" << std::endl;
-            return EXIT_FAILURE;
+        out << "Cannot generate witness for AF" << std::endl;
+        return true;
+    }
+    else if(fn == "AG")
+    {
+        const SExpr& subprop = prop[1];
+        Predicate subpred = ctl_to_pred_care(space, trans, subprop, scope, reach, reach, prof);
+        Predicate pred = trans.AG(subpred, &init);
+        if(prof) prof->end_node(pred);
+        if(!init.implies(pred))
+        {
+            out << "Counterexample: " << std::endl;
+            full.gen_cex_AG(init, pred, subpred, trace);
+            return false;
         }
-        if(!spec.value.sexp[1].isString())
+        out << "Cannot generate witness for AG" << std::endl;
+        return true;
+    }   
+    else if(fn == "AU")
+    {
+        const SExpr& subpropl = prop[1];
+        const SExpr& subpropr = prop[2];
+        Predicate subpredl = ctl_to_pred_care(space, trans, subpropl, scope, reach, reach, prof);
+        Predicate subpredr = ctl_to_pred_care(space, trans, subpropr, scope, reach, reach, prof);
+        Predicate pred = trans.AU(subpredl, subpredr, &init);
+        if(prof) prof->end_node(pred);
+        if(!init.implies(pred))
         {
-            std::cout << "First arguement to system is expected to be an int"           << std::endl; 
-            std::cout << "representing the bit vector size."                            << std::endl;
-            return EXIT_FAILURE;
+            out << "Counterexample: " << std::endl;
+            full.gen_cex_AU(init, pred, subpredl, subpredr, trace);
+            return false;
         }
-        int bit_vector_size;
-        try { bit_vector_size = std::stoi(spec.value.sexp[1].value.str); }
-        catch(const std::invalid_argument& e)
+        out << "Cannot generate witness for AU" << std::endl;
+        return true;
+    }
+    else if(fn == "AR")
+    {
+        const SExpr& subpropl = prop[1];
+        const SExpr& subpropr = prop[2];
+        Predicate subpredl = ctl_to_pred_care(space, trans, subpropl, scope, reach, reach, prof);
+        Predicate subpredr = ctl_to_pred_care(space, trans, subpropr, scope, reach, reach, prof);
+        Predicate pred = trans.AR(subpredl, subpredr, &init);
+        if(prof) prof->end_node(pred);
+        if(!init.implies(pred))
         {
-            std::cout << "First arguement to system is expected to be an int"           << std::endl; 
-            std::cout << "representing the bit vector size."                            << std::endl;
-            return EXIT_FAILURE;
+            out << "Counterexample: " << std::endl;
+            full.gen_cex_AR(init, pred, subpredl, subpredr, trace);
+            return false;
         }
-        catch(const std::out_of_range& e)
+        out << "Cannot generate witness for AR" << std::endl;
+        return true;
+    }
+    // If the outermost connective is none of the above, then do the standard MC without
+    // counterexample generation.
+    Predicate pred = care ? ctl_node_to_pred_care(space, trans, prop, scope, init, reach, prof)
+                          : ctl_node_to_pred(space, trans, prop, scope, prof);
+    if(prof) prof->end_node(pred);
+    bool sat = !(pred && init).is_false();
+    out << "Could not generate witness or counterexample for top level " << fn << std::endl;
+    return sat;
+}
+
+/**
+ * Model checks a property under the fairness constraints of the transition. Returns true if the
+ * property holds on all initial states. The evaluation is recorded with the profiler if one is
+ * given.
+ */
+bool model_check_property_fair(const StateSpace& space, const Transition& trans, 
+                               const Predicate& init, const SExpr& prop, const Scope& scope,
+                               Profiler* prof)
+{
+    return init.implies(ctl_to_pred_fair(space, trans, prop, scope, prof));
+}
+
+/**
+ * Returns true if a valid property is an invariant, of the form (AG p) with p propositional
+ */
+bool is_invariant(const StateSpace& space, const SExpr& prop, const Scope& scope)
+{
+    return prop.head() == "AG" && is_propositional(space, prop[1], scope);
+}
+
+/**
+ * Checks an invariant against the layers of states reachable from the initial states, as computed
+ * by Transition::reach_layers, writing out a counterexample through the first layer that violates
+ * it to `trace`. Returns true if the invariant holds.
+ */
+bool check_invariant(const StateSpace& space, const Transition& full, const Predicate& init,
+                     const std::vector<Predicate>& layers, const SExpr& prop, const Scope& scope,
+                     Profiler* prof, std::ostream& out, TraceWriter& trace)
+{
+    if(prof) prof->begin_node("AG", prop.location);
+    Predicate bad = !ctl_to_pred(space, full, prop[1], scope, prof);
+    if(prof) prof->end_node(!bad);
+    for(size_t i = 0; i < layers.size(); ++i)
+        if(!(layers[i] && bad).is_false())
         {
-            std::cout << "State space requires too many bit vectors to represent"       << std::endl;
-            return EXIT_FAILURE;
+            out << "Counterexample: " << std::endl;
+            full.gen_witness_reach(init, bad, i, trace);
+            return false;
         }
-        StateSpace space(bit_vector_size);
-        Predicate init = parse_predicate(space, spec.value.sexp[2]);
-        Transition trans = parse_transition(space, spec.value.sexp[3]);
+    out << "Cannot generate witness for AG" << std::endl;
+    return true;
+}
 
 
+/**
+ * Largest number of edges of the explicit graph of a model, which takes 8 bytes per edge
+ */
+const size_t max_explicit_edges = size_t(1) << 24;
 
-        // Check syntax of the properties
-        if(!spec.value.sexp[4].isSexp() 
-                || !spec.value.sexp[4].value.sexp[0].isString()
-                || spec.value.sexp[4].value.sexp[0].value.str != std::string("properties"))
+/**
+ * Check the parsed properties of a model, with the statistics, profiling, progress reports and
+ * result caching requested in the options. Names in the properties are looked up in globals.
+ * The i-th property is checked under the fairness constraints of trans if `fair[i]` is set, and
+ * without them otherwise. Returns the exit status of the program.
+ */
+int check_properties(const Options& opts, const StateSpace& space, Transition& trans,
+                     const Predicate& init, const SExpr& props, const Scope& globals,
+                     const std::vector<bool>& fair, const std::string& cache_key)
+{
+    // Set up statistics collection if requested
+    std::ofstream stats_file;
+    if(opts.stats_json && !opts.stats_path.empty())
+    {
+        stats_file.open(opts.stats_path);
+        if(!stats_file.is_open())
         {
-            std::cout << "Fourth arguement to system should be (properties <prop1>)" << std::endl;
+            std::cout << "Failed to open statistics file" << std::endl;
             return EXIT_FAILURE;
         }
-        for(size_t i = 1; i < spec.value.sexp[4].childCount(); ++i)
-            if(!check_property(space, spec.value.sexp[4].value.sexp[i])) return EXIT_FAILURE;
-        std::cout << "Specification parsed, syntax is correct" << std::endl;
+    }
+    std::unique_ptr<StatsCollector> stats;
+    if(opts.stats_json)
+    {
+        stats.reset(new StatsCollector(trans, init, 
+                                       opts.stats_path.empty() ? std::cerr : stats_file));
+    }
 
 
-        // Check if fairness conditions are provided
-        if(spec.childCount() == 6)
-        {
-            std::cout << "Reading fairness conditions" << std::endl;
-            // Parse the fairness conditions
-            if(spec.value.sexp[5].isString())
-            {
-                std::cout << "Fifth argument should be a list of fairness conditions (f1 f2..)" <<
-                    std::endl;
-                return EXIT_FAILURE;
-            }
-            for(size_t i = 0; i < spec.value.sexp[5].childCount(); ++i)
-               trans.add_fairness(parse_predicate(space, spec.value.sexp[5].value.sexp[i]));
+    // Set up the profiler if requested
+    std::unique_ptr<Profiler> prof;
+    if(opts.profile)
+    {
+        prof.reset(new Profiler(trans, !opts.trace_path.empty()));
+    }
 
 
-            // Do the model checking
-            for(size_t i = 1; i < spec.value.sexp[4].childCount(); ++i)
-                std::cout << "Property " << i << " is " <<
-                    ((ctl_to_pred_fair(space, trans, spec.value.sexp[4].value.sexp[i]) || !init).is_true() ?
-                        "sat" : "unsat") << std::endl;
+    // Set up progress reports if requested
+    std::unique_ptr<ProgressReporter> progress;
+    if(opts.progress) 
+        progress.reset(new ProgressReporter(trans, std::cerr, opts.progress_interval));
 
 
-            return EXIT_SUCCESS;
-        }
+    // Small models are checked over an explicit graph of their states, unless it has too many
+    // edges. Reducing them to the cone of influence would only add edges to the graph.
+    bool cone = opts.cone;
+    if(space.state_bits <= opts.explicit_bits && trans.use_explicit(max_explicit_edges))
+        cone = false;
+    trans.set_fair_threads(opts.threads);
+    trans.keep_one_relation(opts.one_relation);
+    if(opts.random_witness) trans.set_witness_seed(opts.witness_seed);
 
-        
-        // Loop over all properties again and model check them
-        for(size_t i = 1; i < spec.value.sexp[4].childCount(); ++i)
+
+    // Loop over all properties again and model check them, skipping those whose result is
+    // cached. The result is keyed by the model and the normalized property.
+    std::unique_ptr<ResultCache> results;
+    if(!opts.result_dir.empty()) results.reset(new ResultCache(opts.result_dir));
+
+    // When there are several invariants, the states reachable from the initial states are computed
+    // once, when the first invariant is checked, and each invariant is then checked against them.
+    // The reachable states are found over the cone of influence of all of the invariants.
+    std::vector<bool> invariant(props.size(), false);
+    std::vector<bool> invariant_support(space.state_bits, false);
+    size_t n_invariants = 0;
+    for(size_t i = 1; i < props.size(); ++i)
+        if(!fair[i] && is_invariant(space, props[i], globals))
         {
-            const sexpresso::Sexp& prop = spec.value.sexp[4].value.sexp[i];
-            if(prop.isString())
-            {
-                std::cout << "Property " << i << " is " <<
-                    ((ctl_to_pred(space, trans, prop) || !init).is_true() ? "sat" : "unsat") << 
-                    std::endl;
-                std::cout << "Could not generate witness or counterexample. " << std::endl;
+            invariant[i] = true;
+            ++n_invariants;
+            property_support(space, props[i], globals, invariant_support);
+        }
+    std::vector<Predicate> layers;
+    bool have_layers = false;
+    std::unique_ptr<Simulator> simulator;
+    for(size_t i = 1; i < props.size(); ++i)
+    {
+        const SExpr& prop = props[i];
+        // Witnesses and counterexamples go in the report as text, or to a file of their own
+        std::string trace_path;
+        if(opts.trace_format != "text")
+            trace_path = opts.trace_dir + "/property" + std::to_string(i) + "." + 
+                         trace_extension(opts.trace_format);
 
-            }
-            const std::string& fn = prop.value.sexp[0].value.str;
-            // Case split over each outer level connective to handle each connective differently for
-            // cex/witness generation
-            if(fn == "EF")
+        std::string result_key = cache_key + " " + normalize_ctl(prop);
+        if(opts.random_witness) result_key += " seed " + std::to_string(opts.witness_seed);
+        if(!trace_path.empty()) result_key += " trace " + trace_path;
+        std::string report, trace_bytes;
+        bool sat;
+        if(results && results->load(result_key, sat, report, trace_bytes))
+        {
+            // The trace file is written again from the entry, as it may have changed since
+            if(!trace_bytes.empty())
             {
-                const sexpresso::Sexp& subprop = prop.value.sexp[1];
-                Predicate subpred = ctl_to_pred(space, trans, subprop);
-                Predicate pred = trans.EF(subpred);
-                if((pred || !init).is_true())
-                {
-                    std::cout << "Property " << i << " is sat." << std::endl;
-                    std::cout << "Witness: " << std::endl;
-                    trans.gen_witness_EF(init, pred, subpred).print();
-                }
-                else
+                std::ofstream trace_file(trace_path, std::ios::binary);
+                if(!trace_file.write(trace_bytes.data(), trace_bytes.size()))
                 {
-                    std::cout << "Property " << i << " is unsat." << std::endl;
-                    std::cout << "Cannot generate counterexample for EF" << std::endl;
+                    std::cout << "Failed to write trace file " << trace_path << std::endl;
+                    return EXIT_FAILURE;
                 }
             }
-            else if(fn == "EG")
+            std::cout << "Property " << i << " is " << (sat ? "sat." : "unsat.") << 
+                " (cached)" << std::endl;
+            std::cout << report;
+            continue;
+        }
+
+        // Check the property over the cone of influence of the bits it depends on, unless that is
+        // the whole state
+        bool shared = n_invariants > 1 && invariant[i];
+        const Transition* checked = &trans;
+        Transition reduced(space, false);
+        int reduced_bits = space.state_bits;
+        if(cone && !(shared && have_layers))
+        {
+            std::vector<bool> in_support(space.state_bits, false);
+            if(shared) in_support = invariant_support;
+            else property_support(space, prop, globals, in_support);
+            std::vector<int> cone;
+            for(int b = 0; b < space.state_bits; ++b) if(in_support[b]) cone.push_back(b);
+            trans.cone_of_influence(cone, reduced);
+            reduced_bits = cone.size();
+            if(reduced_bits < space.state_bits) checked = &reduced;
+        }
+
+        std::ostringstream report_stream;
+        std::ofstream trace_file;
+        if(!trace_path.empty())
+        {
+            trace_file.open(trace_path, std::ios::binary);
+            if(!trace_file.is_open())
             {
-                const sexpresso::Sexp& subprop = prop.value.sexp[1];
-                Predicate subpred = ctl_to_pred(space, trans, subprop);
-                Predicate pred = trans.EG(subpred);
-                if((pred || !init).is_true())
-                {
-                    std::cout << "Property " << i << " is sat." << std::endl;
-                    std::cout << "Witness: " << std::endl;
-                    trans.gen_witness_EG(init, pred, subpred).print();
-                }
-                else
-                {
-                    std::cout << "Property " << i << " is unsat." << std::endl;
-                    std::cout << "Cannot generate counterexample for EG" << std::endl;
-                }
-            }    
-            else if(fn == "EU")
+                std::cout << "Failed to open trace file " << trace_path << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        std::unique_ptr<BufferedTraceWriter> trace(make_trace_writer(opts.trace_format, 
+                trace_path.empty() ? static_cast<std::ostream&>(report_stream) : trace_file));
+
+        if(stats) stats->begin_property();
+        if(stats && checked == &reduced) stats->set_cone(reduced, reduced_bits);
+        if(prof) prof->begin_property(i);
+        if(progress) progress->begin_property(i);
+        // Invariants are first tried on random runs from the initial states, which find shallow
+        // violations without computing any fixpoint. The simulator is set up for the first one.
+        std::vector<State> run;
+        bool simulated = false;
+        if(opts.simulate_runs > 0 && !fair[i] && !prop.is_atom() && prop.head() == "AG" &&
+                is_propositional(space, prop[1], globals))
+        {
+            if(!simulator) simulator.reset(new Simulator(trans, init, opts.threads));
+            simulated = simulator->run(!ctl_to_pred(space, trans, prop[1], globals), 
+                                       opts.simulate_runs, opts.simulate_depth, opts.witness_seed,
+                                       run);
+        }
+        if(simulated)
+        {
+            sat = false;
+            report_stream << "Counterexample from random simulation: " << std::endl;
+            trace->begin(space, true);
+            for(std::vector<State>::const_iterator s = run.begin(); s != run.end(); ++s)
+                trace->state(*s);
+            trace->end(0);
+        }
+        else
+        {
+            if(shared && !have_layers)
             {
-                const sexpresso::Sexp& subpropl = prop.value.sexp[1];
-                const sexpresso::Sexp& subpropr = prop.value.sexp[2];
-                Predicate subpredl = ctl_to_pred(space, trans, subpropl);
-                Predicate subpredr = ctl_to_pred(space, trans, subpropr);
-                Predicate pred = trans.EU(subpredl, subpredr);
-                if((pred || !init).is_true())
-                {
-                    std::cout << "Property " << i << " is sat." << std::endl;
-                    std::cout << "Witness: " << std::endl;
-                    trans.gen_witness_EU(init, pred, subpredl, subpredr).print();
-                }
-                else
-                {
-                    std::cout << "Property " << i << " is unsat." << std::endl;
-                    std::cout << "Cannot generate counterexample for EU" << std::endl;
-                }
+                checked->reach_layers(init, layers);
+                have_layers = true;
             }
-            else if(fn == "ER")
+            if(shared) sat = check_invariant(space, trans, init, layers, prop, globals, 
+                                             prof.get(), report_stream, *trace);
+            else if(fair[i]) sat = model_check_property_fair(space, *checked, init, prop, globals, 
+                                                          prof.get());
+            else sat = model_check_property(space, *checked, trans, init, prop, globals, 
+                                            opts.care, prof.get(), report_stream, *trace);
+        }
+        if(stats) stats->end_property(i, sat);
+        if(!trace_path.empty())
+        {
+            trace_file.close();
+            if(trace->written()) 
             {
-                const sexpresso::Sexp& subpropl = prop.value.sexp[1];
-                const sexpresso::Sexp& subpropr = prop.value.sexp[2];
-                Predicate subpredl = ctl_to_pred(space, trans, subpropl);
-                Predicate subpredr = ctl_to_pred(space, trans, subpropr);
-                Predicate pred = trans.ER(subpredl, subpredr);
-                if((pred || !init).is_true())
-                {
-                    std::cout << "Property " << i << " is sat." << std::endl;
-                    std::cout << "Witness: " << std::endl;
-                    trans.gen_witness_ER(init, pred, subpredl, subpredr).print();
-                }
-                else
+                report_stream << "Written to " << trace_path << std::endl;
+                if(results)
                 {
-                    std::cout << "Property " << i << " is unsat." << std::endl;
-                    std::cout << "Cannot generate counterexample for ER" << std::endl;
+                    std::ifstream written(trace_path, std::ios::binary);
+                    std::ostringstream bytes;
+                    bytes << written.rdbuf();
+                    trace_bytes = bytes.str();
                 }
             }
-            else if(fn == "AF")
+            else std::remove(trace_path.c_str());
+        }
+        std::cout << "Property " << i << " is " << (sat ? "sat." : "unsat.") << std::endl;
+        std::cout << report_stream.str();
+
+        if(results)
+        {
+            try { results->store(result_key, sat, report_stream.str(), trace_bytes); }
+            catch(const std::runtime_error& e)
             {
-                const sexpresso::Sexp& subprop = prop.value.sexp[1];
-                Predicate subpred = ctl_to_pred(space, trans, subprop);
-                Predicate pred = trans.AF(subpred);
-                if(!((pred || !init).is_true()))
-                {
-                    std::cout << "Property " << i << " is unsat." << std::endl;
-                    std::cout << "Counterexample: " << std::endl;
-                    trans.gen_cex_AF(init, pred, subpred).print();
-                }
-                else
-                {
-                    std::cout << "Property " << i << " is sat." << std::endl;
-                    std::cout << "Cannot generate witness for AF" << std::endl;
-                }
+                std::cout << "Could not save result to cache: " << e.what() << std::endl;
             }
-            else if(fn == "AG")
+        }
+    }
+
+
+    // Write out the profile
+    if(prof)
+    {
+        prof->print_hotspots(std::cout);
+        if(!opts.trace_path.empty())
+        {
+            std::ofstream trace_file(opts.trace_path);
+            if(!trace_file.is_open())
             {
-                const sexpresso::Sexp& subprop = prop.value.sexp[1];
-                Predicate subpred = ctl_to_pred(space, trans, subprop);
-                Predicate pred = trans.AG(subpred);
-                if(!((pred || !init).is_true()))
-                {
-                    std::cout << "Property " << i << " is unsat." << std::endl;
-                    std::cout << "Counterexample: " << std::endl;
-                    trans.gen_cex_AG(init, pred, subpred).print();
-                }
-                else
-                {
-                    std::cout << "Property " << i << " is sat." << std::endl;
-                    std::cout << "Cannot generate witness for AG" << std::endl;
-                }
-            }   
-            else if(fn == "AU")
+                std::cout << "Failed to open profile trace file" << std::endl;
+                return EXIT_FAILURE;
+            }
+            prof->write_trace(trace_file);
+        }
+    }
+
+
+    return EXIT_SUCCESS;
+}
+
+
+
+/**
+ * Check the properties of a circuit in the AIGER format. Its bad states are bound to names in the
+ * properties section generated for it, and the model is cached under a hash of the whole file.
+ * Returns the exit status of the program.
+ */
+int check_aiger(const Options& opts, const MappedFile& file)
+{
+    Aiger circuit(file.data(), file.size());
+    std::cout << "Read AIGER circuit with " << circuit.num_inputs() << " inputs and " <<
+        circuit.num_latches() << " latches" << std::endl;
+    StateSpace space(circuit.num_latches(), circuit.num_inputs());
+    Predicate init(space, false);
+    Transition trans(space, false);
+
+
+    // Load the model from the cache if possible, else build it
+    std::string cache_key;
+    if(!opts.cache_dir.empty() || !opts.result_dir.empty())
+    {
+        StreamHash hash;
+        hash.add(file.data(), file.size());
+        cache_key = hash.hex();
+    }
+    std::unique_ptr<ModelCache> cache;
+    bool cached = false;
+    if(!opts.cache_dir.empty())
+    {
+        cache.reset(new ModelCache(opts.cache_dir));
+        cached = cache->load(cache_key, init, trans);
+        if(cached) std::cout << "Loaded model from cache" << std::endl;
+    }
+    if(!cached) circuit.build_model(space, init, trans);
+    if(cache && !cached)
+    {
+        try { cache->store(cache_key, init, trans); }
+        catch(const std::runtime_error& e)
+        {
+            std::cout << "Could not save model to cache: " << e.what() << std::endl;
+        }
+    }
+
+
+    // Bind the bad states and read the generated properties
+    const std::string& text = circuit.properties();
+    Lexer lex(text.data(), text.size());
+    Scope globals(lex, NULL);
+    std::vector<Predicate> signals = circuit.build_signals(space);
+    const std::vector<std::string>& names = circuit.signal_names();
+    for(size_t i = 0; i < names.size(); ++i)
+        globals.bind(StrRef(names[i].data(), names[i].size()), signals[i]);
+    SExpr props = parse_sexpr(lex);
+    const std::vector<std::string>& descs = circuit.descriptions();
+    for(size_t i = 0; i < descs.size(); ++i)
+        std::cout << "Property " << i + 1 << " checks " << descs[i] << std::endl;
+
+    std::vector<bool> fair(props.size(), false);
+    for(size_t i = 1; i < props.size(); ++i) fair[i] = circuit.fair(i);
+    return check_properties(opts, space, trans, init, props, globals, fair, cache_key);
+}
+
+
+
+/**
+ * Main method
+ */
+int main(int argc, char** argv)
+{
+    try
+    {
+        // Read command line arguments
+        Options opts;
+        if(!parse_args(argc, argv, opts)) return EXIT_FAILURE;
+        const std::string& spec_path = opts.spec_path;
+
+        // The BDD package must be chosen before any BDD is made
+        if(opts.backend == "parallel") BDD::set_backend(new ParallelBackend(opts.bdd_threads));
+        
+        std::cout << "Loading specification from file: " << spec_path << std::endl;
+
+
+        // Map the specification file. It is read in a single pass in the order of its sections,
+        // building the BDDs as each expression is read. Circuits in the AIGER format are told
+        // apart by their header and read separately.
+        std::unique_ptr<MappedFile> spec_file;
+        try { spec_file.reset(new MappedFile(spec_path)); }
+        catch(const std::runtime_error& e)
+        {
+            std::cout << "Failed to open specification file" << std::endl;
+            return EXIT_FAILURE;
+        }
+        if(Aiger::is_aiger(spec_file->data(), spec_file->size()))
+            return check_aiger(opts, *spec_file);
+        Lexer lex(spec_file->data(), spec_file->size());
+
+
+        // Read the defines and variable declarations preceding the system. Defines are only built
+        // when first used, and variables are given bits once the size of the state is known. If
+        // caching, they are hashed as part of the model.
+        bool caching = !opts.cache_dir.empty() || !opts.result_dir.empty();
+        StreamHash hash;
+        Scope globals(lex, NULL);
+        std::vector<Declaration> decls;
+        Token open = lex.next();
+        StrRef head = lex.next().text;
+        for(size_t group = 0; open.kind == Token::OPEN && head != "system"; ++group)
+        {
+            if(head == "word" || head == "input" || head == "enum" || head == "interleave")
             {
-                const sexpresso::Sexp& subpropl = prop.value.sexp[1];
-                const sexpresso::Sexp& subpropr = prop.value.sexp[2];
-                Predicate subpredl = ctl_to_pred(space, trans, subpropl);
-                Predicate subpredr = ctl_to_pred(space, trans, subpropr);
-                Predicate pred = trans.AU(subpredl, subpredr);
-                if(!((pred || !init).is_true()))
-                {
-                    std::cout << "Property " << i << " is unsat." << std::endl;
-                    std::cout << "Counterexample: " << std::endl;
-                    trans.gen_cex_AU(init, pred, subpredl, subpredr).print();
-                }
-                else
+                read_declaration(lex, open, head, group, decls);
+                if(caching)
                 {
-                    std::cout << "Property " << i << " is sat." << std::endl;
-                    std::cout << "Cannot generate witness for AU" << std::endl;
+                    lex.seek(open.offset);
+                    hash_expr(lex, hash);
                 }
             }
-            else if(fn == "AR")
+            else if(head == "define")
             {
-                const sexpresso::Sexp& subpropl = prop.value.sexp[1];
-                const sexpresso::Sexp& subpropr = prop.value.sexp[2];
-                Predicate subpredl = ctl_to_pred(space, trans, subpropl);
-                Predicate subpredr = ctl_to_pred(space, trans, subpropr);
-                Predicate pred = trans.AR(subpredl, subpredr);
-                if(!((pred || !init).is_true()))
+                Token name = lex.next();
+                if(name.kind != Token::ATOM || !globals.bind(name.text, lex.peek().offset))
                 {
-                    std::cout << "Property " << i << " is unsat." << std::endl;
-                    std::cout << "Counterexample: " << std::endl;
-                    trans.gen_cex_AR(init, pred, subpredl, subpredr).print();
+                    std::cout << "Define must be of form (define <name> <expr>) with a new name" << 
+                        std::endl;
+                    return EXIT_FAILURE;
                 }
-                else
+                hash.add(name.text.data, name.text.size);
+                if(caching) hash_expr(lex, hash);
+                else lex.skip();
+                if(lex.next().kind != Token::CLOSE)
                 {
-                    std::cout << "Property " << i << " is sat." << std::endl;
-                    std::cout << "Cannot generate witness for AR" << std::endl;
+                    std::cout << "Define must be of form (define <name> <expr>) with a new name" << 
+                        std::endl;
+                    return EXIT_FAILURE;
                 }
             }
-            // If the outermost connective is none of the above, then do the standard MC without
-            // counterexample generation.
-            else 
+            else break;
+            open = lex.next();
+            head = lex.next().text;
+        }
+
+
+        // Parse header and build StateSpace
+        if(open.kind != Token::OPEN || head != "system")
+        { 
+            std::cout << "Top level must be of form (system n_bits init trans props [fairness])" << std::endl;
+            return EXIT_FAILURE;
+        }
+        Token n_bits = lex.next();
+        if(n_bits.kind != Token::ATOM)
+        {
+            std::cout << "First arguement to system is expected to be an int"           << std::endl; 
+            std::cout << "representing the bit vector size."                            << std::endl;
+            return EXIT_FAILURE;
+        }
+        int bit_vector_size;
+        try { bit_vector_size = std::stoi(n_bits.text.str()); }
+        catch(const std::invalid_argument& e)
+        {
+            std::cout << "First arguement to system is expected to be an int"           << std::endl; 
+            std::cout << "representing the bit vector size."                            << std::endl;
+            return EXIT_FAILURE;
+        }
+        catch(const std::out_of_range& e)
+        {
+            std::cout << "State space requires too many bit vectors to represent"       << std::endl;
+            return EXIT_FAILURE;
+        }
+        StateSpace space(bit_vector_size, count_input_bits(decls));
+        declare_variables(space, lex, globals, decls);
+        Predicate init(space, false);
+        Transition trans(space, false);
+
+
+        // If caching, the model is keyed by a hash of the tokens of the defines and the system
+        // section without the properties. Computing it takes a pass over the model that does not
+        // build anything, after which we return to the start of the initial state predicate.
+        std::string cache_key;
+        if(caching)
+        {
+            size_t model_start = lex.position();
+            hash.add(n_bits.text.data, n_bits.text.size);
+            hash_expr(lex, hash);
+            hash_expr(lex, hash);
+            lex.skip();
+            if(lex.peek().kind != Token::CLOSE) hash_expr(lex, hash);
+            cache_key = hash.hex();
+            lex.seek(model_start);
+        }
+
+
+        // Load the model from the cache if possible, else build it
+        std::unique_ptr<ModelCache> cache;
+        bool cached = false;
+        if(!opts.cache_dir.empty())
+        {
+            cache.reset(new ModelCache(opts.cache_dir));
+            cached = cache->load(cache_key, init, trans);
+            if(cached) std::cout << "Loaded model from cache" << std::endl;
+        }
+        if(cached)
+        {
+            lex.skip();
+            lex.skip();
+        }
+        else
+        {
+            init = parse_predicate(space, lex, globals);
+            trans = parse_system_transition(space, lex, globals, opts.threads);
+        }
+
+
+
+        // Parse properties and check their syntax. These are kept as trees as they are needed
+        // after the fairness constraints are read.
+        if(lex.peek().kind != Token::OPEN)
+        {
+            std::cout << "Fourth arguement to system should be (properties <prop1>)" << std::endl;
+            return EXIT_FAILURE;
+        }
+        SExpr props = parse_sexpr(lex);
+        if(props.head() != "properties")
+        {
+            std::cout << "Fourth arguement to system should be (properties <prop1>)" << std::endl;
+            return EXIT_FAILURE;
+        }
+        for(size_t i = 1; i < props.size(); ++i)
+            if(!check_property(space, props[i], globals)) return EXIT_FAILURE;
+        std::cout << "Specification parsed, syntax is correct" << std::endl;
+
+
+        // Check if fairness conditions are provided
+        Token::Kind after_props = lex.peek().kind;
+        bool fair = after_props != Token::CLOSE && after_props != Token::END;
+        if(fair)
+        {
+            std::cout << "Reading fairness conditions" << std::endl;
+            // Parse the fairness conditions
+            if(lex.peek().kind != Token::OPEN)
             {
-                std::cout << "Property " << i << " is " <<
-                    ((ctl_to_pred(space, trans, prop) && init).is_false() ? "unsat" : "sat") << 
-                    std::endl;
-                std::cout << "Could not generate witness or counterexample for top level " << fn <<
+                std::cout << "Fifth argument should be a list of fairness conditions (f1 f2..)" <<
                     std::endl;
-            } 
+                return EXIT_FAILURE;
+            }
+            if(cached) lex.skip();
+            else
+            {
+                lex.next();
+                while(lex.peek().kind != Token::CLOSE)
+                    trans.add_fairness(parse_predicate(space, lex, globals));
+                lex.next();
+            }
+        }
+        if(lex.next().kind != Token::CLOSE)
+        { 
+            std::cout << "Top level must be of form (system n_bits init trans props [fairness])" << std::endl;
+            return EXIT_FAILURE;
         }
 
-        
-        
+
+        // Save the model for later runs
+        if(cache && !cached)
+        {
+            try { cache->store(cache_key, init, trans); }
+            catch(const std::runtime_error& e)
+            {
+                std::cout << "Could not save model to cache: " << e.what() << std::endl;
+            }
+        }
 
 
-        return EXIT_SUCCESS;
+        return check_properties(opts, space, trans, init, props, globals, 
+                                std::vector<bool>(props.size(), fair), cache_key);
     }
     catch(const std::exception& e)
     {
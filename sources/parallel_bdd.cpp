@@ -0,0 +1,954 @@
+/**
+ * This file implements the parallel BDD backend declared in `headers/parallel_bdd.hpp`.
+ */
+
+#include "headers/parallel_bdd.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <stdexcept>
+#include <unordered_set>
+
+
+// Edges to the constant node, which has index 0, and the edge returned by operations abandoned
+// because the table filled up
+static const uint32_t ONE = 0;
+static const uint32_t ZERO = 1;
+static const uint32_t INVALID = 0xffffffff;
+
+// Variable index of the constant node, below all the others
+static const uint32_t CONST_VAR = 0x7fffffff;
+
+// Largest table, so that edges fit in 32 bits, and the number of free nodes handed to a worker at
+// a time
+static const size_t MAX_NODES = size_t(1) << 30;
+static const size_t CHUNK = 256;
+
+// Operations, as cached and as run by tasks
+enum { OP_AND, OP_XOR, OP_ITE, OP_EXISTS, OP_AND_EXISTS, OP_RESTRICT, OP_LEQ };
+
+// Complement an edge, leaving the invalid edge as it is
+static inline uint32_t neg(uint32_t e) { return e == INVALID ? e : e ^ 1; }
+
+// Mix the bits of a 64 bit value, as in the finalizer of MurmurHash3
+static inline uint64_t mix(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static inline uint64_t node_hash(uint32_t var, uint32_t then_edge, uint32_t else_edge)
+{
+    return mix(((uint64_t(var) << 32) | then_edge) ^ mix(else_edge + 0x9e3779b97f4a7c15ULL));
+}
+
+// Cache keys of an operation on up to three edges
+static inline uint64_t op_key(int op, uint32_t f) { return (uint64_t(op) << 32) | f; }
+static inline uint64_t edge_pair(uint32_t g, uint32_t h) { return (uint64_t(g) << 32) | h; }
+
+
+
+/**
+ * Impl ParallelBackend
+ */
+
+// An entry of the operation cache, guarded by a sequence number that is odd while it is written.
+// Readers check that the number did not change while they read the entry, and writers skip
+// entries that are being written, so entries are never torn.
+struct ParallelBackend::CacheEntry
+{
+    std::atomic<uint32_t> seq;
+    std::atomic<uint32_t> result;
+    std::atomic<uint64_t> key0;
+    std::atomic<uint64_t> key1;
+};
+
+// A subproblem offered to other workers. It lives on the stack of the worker that made it, which
+// waits for it to be done before returning.
+struct ParallelBackend::Task
+{
+    int op;
+    Edge f, g, h;
+    unsigned depth;
+    Edge result;
+    std::atomic<bool> done;
+};
+
+// The deque of tasks of a thread, its share of the free nodes, and its cache counters
+struct ParallelBackend::Worker
+{
+    size_t id;
+    std::mutex mutex;
+    std::deque<Task*> tasks;
+    size_t next_free;
+    size_t end_free;
+    uint32_t spare;                     // A node allocated but not used
+    std::atomic<uint64_t> lookups;
+    std::atomic<uint64_t> hits;
+};
+
+
+// Ctor and dtor
+ParallelBackend::ParallelBackend(unsigned n_threads, size_t initial_nodes)
+    : bucket_mask(0), cache_mask(0), free_pos(0), live_after_gc(1), table_full(false), n_vars(0),
+      spawn_depth(0), stopping(false), sleeping(0), wake_gen(0), peak_nodes(1), gc_count(0),
+      gc_time(0)
+{
+    if(n_threads < 1) n_threads = 1;
+    size_t size = 1024;
+    while(size < initial_nodes && size < MAX_NODES) size <<= 1;
+    nodes.resize(size);
+    refs.assign(size, 0);
+    nodes[0].var = CONST_VAR;
+    nodes[0].then_edge = nodes[0].else_edge = ONE;
+
+    for(unsigned i = 0; i < n_threads; ++i)
+    {
+        Worker* w = new Worker();
+        w->id = i;
+        w->next_free = w->end_free = 0;
+        w->spare = 0;
+        w->lookups = 0;
+        w->hits = 0;
+        workers.push_back(std::unique_ptr<Worker>(w));
+    }
+    // Offer tasks a few levels below the depth that gives one to each thread, so that the work
+    // balances when the two sides of a node differ in size
+    if(n_threads > 1)
+    {
+        while((1u << spawn_depth) < n_threads) ++spawn_depth;
+        spawn_depth += 4;
+    }
+
+    collect(false);
+    for(unsigned i = 1; i < n_threads; ++i)
+        threads.push_back(std::thread(&ParallelBackend::worker_loop, this, std::ref(*workers[i])));
+}
+
+ParallelBackend::~ParallelBackend()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stopping = true;
+        ++wake_gen;
+    }
+    sleep_cv.notify_all();
+    for(size_t i = 0; i < threads.size(); ++i) threads[i].join();
+}
+
+// The new backends are for threads that already run alongside others, so they work alone
+BDDBackend* ParallelBackend::create() const { return new ParallelBackend(1); }
+
+
+// Running operations. Only the calling thread starts operations, and it finishes every task of
+// one before returning, so the workers are idle whenever the table is collected.
+ParallelBackend::Edge ParallelBackend::run(const std::function<Edge(Worker&)>& op)
+{
+    // Collect before the table gets full, and grow it if that leaves it over half full
+    if(nodes_used() > nodes.size() / 4 * 3)
+    {
+        collect(false);
+        if(nodes_used() > nodes.size() / 2 && nodes.size() < MAX_NODES) collect(true);
+    }
+    if(sleeping.load())
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        ++wake_gen;
+        sleep_cv.notify_all();
+    }
+    for(bool retry = false; ; retry = true)
+    {
+        Edge ret = op(*workers[0]);
+        if(ret != INVALID)
+        {
+            peak_nodes = std::max<long>(peak_nodes, nodes_used());
+            return ret;
+        }
+        // The operation filled the table. Collect and try again, growing the table if it fills
+        // again.
+        if(retry && nodes.size() >= MAX_NODES) throw std::runtime_error("BDD node table is full");
+        collect(retry);
+    }
+}
+
+ParallelBackend::Edge ParallelBackend::dispatch(Worker& w, int op, Edge f, Edge g, Edge h,
+                                                unsigned depth)
+{
+    switch(op)
+    {
+        case OP_AND:        return and_rec(w, f, g, depth);
+        case OP_XOR:        return xor_rec(w, f, g, depth);
+        case OP_ITE:        return ite_rec(w, f, g, h, depth);
+        case OP_EXISTS:     return exists_rec(w, f, g, depth);
+        case OP_AND_EXISTS: return and_exists_rec(w, f, g, h, depth);
+    }
+    throw std::runtime_error("Unknown BDD task");
+}
+
+void ParallelBackend::fork(Worker& w, Task& task)
+{
+    std::lock_guard<std::mutex> lock(w.mutex);
+    w.tasks.push_back(&task);
+}
+
+ParallelBackend::Edge ParallelBackend::join(Worker& w, Task& task)
+{
+    {
+        // Tasks are pushed and popped in nested order, so an unstolen task is at the back
+        std::unique_lock<std::mutex> lock(w.mutex);
+        if(!w.tasks.empty() && w.tasks.back() == &task)
+        {
+            w.tasks.pop_back();
+            lock.unlock();
+            return dispatch(w, task.op, task.f, task.g, task.h, task.depth);
+        }
+    }
+    // The task was stolen, so help with other tasks until it is done
+    while(!task.done.load(std::memory_order_acquire))
+        if(!steal(w)) std::this_thread::yield();
+    return task.result;
+}
+
+// Take the oldest task, which is the largest, of another worker and run it
+bool ParallelBackend::steal(Worker& w)
+{
+    for(size_t k = 1; k < workers.size(); ++k)
+    {
+        Worker& victim = *workers[(w.id + k) % workers.size()];
+        Task* task;
+        {
+            std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+            if(!lock.owns_lock() || victim.tasks.empty()) continue;
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+        }
+        task->result = dispatch(w, task->op, task->f, task->g, task->h, task->depth);
+        task->done.store(true, std::memory_order_release);
+        return true;
+    }
+    return false;
+}
+
+void ParallelBackend::worker_loop(Worker& w)
+{
+    unsigned idle = 0;
+    while(!stopping.load())
+    {
+        if(steal(w))
+        {
+            idle = 0;
+            continue;
+        }
+        if(++idle < 2048)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        // Sleep until the next operation starts
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        unsigned gen = wake_gen;
+        ++sleeping;
+        sleep_cv.wait(lock, [&] { return stopping.load() || wake_gen != gen; });
+        --sleeping;
+        idle = 0;
+    }
+}
+
+void ParallelBackend::split(Worker& w, int op, Edge f1, Edge g1, Edge h1, Edge f0, Edge g0,
+                            Edge h0, unsigned depth, Edge& r1, Edge& r0)
+{
+    if(depth >= spawn_depth)
+    {
+        r1 = dispatch(w, op, f1, g1, h1, depth + 1);
+        r0 = dispatch(w, op, f0, g0, h0, depth + 1);
+        return;
+    }
+    Task task;
+    task.op = op;
+    task.f = f1;
+    task.g = g1;
+    task.h = h1;
+    task.depth = depth + 1;
+    task.done = false;
+    fork(w, task);
+    r0 = dispatch(w, op, f0, g0, h0, depth + 1);
+    r1 = join(w, task);
+}
+
+
+// Nodes
+uint32_t ParallelBackend::alloc(Worker& w)
+{
+    if(w.spare)
+    {
+        uint32_t ret = w.spare;
+        w.spare = 0;
+        return ret;
+    }
+    if(w.next_free == w.end_free)
+    {
+        size_t start = free_pos.fetch_add(CHUNK);
+        if(start >= free_slots.size())
+        {
+            table_full = true;
+            return 0;
+        }
+        w.next_free = start;
+        w.end_free = std::min(start + CHUNK, free_slots.size());
+    }
+    return free_slots[w.next_free++];
+}
+
+ParallelBackend::Edge ParallelBackend::make_node(Worker& w, uint32_t var, Edge then_edge,
+                                                 Edge else_edge)
+{
+    if(then_edge == else_edge) return then_edge;
+    // Keep the then edge regular by complementing the node instead
+    Edge cmpl = then_edge & 1;
+    then_edge ^= cmpl;
+    else_edge ^= cmpl;
+
+    // Probe from the hash of the node for a bucket holding it, or an empty one to put it in. A
+    // new node is written before its bucket is set, so any worker finding it sees it whole.
+    uint64_t hash = node_hash(var, then_edge, else_edge);
+    uint64_t tag = hash >> 32;
+    uint32_t fresh = 0;
+    size_t pos = hash & bucket_mask;
+    for(size_t probes = 0; probes <= bucket_mask; ++probes, pos = (pos + 1) & bucket_mask)
+    {
+        uint64_t bucket = buckets[pos].load(std::memory_order_acquire);
+        if(!bucket)
+        {
+            if(!fresh)
+            {
+                fresh = alloc(w);
+                if(!fresh) return INVALID;
+                nodes[fresh].var = var;
+                nodes[fresh].then_edge = then_edge;
+                nodes[fresh].else_edge = else_edge;
+            }
+            if(buckets[pos].compare_exchange_strong(bucket, (tag << 32) | fresh,
+                                                    std::memory_order_acq_rel))
+                return (fresh << 1) | cmpl;
+            // Another worker took the bucket first, and bucket now holds what it put there
+        }
+        if((bucket >> 32) == tag)
+        {
+            uint32_t index = bucket & 0xffffffff;
+            const TableNode& nd = nodes[index];
+            if(nd.var == var && nd.then_edge == then_edge && nd.else_edge == else_edge)
+            {
+                if(fresh) w.spare = fresh;
+                return (index << 1) | cmpl;
+            }
+        }
+    }
+    if(fresh) w.spare = fresh;
+    table_full = true;
+    return INVALID;
+}
+
+void ParallelBackend::cofactors(Edge e, uint32_t var, Edge& e1, Edge& e0) const
+{
+    const TableNode& nd = nodes[e >> 1];
+    if(nd.var != var)
+    {
+        e1 = e0 = e;
+        return;
+    }
+    e1 = nd.then_edge ^ (e & 1);
+    e0 = nd.else_edge ^ (e & 1);
+}
+
+// Put an existing node in the unique table, with no other thread running
+void ParallelBackend::insert_bucket(uint32_t index)
+{
+    const TableNode& nd = nodes[index];
+    uint64_t hash = node_hash(nd.var, nd.then_edge, nd.else_edge);
+    size_t pos = hash & bucket_mask;
+    while(buckets[pos].load(std::memory_order_relaxed)) pos = (pos + 1) & bucket_mask;
+    buckets[pos].store(((hash >> 32) << 32) | index, std::memory_order_relaxed);
+}
+
+
+// Cache
+bool ParallelBackend::cache_get(Worker& w, uint64_t key0, uint64_t key1, Edge& result)
+{
+    // Only this worker writes its counters
+    w.lookups.store(w.lookups.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    CacheEntry& entry = cache[mix(key0 ^ mix(key1)) & cache_mask];
+    uint32_t seq = entry.seq.load(std::memory_order_acquire);
+    if(seq & 1) return false;
+    uint64_t read0 = entry.key0.load(std::memory_order_relaxed);
+    uint64_t read1 = entry.key1.load(std::memory_order_relaxed);
+    Edge res = entry.result.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if(entry.seq.load(std::memory_order_relaxed) != seq || read0 != key0 || read1 != key1)
+        return false;
+    w.hits.store(w.hits.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    result = res;
+    return true;
+}
+
+void ParallelBackend::cache_put(uint64_t key0, uint64_t key1, Edge result)
+{
+    CacheEntry& entry = cache[mix(key0 ^ mix(key1)) & cache_mask];
+    uint32_t seq = entry.seq.load(std::memory_order_relaxed);
+    if((seq & 1) || !entry.seq.compare_exchange_strong(seq, seq + 1, std::memory_order_acquire))
+        return;
+    std::atomic_thread_fence(std::memory_order_release);
+    entry.key0.store(key0, std::memory_order_relaxed);
+    entry.key1.store(key1, std::memory_order_relaxed);
+    entry.result.store(result, std::memory_order_relaxed);
+    entry.seq.store(seq + 2, std::memory_order_release);
+}
+
+void ParallelBackend::clear_cache()
+{
+    // No key has all bits set, as operation codes are small
+    for(size_t i = 0; i <= cache_mask; ++i)
+    {
+        cache[i].seq.store(0, std::memory_order_relaxed);
+        cache[i].key0.store(~uint64_t(0), std::memory_order_relaxed);
+        cache[i].key1.store(0, std::memory_order_relaxed);
+        cache[i].result.store(0, std::memory_order_relaxed);
+    }
+}
+
+
+// Garbage collection. Marks the nodes below referenced ones, rebuilds the unique table from them,
+// and hands out the rest. Node indices do not change, so nodes held outside stay valid.
+void ParallelBackend::collect(bool grow)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool first = !cache;                // The constructor sets up the tables by collecting
+    size_t size = nodes.size();
+    if(grow && size < MAX_NODES)
+    {
+        size *= 2;
+        nodes.resize(size);
+        refs.resize(size, 0);
+    }
+
+    std::vector<bool> marked(size, false);
+    std::vector<uint32_t> stack;
+    marked[0] = true;
+    for(uint32_t i = 1; i < size; ++i)
+        if(refs[i] && !marked[i])
+        {
+            marked[i] = true;
+            stack.push_back(i);
+        }
+    while(!stack.empty())
+    {
+        const TableNode& nd = nodes[stack.back()];
+        stack.pop_back();
+        uint32_t children[2] = { nd.then_edge >> 1, nd.else_edge >> 1 };
+        for(int c = 0; c < 2; ++c)
+            if(!marked[children[c]])
+            {
+                marked[children[c]] = true;
+                stack.push_back(children[c]);
+            }
+    }
+
+    if(!buckets || bucket_mask + 1 != size * 2)
+    {
+        buckets.reset(new std::atomic<uint64_t>[size * 2]);
+        bucket_mask = size * 2 - 1;
+    }
+    for(size_t i = 0; i <= bucket_mask; ++i) buckets[i].store(0, std::memory_order_relaxed);
+    free_slots.clear();
+    live_after_gc = 1;
+    for(uint32_t i = 1; i < size; ++i)
+    {
+        if(!marked[i]) free_slots.push_back(i);
+        else
+        {
+            insert_bucket(i);
+            ++live_after_gc;
+        }
+    }
+    free_pos = 0;
+    for(size_t i = 0; i < workers.size(); ++i)
+    {
+        workers[i]->next_free = workers[i]->end_free = 0;
+        workers[i]->spare = 0;
+    }
+
+    // Freed nodes are reused, so the cache must forget them
+    if(!cache || cache_mask + 1 != size)
+    {
+        cache.reset(new CacheEntry[size]);
+        cache_mask = size - 1;
+    }
+    clear_cache();
+    table_full = false;
+
+    if(!first) ++gc_count;
+    gc_time += std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now() - start).count();
+}
+
+size_t ParallelBackend::nodes_used() const
+{
+    return live_after_gc + std::min(free_pos.load(), free_slots.size());
+}
+
+
+// The recursive operations. Each returns INVALID as soon as the table fills up.
+ParallelBackend::Edge ParallelBackend::and_rec(Worker& w, Edge f, Edge g, unsigned depth)
+{
+    if(f == ZERO || g == ZERO || f == neg(g)) return ZERO;
+    if(f == ONE || f == g) return g;
+    if(g == ONE) return f;
+    if(table_full.load(std::memory_order_relaxed)) return INVALID;
+    if(f > g) std::swap(f, g);
+    uint64_t key0 = op_key(OP_AND, f), key1 = edge_pair(g, 0);
+    Edge res;
+    if(cache_get(w, key0, key1, res)) return res;
+
+    uint32_t var = std::min(top_var(f), top_var(g));
+    Edge f1, f0, g1, g0, r1, r0;
+    cofactors(f, var, f1, f0);
+    cofactors(g, var, g1, g0);
+    split(w, OP_AND, f1, g1, 0, f0, g0, 0, depth, r1, r0);
+    if(r1 == INVALID || r0 == INVALID) return INVALID;
+    res = make_node(w, var, r1, r0);
+    if(res != INVALID) cache_put(key0, key1, res);
+    return res;
+}
+
+ParallelBackend::Edge ParallelBackend::xor_rec(Worker& w, Edge f, Edge g, unsigned depth)
+{
+    if(f == g) return ZERO;
+    if(f == neg(g)) return ONE;
+    if(f == ZERO) return g;
+    if(g == ZERO) return f;
+    if(f == ONE) return neg(g);
+    if(g == ONE) return neg(f);
+    if(table_full.load(std::memory_order_relaxed)) return INVALID;
+    // Complements pass through xor, so it is computed and cached on regular operands
+    Edge cmpl = (f ^ g) & 1;
+    f &= ~1u;
+    g &= ~1u;
+    if(f > g) std::swap(f, g);
+    uint64_t key0 = op_key(OP_XOR, f), key1 = edge_pair(g, 0);
+    Edge res;
+    if(cache_get(w, key0, key1, res)) return res ^ cmpl;
+
+    uint32_t var = std::min(top_var(f), top_var(g));
+    Edge f1, f0, g1, g0, r1, r0;
+    cofactors(f, var, f1, f0);
+    cofactors(g, var, g1, g0);
+    split(w, OP_XOR, f1, g1, 0, f0, g0, 0, depth, r1, r0);
+    if(r1 == INVALID || r0 == INVALID) return INVALID;
+    res = make_node(w, var, r1, r0);
+    if(res == INVALID) return INVALID;
+    cache_put(key0, key1, res);
+    return res ^ cmpl;
+}
+
+ParallelBackend::Edge ParallelBackend::ite_rec(Worker& w, Edge f, Edge g, Edge h, unsigned depth)
+{
+    if(f == ONE) return g;
+    if(f == ZERO) return h;
+    // Replace the operands equal to f or its complement by constants
+    if(g == f) g = ONE;
+    else if(g == neg(f)) g = ZERO;
+    if(h == f) h = ZERO;
+    else if(h == neg(f)) h = ONE;
+    if(g == h) return g;
+    if(g == ONE && h == ZERO) return f;
+    if(g == ZERO && h == ONE) return neg(f);
+    if(g == ONE) return neg(and_rec(w, neg(f), neg(h), depth));
+    if(g == ZERO) return and_rec(w, neg(f), h, depth);
+    if(h == ZERO) return and_rec(w, f, g, depth);
+    if(h == ONE) return neg(and_rec(w, f, neg(g), depth));
+    if(table_full.load(std::memory_order_relaxed)) return INVALID;
+    // Make f and g regular
+    if(f & 1)
+    {
+        f = neg(f);
+        std::swap(g, h);
+    }
+    Edge cmpl = g & 1;
+    g ^= cmpl;
+    h ^= cmpl;
+    uint64_t key0 = op_key(OP_ITE, f), key1 = edge_pair(g, h);
+    Edge res;
+    if(cache_get(w, key0, key1, res)) return res ^ cmpl;
+
+    uint32_t var = std::min(top_var(f), std::min(top_var(g), top_var(h)));
+    Edge f1, f0, g1, g0, h1, h0, r1, r0;
+    cofactors(f, var, f1, f0);
+    cofactors(g, var, g1, g0);
+    cofactors(h, var, h1, h0);
+    split(w, OP_ITE, f1, g1, h1, f0, g0, h0, depth, r1, r0);
+    if(r1 == INVALID || r0 == INVALID) return INVALID;
+    res = make_node(w, var, r1, r0);
+    if(res == INVALID) return INVALID;
+    cache_put(key0, key1, res);
+    return res ^ cmpl;
+}
+
+ParallelBackend::Edge ParallelBackend::exists_rec(Worker& w, Edge f, Edge cube, unsigned depth)
+{
+    if((f >> 1) == 0 || cube == ONE) return f;
+    // Skip the variables of the cube above f
+    uint32_t var = top_var(f);
+    while(cube != ONE && top_var(cube) < var) cube = nodes[cube >> 1].then_edge;
+    if(cube == ONE) return f;
+    if(table_full.load(std::memory_order_relaxed)) return INVALID;
+    uint64_t key0 = op_key(OP_EXISTS, f), key1 = edge_pair(cube, 0);
+    Edge res;
+    if(cache_get(w, key0, key1, res)) return res;
+
+    Edge f1, f0, r1, r0;
+    cofactors(f, var, f1, f0);
+    if(top_var(cube) == var)
+    {
+        // Quantified variable: the or of the two cofactors, the second skipped if the first is
+        // already true when not splitting
+        Edge rest = nodes[cube >> 1].then_edge;
+        if(depth < spawn_depth) split(w, OP_EXISTS, f1, rest, 0, f0, rest, 0, depth, r1, r0);
+        else
+        {
+            r1 = exists_rec(w, f1, rest, depth + 1);
+            r0 = r1 == ONE ? ONE : exists_rec(w, f0, rest, depth + 1);
+        }
+        if(r1 == INVALID || r0 == INVALID) return INVALID;
+        res = neg(and_rec(w, neg(r1), neg(r0), depth));
+    }
+    else
+    {
+        split(w, OP_EXISTS, f1, cube, 0, f0, cube, 0, depth, r1, r0);
+        if(r1 == INVALID || r0 == INVALID) return INVALID;
+        res = make_node(w, var, r1, r0);
+    }
+    if(res != INVALID) cache_put(key0, key1, res);
+    return res;
+}
+
+ParallelBackend::Edge ParallelBackend::and_exists_rec(Worker& w, Edge f, Edge g, Edge cube,
+                                                      unsigned depth)
+{
+    if(f == ZERO || g == ZERO || f == neg(g)) return ZERO;
+    if(f == ONE && g == ONE) return ONE;
+    if(cube == ONE) return and_rec(w, f, g, depth);
+    if(f == ONE || f == g) return exists_rec(w, g, cube, depth);
+    if(g == ONE) return exists_rec(w, f, cube, depth);
+    if(f > g) std::swap(f, g);
+    uint32_t var = std::min(top_var(f), top_var(g));
+    while(cube != ONE && top_var(cube) < var) cube = nodes[cube >> 1].then_edge;
+    if(cube == ONE) return and_rec(w, f, g, depth);
+    if(table_full.load(std::memory_order_relaxed)) return INVALID;
+    uint64_t key0 = op_key(OP_AND_EXISTS, f), key1 = edge_pair(g, cube);
+    Edge res;
+    if(cache_get(w, key0, key1, res)) return res;
+
+    Edge f1, f0, g1, g0, r1, r0;
+    cofactors(f, var, f1, f0);
+    cofactors(g, var, g1, g0);
+    if(top_var(cube) == var)
+    {
+        Edge rest = nodes[cube >> 1].then_edge;
+        if(depth < spawn_depth)
+            split(w, OP_AND_EXISTS, f1, g1, rest, f0, g0, rest, depth, r1, r0);
+        else
+        {
+            r1 = and_exists_rec(w, f1, g1, rest, depth + 1);
+            r0 = r1 == ONE ? ONE : and_exists_rec(w, f0, g0, rest, depth + 1);
+        }
+        if(r1 == INVALID || r0 == INVALID) return INVALID;
+        res = neg(and_rec(w, neg(r1), neg(r0), depth));
+    }
+    else
+    {
+        split(w, OP_AND_EXISTS, f1, g1, cube, f0, g0, cube, depth, r1, r0);
+        if(r1 == INVALID || r0 == INVALID) return INVALID;
+        res = make_node(w, var, r1, r0);
+    }
+    if(res != INVALID) cache_put(key0, key1, res);
+    return res;
+}
+
+// Restrict is the generalized cofactor of Coudert and Madre, which drops the variables of care
+// that f does not depend on before following the cofactors of both
+ParallelBackend::Edge ParallelBackend::restrict_rec(Worker& w, Edge f, Edge care)
+{
+    if(care == ONE || care == ZERO || (f >> 1) == 0) return f;
+    if(f == care) return ONE;
+    if(f == neg(care)) return ZERO;
+    if(table_full.load(std::memory_order_relaxed)) return INVALID;
+    uint64_t key0 = op_key(OP_RESTRICT, f), key1 = edge_pair(care, 0);
+    Edge res;
+    if(cache_get(w, key0, key1, res)) return res;
+
+    uint32_t var = top_var(f);
+    Edge f1, f0, c1, c0;
+    if(top_var(care) < var)
+    {
+        cofactors(care, top_var(care), c1, c0);
+        Edge either = neg(and_rec(w, neg(c1), neg(c0), spawn_depth));
+        res = either == INVALID ? INVALID : restrict_rec(w, f, either);
+    }
+    else
+    {
+        cofactors(f, var, f1, f0);
+        cofactors(care, var, c1, c0);
+        if(c1 == ZERO) res = restrict_rec(w, f0, c0);
+        else if(c0 == ZERO) res = restrict_rec(w, f1, c1);
+        else
+        {
+            Edge r1 = restrict_rec(w, f1, c1);
+            Edge r0 = r1 == INVALID ? INVALID : restrict_rec(w, f0, c0);
+            res = r0 == INVALID ? INVALID : make_node(w, var, r1, r0);
+        }
+    }
+    if(res != INVALID) cache_put(key0, key1, res);
+    return res;
+}
+
+// The result for each node is built with an ite on the variable it moves to, as that may be below
+// the variables of its children. The results are kept in a memo for the one call, since the cache
+// has no room for the permutation.
+ParallelBackend::Edge ParallelBackend::permute_rec(Worker& w, Edge f, const std::vector<int>& perm,
+                                                   std::unordered_map<Edge, Edge>& memo)
+{
+    if((f >> 1) == 0) return f;
+    Edge reg = f & ~Edge(1);
+    std::unordered_map<Edge, Edge>::const_iterator it = memo.find(reg);
+    if(it != memo.end()) return (f & 1) ? neg(it->second) : it->second;
+
+    uint32_t var = top_var(reg);
+    Edge r1 = permute_rec(w, nodes[reg >> 1].then_edge, perm, memo);
+    Edge r0 = r1 == INVALID ? INVALID : permute_rec(w, nodes[reg >> 1].else_edge, perm, memo);
+    uint32_t to = var < perm.size() ? perm[var] : var;
+    Edge to_edge = r0 == INVALID ? INVALID : make_node(w, to, ONE, ZERO);
+    Edge res = to_edge == INVALID ? INVALID : ite_rec(w, to_edge, r1, r0, 0);
+    if(res == INVALID) return INVALID;
+    memo[reg] = res;
+    return (f & 1) ? neg(res) : res;
+}
+
+bool ParallelBackend::leq_rec(Worker& w, Edge f, Edge g)
+{
+    if(f == g || f == ZERO || g == ONE) return true;
+    if(f == ONE || g == ZERO || f == neg(g)) return false;
+    uint64_t key0 = op_key(OP_LEQ, f), key1 = edge_pair(g, 0);
+    Edge res;
+    if(cache_get(w, key0, key1, res)) return res;
+
+    uint32_t var = std::min(top_var(f), top_var(g));
+    Edge f1, f0, g1, g0;
+    cofactors(f, var, f1, f0);
+    cofactors(g, var, g1, g0);
+    bool ret = leq_rec(w, f1, g1) && leq_rec(w, f0, g0);
+    cache_put(key0, key1, ret);
+    return ret;
+}
+
+
+// Constants and variables
+BDDBackend::Node ParallelBackend::constant(bool value) { return value ? ONE : ZERO; }
+BDDBackend::Node ParallelBackend::var(int index)
+{
+    if(index < 0 || uint32_t(index) >= CONST_VAR)
+        throw std::runtime_error("BDD variable index out of range");
+    n_vars = std::max(n_vars, index + 1);
+    return run([&](Worker& w) { return make_node(w, index, ONE, ZERO); });
+}
+int ParallelBackend::num_vars() { return n_vars; }
+BDDBackend::Node ParallelBackend::cube(const std::vector<int>& values)
+{
+    if(values.size() >= CONST_VAR) throw std::runtime_error("BDD variable index out of range");
+    n_vars = std::max(n_vars, (int) values.size());
+    // Built from the last variable up, one node per literal
+    return run([&](Worker& w)
+    {
+        Edge acc = ONE;
+        for(size_t i = values.size(); i-- > 0 && acc != INVALID; )
+            if(values[i] == 1) acc = make_node(w, i, acc, ZERO);
+            else if(values[i] == 0) acc = make_node(w, i, ZERO, acc);
+        return acc;
+    });
+}
+
+void ParallelBackend::ref(Node nd) { if(nd >> 1) ++refs[nd >> 1]; }
+void ParallelBackend::deref(Node nd) { if(nd >> 1) --refs[nd >> 1]; }
+
+
+// Operations
+BDDBackend::Node ParallelBackend::negate(Node f) { return f ^ 1; }
+BDDBackend::Node ParallelBackend::apply_and(Node f, Node g)
+{
+    return run([&](Worker& w) { return and_rec(w, f, g, 0); });
+}
+BDDBackend::Node ParallelBackend::apply_or(Node f, Node g)
+{
+    return run([&](Worker& w) { return neg(and_rec(w, neg(f), neg(g), 0)); });
+}
+BDDBackend::Node ParallelBackend::apply_xor(Node f, Node g)
+{
+    return run([&](Worker& w) { return xor_rec(w, f, g, 0); });
+}
+BDDBackend::Node ParallelBackend::ite(Node f, Node g, Node h)
+{
+    return run([&](Worker& w) { return ite_rec(w, f, g, h, 0); });
+}
+bool ParallelBackend::leq(Node f, Node g) { return leq_rec(*workers[0], f, g); }
+BDDBackend::Node ParallelBackend::exists(Node f, Node cube)
+{
+    return run([&](Worker& w) { return exists_rec(w, f, cube, 0); });
+}
+BDDBackend::Node ParallelBackend::forall(Node f, Node cube)
+{
+    return run([&](Worker& w) { return neg(exists_rec(w, neg(f), cube, 0)); });
+}
+BDDBackend::Node ParallelBackend::and_exists(Node f, Node g, Node cube)
+{
+    return run([&](Worker& w) { return and_exists_rec(w, f, g, cube, 0); });
+}
+BDDBackend::Node ParallelBackend::restrict(Node f, Node care)
+{
+    return run([&](Worker& w) { return restrict_rec(w, f, care); });
+}
+BDDBackend::Node ParallelBackend::permute(Node f, const std::vector<int>& perm)
+{
+    for(std::vector<int>::const_iterator i = perm.begin(); i != perm.end(); ++i)
+    {
+        if(*i < 0 || uint32_t(*i) >= CONST_VAR)
+            throw std::runtime_error("BDD variable index out of range");
+        n_vars = std::max(n_vars, *i + 1);
+    }
+    return run([&](Worker& w)
+    {
+        std::unordered_map<Edge, Edge> memo;
+        return permute_rec(w, f, perm, memo);
+    });
+}
+
+
+// Structure
+bool ParallelBackend::is_complement(Node nd) { return nd & 1; }
+BDDBackend::Node ParallelBackend::regular(Node nd) { return nd & ~Node(1); }
+bool ParallelBackend::is_constant(Node nd) { return (nd >> 1) == 0; }
+int ParallelBackend::var_index(Node nd) { return nodes[nd >> 1].var; }
+BDDBackend::Node ParallelBackend::then_child(Node nd) { return nodes[nd >> 1].then_edge; }
+BDDBackend::Node ParallelBackend::else_child(Node nd) { return nodes[nd >> 1].else_edge; }
+
+std::vector<int> ParallelBackend::support(Node f)
+{
+    std::unordered_set<uint32_t> seen;
+    std::vector<bool> in_support(n_vars, false);
+    std::vector<uint32_t> stack(1, f >> 1);
+    while(!stack.empty())
+    {
+        uint32_t index = stack.back();
+        stack.pop_back();
+        if(!index || !seen.insert(index).second) continue;
+        in_support[nodes[index].var] = true;
+        stack.push_back(nodes[index].then_edge >> 1);
+        stack.push_back(nodes[index].else_edge >> 1);
+    }
+    std::vector<int> ret;
+    for(int i = 0; i < n_vars; ++i) if(in_support[i]) ret.push_back(i);
+    return ret;
+}
+
+size_t ParallelBackend::node_count(Node f)
+{
+    std::unordered_set<uint32_t> seen;
+    std::vector<uint32_t> stack(1, f >> 1);
+    while(!stack.empty())
+    {
+        uint32_t index = stack.back();
+        stack.pop_back();
+        if(!seen.insert(index).second || !index) continue;
+        stack.push_back(nodes[index].then_edge >> 1);
+        stack.push_back(nodes[index].else_edge >> 1);
+    }
+    return seen.size();
+}
+
+// Visit the cubes of the paths from e to the constant one, else branches first, returning false
+// once visit does
+static bool visit_cubes(const std::function<bool(const std::vector<int>&)>& visit,
+                        BDDBackend& bk, BDDBackend::Node e, std::vector<int>& cube)
+{
+    if(bk.is_constant(e)) return bk.is_complement(e) || visit(cube);
+    BDDBackend::Node reg = bk.regular(e);
+    BDDBackend::Node cmpl = e & 1;
+    int var = bk.var_index(reg);
+    cube[var] = 0;
+    bool more = visit_cubes(visit, bk, bk.else_child(reg) ^ cmpl, cube);
+    cube[var] = 1;
+    more = more && visit_cubes(visit, bk, bk.then_child(reg) ^ cmpl, cube);
+    cube[var] = 2;
+    return more;
+}
+
+void ParallelBackend::for_each_cube(Node f,
+                                    const std::function<bool(const std::vector<int>&)>& visit)
+{
+    std::vector<int> cube(n_vars, 2);
+    visit_cubes(visit, *this, f, cube);
+}
+
+// Complemented edges are drawn dotted, whether or not draw_0_arc is set
+void ParallelBackend::save_dot(Node f, bool draw_0_arc, const std::string& filename)
+{
+    (void) draw_0_arc;
+    FILE* file = fopen(filename.c_str(), "w");
+    if(!file) throw std::runtime_error("Could not open file " + filename);
+    fprintf(file, "digraph \"BDD\" {\n");
+    fprintf(file, "    n0 [shape = box, label = \"1\"];\n");
+    fprintf(file, "    f [shape = none];\n");
+    fprintf(file, "    f -> n%lu%s;\n", (unsigned long) (f >> 1), (f & 1) ? " [style = dotted]" : "");
+    std::unordered_set<uint32_t> seen;
+    std::vector<uint32_t> stack(1, f >> 1);
+    while(!stack.empty())
+    {
+        uint32_t index = stack.back();
+        stack.pop_back();
+        if(!index || !seen.insert(index).second) continue;
+        const TableNode& nd = nodes[index];
+        fprintf(file, "    n%u [label = \"%u\"];\n", index, nd.var);
+        fprintf(file, "    n%u -> n%u;\n", index, nd.then_edge >> 1);
+        fprintf(file, "    n%u -> n%u [style = %s];\n", index, nd.else_edge >> 1,
+                (nd.else_edge & 1) ? "dotted" : "dashed");
+        stack.push_back(nd.then_edge >> 1);
+        stack.push_back(nd.else_edge >> 1);
+    }
+    fprintf(file, "}\n");
+    if(fclose(file) != 0) throw std::runtime_error("Could not safely close file " + filename);
+}
+
+ManagerStats ParallelBackend::read_stats()
+{
+    ManagerStats st;
+    st.live_nodes       = nodes_used();
+    st.peak_nodes       = std::max<long>(peak_nodes, st.live_nodes);
+    st.cache_lookups    = 0;
+    st.cache_hits       = 0;
+    for(size_t i = 0; i < workers.size(); ++i)
+    {
+        st.cache_lookups += workers[i]->lookups.load();
+        st.cache_hits    += workers[i]->hits.load();
+    }
+    st.gc_count         = gc_count;
+    st.gc_time          = gc_time;
+    st.reorder_count    = 0;
+    st.reorder_time     = 0;
+    st.memory_in_use    = nodes.size() * (sizeof(TableNode) + sizeof(uint32_t) * 2)
+                          + (bucket_mask + 1) * sizeof(uint64_t)
+                          + (cache_mask + 1) * sizeof(CacheEntry);
+    return st;
+}
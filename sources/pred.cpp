@@ -8,32 +8,80 @@
 #include <vector>
 #include <stdexcept>
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <iostream>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 
 #include "headers/bdd.hpp"
+#include "headers/explicit.hpp"
 
 
 
 /**
  * Impl StateSpace
  */
-StateSpace::StateSpace(int st_bits) 
-    : state_bits(st_bits), var_eq_bdd(false), cube_u(false), cube_v(false)
+StateSpace::StateSpace(int st_bits, int in_bits) 
+    : state_bits(st_bits), input_bits(in_bits), var_eq_bdd(false), cube_u(false), cube_v(false),
+      cube_u_in(false), cube_v_in(false)
 {
-    std::vector<int> u_vars(state_bits), v_vars(state_bits);
+    std::vector<int> in_vars(input_bits);
+    u_vars.resize(state_bits);
+    v_vars.resize(state_bits);
+    swap_uv.resize(2 * state_bits);
     for(int i = 0; i < state_bits; i++)
     {
         var_eq_bdd |= BDD(i*2) ^ BDD(i*2+1);
         u_vars[i] = i * 2;
         v_vars[i] = i * 2 + 1;
+        swap_uv[i * 2] = i * 2 + 1;
+        swap_uv[i * 2 + 1] = i * 2;
     }
+    for(int i = 0; i < input_bits; i++) in_vars[i] = state_bits * 2 + i;
     var_eq_bdd = !var_eq_bdd; 
     cube_u = BDD(u_vars);
     cube_v = BDD(v_vars);
+    BDD cube_in(in_vars);
+    cube_u_in = cube_u && cube_in;
+    cube_v_in = cube_v && cube_in;
 }
 
-bool operator==(const StateSpace& sl, const StateSpace& sr) { return sl.state_bits == sr.state_bits;}
-bool operator!=(const StateSpace& sl, const StateSpace& sr) { return sl.state_bits != sr.state_bits;}
+bool StateSpace::add_variable(const std::string& name, const Variable& var)
+{
+    if(variables.count(name) || values.count(name)) return false;
+    for(size_t i = 0; i < var.values.size(); ++i)
+        if(variables.count(var.values[i]) || values.count(var.values[i]) || var.values[i] == name ||
+                std::count(var.values.begin(), var.values.begin() + i, var.values[i]))
+            return false;
+    for(size_t i = 0; i < var.values.size(); ++i) values[var.values[i]] = i;
+    variables[name] = var;
+    return true;
+}
+
+const StateSpace::Variable* StateSpace::find_variable(const std::string& name) const
+{
+    std::map<std::string, Variable>::const_iterator i = variables.find(name);
+    return i == variables.end() ? NULL : &i->second;
+}
+
+bool StateSpace::find_value(const std::string& name, unsigned long long& value) const
+{
+    std::map<std::string, unsigned long long>::const_iterator i = values.find(name);
+    if(i == values.end()) return false;
+    value = i->second;
+    return true;
+}
+
+bool operator==(const StateSpace& sl, const StateSpace& sr) 
+{ 
+    return sl.state_bits == sr.state_bits && sl.input_bits == sr.input_bits;
+}
+bool operator!=(const StateSpace& sl, const StateSpace& sr) { return !(sl == sr); }
 
 
 
@@ -41,99 +89,90 @@ bool operator!=(const StateSpace& sl, const StateSpace& sr) { return sl.state_bi
 /** 
  * Impl State
  */
-State::State(const StateSpace& sp, const std::vector<bool>& assgn) 
-    : space(sp), assign(assgn), bdd_u(true), bdd_v(true)
+State::State(const StateSpace& sp, const std::vector<bool>& assign) 
+    : space(sp), words((sp.state_bits + 63) / 64, 0), bdd_u(false), have_bdd_u(false)
 {
     if(sp.state_bits != (int) assign.size())
         throw std::runtime_error("Size of state assignment and state space do not match");
-    for(size_t i = 0; i < assign.size(); ++i)
-    {    
-        bdd_u &= assign[i] ? BDD((int) i*2) : !BDD((int) i*2);
-        bdd_v &= assign[i] ? BDD((int) i*2 + 1) : !BDD((int) i*2 + 1);
-    }
+    for(size_t i = 0; i < assign.size(); ++i) if(assign[i]) words[i / 64] |= uint64_t(1) << (i % 64);
 }
 
-State::State(const Predicate& pred) 
-    : space(pred.space), assign(pred.space.state_bits), bdd_u(true), bdd_v(true)
+State::State(const Predicate& pred, std::mt19937_64* rng) 
+    : space(pred.space), words((pred.space.state_bits + 63) / 64, 0), bdd_u(false),
+      have_bdd_u(false)
 {
     if(pred.is_false()) throw std::runtime_error("Cannot assign state from empty predicate");
-    std::vector<bool> coded_assign = pred.get_bdd().get_assign();       // This in u vars, ignore v
-    for(size_t i = 0; i < assign.size(); ++i)
-    {
-        assign[i] = coded_assign[2*i];
-        bdd_u &= assign[i] ? BDD((int) i*2) : !BDD((int) i*2);
-        bdd_v &= assign[i] ? BDD((int) i*2 + 1) : !BDD((int) i*2 + 1);
-    }
+    std::vector<bool> assign = pred.is_p_u_repr ? pred.p_u.pick_minterm(space.u_vars, rng)
+                                                : pred.p_v.pick_minterm(space.v_vars, rng);
+    for(int i = 0; i < space.state_bits; ++i)
+        if(assign[i]) words[i / 64] |= uint64_t(1) << (i % 64);
 }
 
 State& State::operator = (const State& other)
 {
     if(space != other.space) 
         throw std::runtime_error("Attempting to assign states over different spaces");
-    assign = other.assign;
+    words = other.words;
     bdd_u = other.bdd_u;
-    bdd_v = other.bdd_v;
+    have_bdd_u = other.have_bdd_u;
     return *this;
 }
 
-bool State::operator == (const State& other)
+bool State::operator == (const State& other) const
 {
-    if(space != other.space || assign.size() != other.assign.size()) return false;
-    for(size_t i = 0; i < assign.size(); i++) if(assign[i] != other.assign[i]) return false;
-    return true;
+    return space == other.space && words == other.words;
+}
+
+size_t State::hash() const
+{
+    uint64_t h = 0;
+    for(std::vector<uint64_t>::const_iterator i = words.begin(); i != words.end(); ++i)
+        h = (h ^ *i) * 0x100000001b3ull + (h >> 29);
+    return h;
 }
 
 std::string State::to_string(size_t n_space) const
 {
     std::string str = "";
-    for(bool v : assign) str += (v ? "1" : "0") + std::string(n_space, ' ');
+    for(int i = 0; i < space.state_bits; ++i) str += (bit(i) ? "1" : "0") + std::string(n_space, ' ');
     return str;
 }
 
- 
-
-/**
- * Impl path
- */
-void Path::print() const
+const BDD& State::cube_u() const
 {
-    // header
-    std::cout << (is_finite ? "Finite" : "Infinite") << " path:" << std::endl;
-    for(int i = 0; i < states[0].space.state_bits; i++)
+    if(!have_bdd_u)
     {
-        std::string num = std::to_string(i);
-        std::cout << "v" << num << std::string(3 - num.size(), ' ');
+        std::vector<int> values(2 * space.state_bits, 2);
+        for(int i = 0; i < space.state_bits; ++i) values[2 * i] = bit(i);
+        bdd_u = BDD::from_cube(values);
+        have_bdd_u = true;
     }
-    std::cout << std::endl;
-    // Print before lasso (or whole path if finite)
-    size_t brk = is_finite ? states.size() : lasso_point;
-    for(size_t i = 0; i < brk; ++i)
-        std::cout << states[i].to_string(3) << std::endl;
-    // Print the lasso
-    if(!is_finite) std::cout << "Begin Loop" << std::endl;
-    for(size_t i = brk; i < states.size(); ++i)
-        std::cout << states[i].to_string(3) << std::endl;
+    return bdd_u;
 }
 
-
-
+ 
 
 /**
  * Impl Transaction
  */
 
 // CTOR etc
-Transition::Transition(const StateSpace& sp, const BDD& tuv, const BDD& tvu) 
-    : space(sp), t_u_v(tuv), t_v_u(tvu) {} 
+Transition::Transition(const StateSpace& sp, const BDD& tuv) 
+    : space(sp), t_u_v(tuv), t_v_u(false), have_v_u(false), one_relation(false), fair_threads(1) {} 
 
 Transition::Transition(const StateSpace& sp, int var_idx, bool to_var) 
-    : Transition(sp, BDD(var_idx * 2 + (to_var ? 1 : 0)), BDD(var_idx * 2 + (to_var ? 0 : 1))) {}
+    : Transition(sp, BDD(var_idx * 2 + (to_var ? 1 : 0))) {}
 
-Transition::Transition(const StateSpace& sp, bool bconst) 
-    : Transition(sp, BDD(bconst), BDD(bconst)) {}
+Transition::Transition(const StateSpace& sp, bool bconst) : Transition(sp, BDD(bconst)) {}
+
+Transition Transition::input(const StateSpace& sp, int input_idx)
+{
+    return Transition(sp, BDD(sp.state_bits * 2 + input_idx));
+}
 
 Transition::Transition(const Transition& other) 
-    : Transition(other.space, other.t_u_v, other.t_v_u) {}
+    : space(other.space), t_u_v(other.t_u_v), t_v_u(other.t_v_u), have_v_u(other.have_v_u),
+      one_relation(other.one_relation), fair_threads(1) {}
 
 Transition& Transition::operator=(const Transition& other)
 {
@@ -141,14 +180,37 @@ Transition& Transition::operator=(const Transition& other)
         throw std::runtime_error("Cannot assign Transition over different StateSpaces");
     t_u_v = other.t_u_v;
     t_v_u = other.t_v_u;
+    have_v_u = other.have_v_u;
+    graph.reset();
     return *this;
 }
 
+// The two representations are the same relation with u and v exchanged
+const BDD& Transition::reverse() const
+{
+    if(!have_v_u)
+    {
+        t_v_u = t_u_v.permute(space.swap_uv);
+        have_v_u = true;
+    }
+    return t_v_u;
+}
+
+void Transition::keep_one_relation(bool one)
+{
+    one_relation = one;
+    if(one)
+    {
+        t_v_u = BDD(false);
+        have_v_u = false;
+    }
+}
+
 
 // Equality
 bool operator==(const Transition& trl, const Transition& trr)
 {
-    return trl.space == trr.space && trl.t_u_v == trr.t_u_v && trl.t_v_u == trr.t_v_u;
+    return trl.space == trr.space && trl.t_u_v == trr.t_u_v;
 }
 bool operator!=(const Transition& trl, const Transition& trr) { return !(trl == trr); }
 
@@ -158,33 +220,199 @@ Transition  operator&&(const Transition& trl, const Transition& trr)
 { 
     if(trl.space != trr.space) 
         throw std::runtime_error("Cannot operate on transition over different StateSpaces");
-    return Transition(trl.space, trl.t_u_v && trr.t_u_v, trl.t_v_u && trr.t_v_u); 
+    return Transition(trl.space, trl.t_u_v && trr.t_u_v); 
 }
 Transition  operator||(const Transition& trl, const Transition& trr) 
 { 
     if(trl.space != trr.space) 
         throw std::runtime_error("Cannot operate on transition over different StateSpaces");
-    return Transition(trl.space, trl.t_u_v || trr.t_u_v, trl.t_v_u || trr.t_v_u); 
+    return Transition(trl.space, trl.t_u_v || trr.t_u_v); 
 }
 Transition  operator^(const Transition& trl, const Transition& trr) 
 { 
     if(trl.space != trr.space) 
         throw std::runtime_error("Cannot operate on transition over different StateSpaces");
-    return Transition(trl.space, trl.t_u_v ^ trr.t_u_v, trl.t_v_u ^ trr.t_v_u); 
+    return Transition(trl.space, trl.t_u_v ^ trr.t_u_v); 
 }
 
 Transition& Transition::operator&=(const Transition& other) { return *this = *this && other; }
 Transition& Transition::operator|=(const Transition& other) { return *this = *this || other; }
 Transition& Transition::operator^=(const Transition& other) { return *this = *this ^  other; }
 
-Transition  Transition::operator! () const { return Transition(space, !t_u_v, !t_v_u); }
+Transition  Transition::operator! () const { return Transition(space, !t_u_v); }
+
+
+// Listeners
+void Transition::add_listener(FixpointListener* listener) { listeners.push_back(listener); }
+void Transition::remove_listener(FixpointListener* listener)
+{
+    listeners.erase(std::remove(listeners.begin(), listeners.end(), listener), listeners.end());
+}
+void Transition::notify_begin(const char* op) const
+{
+    for(std::vector<FixpointListener*>::const_iterator i = listeners.begin(); i != listeners.end(); ++i)
+        (*i)->on_begin(op);
+}
+void Transition::notify(const char* op, size_t iteration, const Predicate& prev, 
+                        const Predicate& next) const
+{
+    for(std::vector<FixpointListener*>::const_iterator i = listeners.begin(); i != listeners.end(); ++i)
+    {
+        (*i)->wants_predicates();
+        (*i)->on_iteration(op, iteration, prev, next);
+    }
+}
+void Transition::notify_sets(const char* op, size_t iteration, const StateSet& prev, 
+                             const StateSet& next) const
+{
+    std::unique_ptr<Predicate> prev_pred, next_pred;
+    Predicate none(space, false);
+    for(std::vector<FixpointListener*>::const_iterator i = listeners.begin(); i != listeners.end(); ++i)
+    {
+        if(!(*i)->wants_predicates())
+        {
+            (*i)->on_iteration(op, iteration, none, none);
+            continue;
+        }
+        if(!next_pred)
+        {
+            prev_pred.reset(new Predicate(graph->to_pred(prev)));
+            next_pred.reset(new Predicate(graph->to_pred(next)));
+        }
+        (*i)->on_iteration(op, iteration, *prev_pred, *next_pred);
+    }
+}
+void Transition::notify_end(const char* op, size_t iterations) const
+{
+    for(std::vector<FixpointListener*>::const_iterator i = listeners.begin(); i != listeners.end(); ++i)
+        (*i)->on_end(op, iterations);
+}
+
+
+// Sizes
+size_t Transition::size_u_v() const { return t_u_v.node_count(); }
+size_t Transition::size_v_u() const { return have_v_u ? t_v_u.node_count() : 0; }
+
+
+// Transfer
+Transition Transition::transfer(const StateSpace& sp) const
+{
+    if(sp != space)
+        throw std::runtime_error("Cannot transfer Transition to a different StateSpace");
+    Transition ret(sp, t_u_v.transfer());
+    if(have_v_u)
+    {
+        ret.t_v_u = t_v_u.transfer();
+        ret.have_v_u = true;
+    }
+    ret.one_relation = one_relation;
+    return ret;
+}
 
 
 // Get next
 Predicate Transition::next(const State& st) const
 {
     if(space != st.space) throw std::runtime_error("Spaces of state and transition do not match");
-    return Predicate(space, (t_u_v && st.bdd_u).existential_abstraction(space.cube_u), false);
+    return Predicate(space, t_u_v.and_abstraction(st.cube_u(), space.cube_u_in), false);
+}
+
+Predicate Transition::post(const Predicate& pred) const
+{
+    if(space != pred.space) 
+        throw std::runtime_error("Transition and predicate state spaces do not match");
+    if(graph) return graph->to_pred(graph->post(graph->to_set(pred)));
+    if(pred.is_p_u_repr)
+        return Predicate(space, t_u_v.and_abstraction(pred.p_u, space.cube_u_in), false);
+    else if(one_relation)
+    {
+        BDD pred_u = pred.p_v.permute(space.swap_uv);
+        return Predicate(space, t_u_v.and_abstraction(pred_u, space.cube_u_in), false);
+    }
+    else
+        return Predicate(space, reverse().and_abstraction(pred.p_v, space.cube_v_in), true);
+}
+
+bool Transition::reach(const Predicate& init, const Predicate& target, size_t& depth) const
+{
+    if(graph)
+    {
+        Predicate reached(space, false);
+        return explicit_search(init, &target, reached, depth, NULL);
+    }
+    Predicate acc = init;
+    Predicate frontier = init;
+    size_t iter = 0;
+    notify_begin("reach");
+    while((frontier && target).is_false())
+    {
+        frontier = post(frontier) && !acc;
+        if(frontier.is_false())
+        {
+            notify_end("reach", iter);
+            return false;
+        }
+        Predicate nxt = acc || frontier;
+        notify("reach", ++iter, acc, nxt);
+        acc = nxt;
+    }
+    notify_end("reach", iter);
+    depth = iter;
+    return true;
+}
+
+void Transition::reach_layers(const Predicate& init, std::vector<Predicate>& layers) const
+{
+    if(graph)
+    {
+        Predicate reached(space, false);
+        size_t depth = 0;
+        explicit_search(init, NULL, reached, depth, &layers);
+        return;
+    }
+    layers.assign(1, init);
+    Predicate acc = init;
+    size_t iter = 0;
+    notify_begin("reach");
+    while(!layers.back().is_false())
+    {
+        Predicate frontier = post(layers.back()) && !acc;
+        Predicate nxt = acc || frontier;
+        if(!frontier.is_false()) notify("reach", ++iter, acc, nxt);
+        acc = nxt;
+        layers.push_back(frontier);
+    }
+    layers.pop_back();
+    notify_end("reach", iter);
+}
+Predicate Transition::reachable(const Predicate& init) const
+{
+    if(graph)
+    {
+        Predicate reached(space, false);
+        size_t depth = 0;
+        explicit_search(init, NULL, reached, depth, NULL);
+        return reached;
+    }
+    Predicate acc = init;
+    Predicate frontier = init;
+    size_t iter = 0;
+    notify_begin("reach");
+    while(!(frontier = post(frontier) && !acc).is_false())
+    {
+        Predicate nxt = acc || frontier;
+        notify("reach", ++iter, acc, nxt);
+        acc = nxt;
+    }
+    notify_end("reach", iter);
+    return acc;
+}
+
+bool Transition::decided(const Predicate* init, const Predicate& acc, bool least) const
+{
+    // Iterates of least fixpoints only grow and those of greatest fixpoints only shrink
+    if(!init) return false;
+    return least ? init->implies(acc) : !init->implies(acc);
 }
 
 // CTL operators
@@ -192,90 +420,171 @@ Predicate Transition::EX(const Predicate& pred) const
 {
     if(space != pred.space) 
         throw std::runtime_error("Transition and predicate state spaces do not match");
-    if(pred.is_p_u_repr)
-        return Predicate(space, (t_v_u && pred.p_u).existential_abstraction(space.cube_u), false);
+    if(graph) return graph->to_pred(graph->EX(graph->to_set(pred)));
+    if(!pred.is_p_u_repr)
+        return Predicate(space, t_u_v.and_abstraction(pred.p_v, space.cube_v_in), true);
+    else if(one_relation)
+    {
+        BDD pred_v = pred.p_u.permute(space.swap_uv);
+        return Predicate(space, t_u_v.and_abstraction(pred_v, space.cube_v_in), true);
+    }
     else
-        return Predicate(space, (t_u_v && pred.p_v).existential_abstraction(space.cube_v), true);
+        return Predicate(space, reverse().and_abstraction(pred.p_u, space.cube_u_in), false);
 }
-Predicate Transition::EF(const Predicate& pred) const
+Predicate Transition::EF(const Predicate& pred, const Predicate* init) const
 {
     if(space != pred.space) 
         throw std::runtime_error("Transition and predicate state spaces do not match");
+    if(graph) return explicit_fixpoint("EF", Predicate(space, true), pred, false, true, init);
     Predicate acc(space, false);
     Predicate nxt(space, false);
-    while((nxt = pred || EX(acc)) != acc) acc = nxt;
+    size_t iter = 0;
+    notify_begin("EF");
+    while(!decided(init, acc, true) && (nxt = pred || EX(acc)) != acc)
+    {
+        notify("EF", ++iter, acc, nxt);
+        acc = nxt;
+    }
+    notify_end("EF", iter);
     return acc;
 }
-Predicate Transition::EG(const Predicate& pred) const
+Predicate Transition::EG(const Predicate& pred, const Predicate* init) const
 {
     if(space != pred.space) 
         throw std::runtime_error("Transition and predicate state spaces do not match");
+    if(graph) return explicit_fixpoint("EG", Predicate(space, false), pred, false, false, init);
     Predicate acc(space, true);
     Predicate nxt(space, false);
-    while((nxt = pred && EX(acc)) != acc) acc = nxt; 
+    size_t iter = 0;
+    notify_begin("EG");
+    while(!decided(init, acc, false) && (nxt = pred && EX(acc)) != acc)
+    {
+        notify("EG", ++iter, acc, nxt);
+        acc = nxt;
+    }
+    notify_end("EG", iter);
     return acc;
 }
-Predicate Transition::EU(const Predicate& predl, const Predicate& predr) const
+Predicate Transition::EU(const Predicate& predl, const Predicate& predr,
+                         const Predicate* init) const
 {
     if(space != predl.space || space != predr.space) 
         throw std::runtime_error("Transition and predicate state spaces do not match");
+    if(graph) return explicit_fixpoint("EU", predl, predr, false, true, init);
     Predicate acc(space, false);
     Predicate nxt(space, true);
-    while((nxt = predr || (predl && EX(acc))) != acc) acc = nxt;
+    size_t iter = 0;
+    notify_begin("EU");
+    while(!decided(init, acc, true) && (nxt = predr || (predl && EX(acc))) != acc)
+    {
+        notify("EU", ++iter, acc, nxt);
+        acc = nxt;
+    }
+    notify_end("EU", iter);
     return acc;
 }
-Predicate Transition::ER(const Predicate& predl, const Predicate& predr) const
+Predicate Transition::ER(const Predicate& predl, const Predicate& predr,
+                         const Predicate* init) const
 {
     if(space != predl.space || space != predr.space) 
         throw std::runtime_error("Transition and predicate state spaces do not match");
+    if(graph) return explicit_fixpoint("ER", predl, predr, false, false, init);
     Predicate acc(space, true);
     Predicate nxt(space, false);
-    while((nxt = predr && (predl || EX(acc))) != acc) acc = nxt;
+    size_t iter = 0;
+    notify_begin("ER");
+    while(!decided(init, acc, false) && (nxt = predr && (predl || EX(acc))) != acc)
+    {
+        notify("ER", ++iter, acc, nxt);
+        acc = nxt;
+    }
+    notify_end("ER", iter);
     return acc;
 }
 Predicate Transition::AX(const Predicate& pred) const
 {
     if(space != pred.space) 
         throw std::runtime_error("Transition and predicate state spaces do not match");
-    if(pred.is_p_u_repr)
-        return Predicate(space, (!t_v_u || pred.p_u).universal_abstraction(space.cube_u), false);
+    if(graph) return graph->to_pred(graph->AX(graph->to_set(pred)));
+    if(!pred.is_p_u_repr)
+        return Predicate(space, (!t_u_v || pred.p_v).universal_abstraction(space.cube_v_in), true);
+    else if(one_relation)
+    {
+        BDD pred_v = pred.p_u.permute(space.swap_uv);
+        return Predicate(space, (!t_u_v || pred_v).universal_abstraction(space.cube_v_in), true);
+    }
     else
-        return Predicate(space, (!t_u_v || pred.p_v).universal_abstraction(space.cube_v), true);
+        return Predicate(space, (!reverse() || pred.p_u).universal_abstraction(space.cube_u_in),
+                         false);
 }
-Predicate Transition::AF(const Predicate& pred) const
+Predicate Transition::AF(const Predicate& pred, const Predicate* init) const
 {
     if(space != pred.space) 
         throw std::runtime_error("Transition and predicate state spaces do not match");
+    if(graph) return explicit_fixpoint("AF", Predicate(space, true), pred, true, true, init);
     Predicate acc(space, false);
     Predicate nxt(space, false);
-    while((nxt = pred || AX(acc)) != acc) acc = nxt;
+    size_t iter = 0;
+    notify_begin("AF");
+    while(!decided(init, acc, true) && (nxt = pred || AX(acc)) != acc)
+    {
+        notify("AF", ++iter, acc, nxt);
+        acc = nxt;
+    }
+    notify_end("AF", iter);
     return acc;
 }
-Predicate Transition::AG(const Predicate& pred) const
+Predicate Transition::AG(const Predicate& pred, const Predicate* init) const
 {
     if(space != pred.space) 
         throw std::runtime_error("Transition and predicate state spaces do not match");
+    if(graph) return explicit_fixpoint("AG", Predicate(space, false), pred, true, false, init);
     Predicate acc(space, true);
     Predicate nxt(space, false);
-    while((nxt = pred && AX(acc)) != acc) acc = nxt;
+    size_t iter = 0;
+    notify_begin("AG");
+    while(!decided(init, acc, false) && (nxt = pred && AX(acc)) != acc)
+    {
+        notify("AG", ++iter, acc, nxt);
+        acc = nxt;
+    }
+    notify_end("AG", iter);
     return acc;
 }
-Predicate Transition::AU(const Predicate& predl, const Predicate& predr) const
+Predicate Transition::AU(const Predicate& predl, const Predicate& predr,
+                         const Predicate* init) const
 {
     if(space != predl.space || space != predr.space) 
         throw std::runtime_error("Transition and predicate state spaces do not match");
+    if(graph) return explicit_fixpoint("AU", predl, predr, true, true, init);
     Predicate acc(space, false);
     Predicate nxt(space, true);
-    while((nxt = predr || (predl && AX(acc))) != acc) acc = nxt;
+    size_t iter = 0;
+    notify_begin("AU");
+    while(!decided(init, acc, true) && (nxt = predr || (predl && AX(acc))) != acc)
+    {
+        notify("AU", ++iter, acc, nxt);
+        acc = nxt;
+    }
+    notify_end("AU", iter);
     return acc;
 }
-Predicate Transition::AR(const Predicate& predl, const Predicate& predr) const
+Predicate Transition::AR(const Predicate& predl, const Predicate& predr,
+                         const Predicate* init) const
 {
     if(space != predl.space || space != predr.space) 
         throw std::runtime_error("Transition and predicate state spaces do not match");
+    if(graph) return explicit_fixpoint("AR", predl, predr, true, false, init);
     Predicate acc(space, true);
     Predicate nxt(space, false);
-    while((nxt = predr && (predl || AX(acc))) != acc) acc = nxt;
+    size_t iter = 0;
+    notify_begin("AR");
+    while(!decided(init, acc, false) && (nxt = predr && (predl || AX(acc))) != acc)
+    {
+        notify("AR", ++iter, acc, nxt);
+        acc = nxt;
+    }
+    notify_end("AR", iter);
     return acc;
 }
 
@@ -283,6 +592,120 @@ Predicate Transition::AR(const Predicate& predl, const Predicate& predr) const
 
 // Add fairness constraints
 void Transition::add_fairness(const Predicate& pred) { fairness.push_back(pred); }
+void Transition::set_fair_threads(unsigned threads) { fair_threads = std::max(1u, threads); }
+
+void Transition::set_witness_seed(uint64_t seed) { witness_rng.reset(new std::mt19937_64(seed)); }
+
+void Transition::cone_of_influence(std::vector<int>& bits, Transition& reduced) const
+{
+    std::vector<bool> in_cone(space.state_bits, false);
+    for(std::vector<int>::const_iterator i = bits.begin(); i != bits.end(); ++i) in_cone[*i] = true;
+    for(std::vector<Predicate>::const_iterator i = fairness.begin(); i != fairness.end(); ++i)
+    {
+        std::vector<int> supp = i->support();
+        for(std::vector<int>::const_iterator j = supp.begin(); j != supp.end(); ++j)
+            in_cone[*j] = true;
+    }
+
+    // Grow the cone until abstracting the next values of the bits outside it leaves a relation
+    // that does not depend on their current values either. Then every step of the bits in the
+    // cone can be completed to a step of the whole state from any values of the other bits, so
+    // abstracting those is exact for predicates over the cone.
+    BDD step = t_u_v;
+    bool grown = true;
+    while(grown)
+    {
+        std::vector<int> outside_v;
+        for(int i = 0; i < space.state_bits; ++i) if(!in_cone[i]) outside_v.push_back(2 * i + 1);
+        step = t_u_v.existential_abstraction(outside_v);
+        std::vector<int> supp = step.support();
+        grown = false;
+        for(std::vector<int>::const_iterator i = supp.begin(); i != supp.end(); ++i)
+            if(*i < 2 * space.state_bits && *i % 2 == 0 && !in_cone[*i / 2])
+            {
+                in_cone[*i / 2] = true;
+                grown = true;
+            }
+    }
+
+    std::vector<int> outside;
+    bits.clear();
+    for(int i = 0; i < space.state_bits; ++i)
+    {
+        if(in_cone[i]) bits.push_back(i);
+        else
+        {
+            outside.push_back(2 * i);
+            outside.push_back(2 * i + 1);
+        }
+    }
+    if(reduced.space != space)
+        throw std::runtime_error("Cannot reduce Transition into one over a different StateSpace");
+    reduced.t_u_v = step.existential_abstraction(outside);
+    reduced.t_v_u = BDD(false);
+    reduced.have_v_u = false;
+    reduced.one_relation = one_relation;
+    reduced.fairness = fairness;
+    reduced.fair_threads = fair_threads;
+    reduced.listeners = listeners;
+}
+
+// Explicit graph
+bool Transition::use_explicit(size_t max_edges)
+{
+    std::shared_ptr<ExplicitGraph> built(new ExplicitGraph(space));
+    if(!built->build(t_u_v, max_edges)) return false;
+    graph = built;
+    return true;
+}
+Predicate Transition::explicit_fixpoint(const char* op, const Predicate& predl, 
+                                        const Predicate& predr, bool universal, bool least, 
+                                        const Predicate* init) const
+{
+    StateSet init_set = init ? graph->to_set(*init) : StateSet();
+    size_t iter = 0;
+    notify_begin(op);
+    StateSet acc = graph->fixpoint(graph->to_set(predl), graph->to_set(predr), universal, least,
+                                   init ? &init_set : NULL, iter, 
+                                   [&](const StateSet& prev, const StateSet& next)
+    {
+        notify_sets(op, iter, prev, next);
+    });
+    notify_end(op, iter);
+    return graph->to_pred(acc);
+}
+
+bool Transition::explicit_search(const Predicate& init, const Predicate* target, 
+                                 Predicate& reached, size_t& depth, 
+                                 std::vector<Predicate>* layers) const
+{
+    StateSet target_set = target ? graph->to_set(*target) : StateSet();
+    StateSet reached_set;
+    size_t iter = 0;
+    if(layers) layers->assign(init.is_false() ? 0 : 1, init);
+    notify_begin("reach");
+    bool found = graph->search(graph->to_set(init), target ? &target_set : NULL, reached_set,
+                               [&](const StateSet& prev, const StateSet& next, 
+                                   const StateSet& layer)
+    {
+        ++iter;
+        if(layers) layers->push_back(graph->to_pred(layer));
+        notify_sets("reach", iter, prev, next);
+    });
+    notify_end("reach", iter);
+    reached = graph->to_pred(reached_set);
+    if(found) depth = iter;
+    return found;
+}
+
+// Step of the fair EG fixpoint
+Predicate Transition::EG_fair_step(const Predicate& pred, const Predicate& acc) const
+{
+    Predicate nxt = pred;
+    for(std::vector<Predicate>::const_iterator i = fairness.begin(); i != fairness.end(); ++i)
+        nxt &= EX(EU(pred, *i && acc));
+    return nxt;
+}
 
 // Fair versions of the operators above
 Predicate Transition::EX_fair(const Predicate& pred) const
@@ -307,15 +730,255 @@ Predicate Transition::EG_fair(const Predicate& pred) const
         throw std::runtime_error("Transition has no fairness conditions for fair quantifier");
     if(space != pred.space) 
         throw std::runtime_error("Transition and predicate state spaces do not match");
-    Predicate acc(space, false);
-    Predicate nxt(space, true);
-    while(nxt != acc) 
+    if(graph)
     {
-        acc = nxt;
-        nxt = pred;
+        std::vector<StateSet> fair_sets;
         for(std::vector<Predicate>::const_iterator i = fairness.begin(); i != fairness.end(); ++i)
-            nxt &= EX(EU(pred, *i && acc));
+            fair_sets.push_back(graph->to_set(*i));
+        notify_begin("EG_fair");
+        Predicate ret = graph->to_pred(graph->EG_fair(graph->to_set(pred), fair_sets));
+        notify_end("EG_fair", 0);
+        return ret;
     }
+    if(fair_threads > 1 && fairness.size() > 1) return EG_fair_parallel(pred);
+    Predicate acc(space, true);
+    Predicate nxt(space, false);
+    size_t iter = 0;
+    notify_begin("EG_fair");
+    while((nxt = EG_fair_step(pred, acc)) != acc) { notify("EG_fair", ++iter, acc, nxt); acc = nxt; }
+    notify_end("EG_fair", iter);
+    return acc;
+}
+
+// A worker thread of a Simulator, with copies of the transition and initial states in a backend of
+// its own. The path is kept as bits, as States are tied to the space of the worker.
+struct SimWorker
+{
+    std::unique_ptr<BDDBackend> backend;
+    std::unique_ptr<StateSpace> space;
+    std::unique_ptr<Transition> trans;
+    std::unique_ptr<Predicate> init;
+    std::unique_ptr<Predicate> target;
+    size_t hit;                                 // Index of the run that hit target, if any
+    std::vector<std::vector<bool> > path;       // That run
+    std::exception_ptr error;
+};
+
+
+/**
+ * Impl Simulator
+ */
+Simulator::Simulator(const Transition& trans, const Predicate& init, unsigned threads)
+    : space(trans.space), no_init(init.is_false())
+{
+    // The copies are made on this thread, as the workers leave its backend alone
+    for(size_t w = 0; w < std::max<unsigned>(1, threads); ++w)
+    {
+        workers.push_back(std::unique_ptr<SimWorker>(new SimWorker()));
+        SimWorker& wk = *workers.back();
+        wk.backend.reset(BDD::new_backend());
+        BDD::set_thread_backend(wk.backend.get());
+        wk.space.reset(new StateSpace(space.state_bits, space.input_bits));
+        wk.trans.reset(new Transition(trans.transfer(*wk.space)));
+        wk.init.reset(new Predicate(init.transfer(*wk.space)));
+        BDD::set_thread_backend(NULL);
+    }
+}
+
+Simulator::~Simulator() {}
+
+bool Simulator::run(const Predicate& target, size_t traces, size_t depth, uint64_t seed,
+                    std::vector<State>& path)
+{
+    if(no_init || target.is_false()) return false;
+    // Runs are dealt out to the workers in turn. Once a run hits, runs after it are skipped.
+    size_t n_workers = std::max<size_t>(1, std::min<size_t>(workers.size(), traces));
+    std::atomic<size_t> first_hit(traces);
+    for(size_t w = 0; w < n_workers; ++w)
+    {
+        SimWorker& wk = *workers[w];
+        wk.hit = traces;
+        wk.path.clear();
+        wk.error = std::exception_ptr();
+        BDD::set_thread_backend(wk.backend.get());
+        wk.target.reset(new Predicate(target.transfer(*wk.space)));
+        BDD::set_thread_backend(NULL);
+    }
+    std::function<void(size_t)> run = [&](size_t w)
+    {
+        SimWorker& wk = *workers[w];
+        BDD::set_thread_backend(wk.backend.get());
+        try
+        {
+            for(size_t i = w; i < first_hit.load(); i += n_workers)
+            {
+                std::seed_seq seq{uint32_t(seed), uint32_t(seed >> 32), uint32_t(i), 
+                                  uint32_t(uint64_t(i) >> 32)};
+                std::mt19937_64 rng(seq);
+                std::vector<std::vector<bool> > run_path;
+                State st(*wk.init, &rng);
+                while(true)
+                {
+                    std::vector<bool> bits(space.state_bits);
+                    for(int b = 0; b < space.state_bits; ++b) bits[b] = st.bit(b);
+                    run_path.push_back(bits);
+                    if(Predicate(st).implies(*wk.target))
+                    {
+                        wk.hit = i;
+                        wk.path.swap(run_path);
+                        size_t prev = first_hit.load();
+                        while(i < prev && !first_hit.compare_exchange_weak(prev, i)) {}
+                        break;
+                    }
+                    if(run_path.size() > depth) break;
+                    Predicate succ = wk.trans->next(st);
+                    if(succ.is_false()) break;
+                    st = State(succ, &rng);
+                }
+                if(wk.hit == i) break;
+            }
+        }
+        catch(...) { wk.error = std::current_exception(); }
+        BDD::set_thread_backend(NULL);
+    };
+
+    std::vector<std::thread> thread_list;
+    for(size_t w = 0; w < n_workers; ++w) thread_list.push_back(std::thread(run, w));
+    for(size_t w = 0; w < n_workers; ++w) thread_list[w].join();
+    SimWorker* best = NULL;
+    for(size_t w = 0; w < n_workers; ++w)
+    {
+        if(workers[w]->error) std::rethrow_exception(workers[w]->error);
+        if(workers[w]->hit < traces && (!best || workers[w]->hit < best->hit))
+            best = workers[w].get();
+    }
+    if(!best) return false;
+    path.clear();
+    for(std::vector<std::vector<bool> >::const_iterator i = best->path.begin(); 
+            i != best->path.end(); ++i)
+        path.push_back(State(space, *i));
+    return true;
+}
+
+// A worker thread for EG_fair_parallel, with copies of the transition and predicates in a backend
+// of its own. The backend is declared first so that it is freed after the BDDs in it.
+struct FairWorker
+{
+    std::unique_ptr<BDDBackend> backend;
+    std::unique_ptr<StateSpace> space;
+    std::unique_ptr<Transition> trans;
+    std::unique_ptr<Predicate> pred;
+    std::vector<Predicate> fairness;        // The constraints given to this worker
+    std::vector<Predicate> results;         // Their steps in the last iteration
+    std::exception_ptr error;
+};
+
+Predicate Transition::EG_fair_parallel(const Predicate& pred) const
+{
+    // Constraints are dealt out to the workers in turn. The workers live for the whole fixpoint,
+    // setting up their copies when they start and then waiting for each iteration to be handed out
+    // to them. The backend of this thread is only read while they run an iteration.
+    size_t n_workers = std::min<size_t>(fair_threads, fairness.size());
+    std::vector<std::unique_ptr<FairWorker> > workers;
+    for(size_t w = 0; w < n_workers; ++w)
+    {
+        workers.push_back(std::unique_ptr<FairWorker>(new FairWorker()));
+        workers.back()->backend.reset(BDD::new_backend());
+    }
+    Predicate acc(space, true);
+    Predicate nxt(space, false);
+
+    // An iteration is handed out by bumping `round`, and is over once `pending` drops to 0
+    std::mutex mtx;
+    std::condition_variable start, done;
+    size_t round = 0, pending = n_workers;
+    bool finished = false;
+    std::function<void(size_t)> work = [&](size_t w)
+    {
+        FairWorker& wk = *workers[w];
+        BDD::set_thread_backend(wk.backend.get());
+        try
+        {
+            wk.space.reset(new StateSpace(space.state_bits, space.input_bits));
+            wk.trans.reset(new Transition(transfer(*wk.space)));
+            wk.pred.reset(new Predicate(pred.transfer(*wk.space)));
+            for(size_t i = w; i < fairness.size(); i += n_workers)
+                wk.fairness.push_back(fairness[i].transfer(*wk.space));
+        }
+        catch(...) { wk.error = std::current_exception(); }
+        for(size_t seen = 0; ; )
+        {
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                if(--pending == 0) done.notify_one();
+                start.wait(lock, [&] { return finished || round != seen; });
+                if(finished) break;
+                seen = round;
+            }
+            if(wk.error) continue;
+            try
+            {
+                Predicate wk_acc = acc.transfer(*wk.space);
+                wk.results.clear();
+                for(std::vector<Predicate>::const_iterator i = wk.fairness.begin();
+                        i != wk.fairness.end(); ++i)
+                    wk.results.push_back(wk.trans->EX(wk.trans->EU(*wk.pred, *i && wk_acc)));
+            }
+            catch(...) { wk.error = std::current_exception(); }
+        }
+        BDD::set_thread_backend(NULL);
+    };
+
+    std::vector<std::thread> threads;
+    std::function<void()> stop = [&]()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            finished = true;
+        }
+        start.notify_all();
+        for(size_t w = 0; w < threads.size(); ++w) threads[w].join();
+    };
+    size_t iter = 0;
+    notify_begin("EG_fair");
+    try
+    {
+        for(size_t w = 0; w < n_workers; ++w) threads.push_back(std::thread(work, w));
+        while(true)
+        {
+            // Wait for the workers to be set up, or to finish the iteration handed out to them
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                done.wait(lock, [&] { return pending == 0; });
+            }
+            for(size_t w = 0; w < n_workers; ++w)
+                if(workers[w]->error) std::rethrow_exception(workers[w]->error);
+            if(round > 0)
+            {
+                nxt = pred;
+                for(size_t w = 0; w < n_workers; ++w)
+                    for(std::vector<Predicate>::const_iterator i = workers[w]->results.begin();
+                            i != workers[w]->results.end(); ++i)
+                        nxt &= i->transfer(space);
+                if(nxt == acc) break;
+                notify("EG_fair", ++iter, acc, nxt);
+                acc = nxt;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                pending = n_workers;
+                ++round;
+            }
+            start.notify_all();
+        }
+    }
+    catch(...)
+    {
+        stop();
+        throw;
+    }
+    stop();
+    notify_end("EG_fair", iter);
     return acc;
 }
 Predicate Transition::EU_fair(const Predicate& predl, const Predicate& predr) const
@@ -377,69 +1040,89 @@ Predicate Transition::AR_fair(const Predicate& predl, const Predicate& predr) co
 
 
 // Witness or CEX generation
-Path Transition::gen_witness_EF(const Predicate& init, const Predicate& EFf,
-                                const Predicate& f) const
+void Transition::gen_witness_EF(const Predicate& init, const Predicate& EFf, const Predicate& f,
+                                TraceWriter& trace) const
 {
-    return gen_witness_EU(init, EFf, Predicate(init.space, true), f);
+    gen_witness_EU(init, EFf, Predicate(init.space, true), f, trace);
 }
-Path Transition::gen_witness_EG(const Predicate& init, const Predicate& EGf, 
-                                const Predicate& f) const
+void Transition::gen_witness_EG(const Predicate& init, const Predicate& EGf, const Predicate& f,
+                                TraceWriter& trace) const
 {
-    Path ret; ret.is_finite = false;
-    State st(init);
-    std::vector<State>::iterator loc;
+    trace.begin(space, false);
+    State st(init && EGf, witness_rng.get());
+    std::unordered_map<State, size_t> seen;     // Position of each state on the path
+    std::unordered_map<State, size_t>::const_iterator loc;
     // Keep generating a long path with states in EGf until it lassos
-    while((loc = std::find(ret.states.begin(), ret.states.end(), st)) == ret.states.end())
+    while((loc = seen.find(st)) == seen.end())
     {
-        ret.states.push_back(st);
-        st = State(next(st) && EGf);        // This will always be nonempty by definition of EGf
+        seen.insert(std::make_pair(st, seen.size()));
+        trace.state(st);
+        // This will always be nonempty by definition of EGf
+        st = State(next(st) && EGf, witness_rng.get());
     }
-    ret.lasso_point = loc - ret.states.begin();
-    return ret;
+    trace.end(loc->second);
 }
-Path Transition::gen_witness_EU(const Predicate& init, const Predicate& EfUg, const Predicate& f, 
-                                const Predicate& g) const
+void Transition::gen_witness_EU(const Predicate& init, const Predicate& EfUg, const Predicate& f, 
+                                const Predicate& g, TraceWriter& trace) const
 {
-    Predicate nxt = init;
+    trace.begin(space, true);
+    Predicate nxt = init && EfUg;             // Start from an initial state that has a witness
     Predicate end = nxt && g;
-    Path ret; ret.is_finite = true;
     Predicate allowed(init.space, true);       // Tracks which states have not been visited yet
     // This loop produces paths with non-repeating vertices from EfUg, as g is in EfUg, such a path
     // will hit g eventually
     while((end = (nxt && g)).is_false())
     {
-        State st(nxt);
+        State st(nxt, witness_rng.get());
         nxt = next(st) && EfUg && allowed;
         allowed &= !Predicate(st);
-        ret.states.push_back(st);
+        trace.state(st);
     }
-    ret.states.push_back(State(end));
-    return ret;
+    trace.state(State(end, witness_rng.get()));
+    trace.end(0);
+}
+void Transition::gen_witness_reach(const Predicate& init, const Predicate& target, size_t depth,
+                                   TraceWriter& trace) const
+{
+    // Only the depth is used, as the search may have been done over a reduction of this
+    // transition. The states that reach target in exactly i more steps are computed backwards,
+    // and the path walks forward through them.
+    std::vector<Predicate> leads(depth + 1, target);
+    for(size_t i = depth; i-- > 0; ) leads[i] = EX(leads[i + 1]);
+    trace.begin(space, true);
+    State st(init && leads[0], witness_rng.get());
+    trace.state(st);
+    for(size_t i = 1; i <= depth; ++i) 
+    {
+        st = State(next(st) && leads[i], witness_rng.get());
+        trace.state(st);
+    }
+    trace.end(0);
 }
-Path Transition::gen_witness_ER(const Predicate& init, const Predicate& EfRg, const Predicate& f, 
-                                const Predicate& g) const
+void Transition::gen_witness_ER(const Predicate& init, const Predicate& EfRg, const Predicate& f, 
+                                const Predicate& g, TraceWriter& trace) const
 {
-    return gen_witness_EU(init, EfRg, f, f && g);
+    gen_witness_EU(init, EfRg, f, f && g, trace);
 }
-Path Transition::gen_cex_AF(const Predicate& init, const Predicate& AFf, 
-                                const Predicate& f) const
+void Transition::gen_cex_AF(const Predicate& init, const Predicate& AFf, const Predicate& f,
+                            TraceWriter& trace) const
 {
-    return gen_witness_EG(init, !AFf /*=EG!f*/, !f);
+    gen_witness_EG(init, !AFf /*=EG!f*/, !f, trace);
 }
-Path Transition::gen_cex_AG(const Predicate& init, const Predicate& AGf, 
-                                const Predicate& f) const
+void Transition::gen_cex_AG(const Predicate& init, const Predicate& AGf, const Predicate& f,
+                            TraceWriter& trace) const
 {
-    return gen_witness_EF(init, !AGf /*=EF!f*/, !f);
+    gen_witness_EF(init, !AGf /*=EF!f*/, !f, trace);
 }
-Path Transition::gen_cex_AU(const Predicate& init, const Predicate& AfUg, const Predicate& f, 
-                                const Predicate& g) const
+void Transition::gen_cex_AU(const Predicate& init, const Predicate& AfUg, const Predicate& f, 
+                            const Predicate& g, TraceWriter& trace) const
 {
-    return gen_witness_ER(init, !AfUg /*=E!fR!g*/, !f, !g);
+    gen_witness_ER(init, !AfUg /*=E!fR!g*/, !f, !g, trace);
 }
-Path Transition::gen_cex_AR(const Predicate& init, const Predicate& AfRg, const Predicate& f, 
-                                const Predicate& g) const
+void Transition::gen_cex_AR(const Predicate& init, const Predicate& AfRg, const Predicate& f, 
+                            const Predicate& g, TraceWriter& trace) const
 {
-    return gen_witness_EU(init, !AfRg /*=E!fU!g*/, !f, !g);
+    gen_witness_EU(init, !AfRg /*=E!fU!g*/, !f, !g, trace);
 }
 
 
@@ -473,7 +1156,7 @@ Predicate& Predicate::operator=(const Predicate& other)
     return *this;
 }
 
-Predicate::Predicate(const State& st) : Predicate(st.space, st.bdd_u, true) {}
+Predicate::Predicate(const State& st) : Predicate(st.space, st.cube_u(), true) {}
 
 
 // Operators
@@ -485,9 +1168,9 @@ Predicate operator&&(const Predicate& predl, const Predicate& predr)
     if(!predl.is_p_u_repr && !predr.is_p_u_repr)
         return Predicate(space, predl.p_v && predr.p_v, false);
     BDD ddl = predl.is_p_u_repr ? predl.p_u 
-                    : (predl.p_v && space.var_eq_bdd).existential_abstraction(space.cube_v);
+                    : predl.p_v.and_abstraction(space.var_eq_bdd, space.cube_v);
     BDD ddr = predr.is_p_u_repr ? predr.p_u 
-                    : (predr.p_v && space.var_eq_bdd).existential_abstraction(space.cube_v);
+                    : predr.p_v.and_abstraction(space.var_eq_bdd, space.cube_v);
     return Predicate(space, ddl && ddr, true);
 }
 
@@ -499,9 +1182,9 @@ Predicate operator||(const Predicate& predl, const Predicate& predr)
     if(!predl.is_p_u_repr && !predr.is_p_u_repr)
         return Predicate(space, predl.p_v || predr.p_v, false);
     BDD ddl = predl.is_p_u_repr ? predl.p_u 
-                    : (predl.p_v && space.var_eq_bdd).existential_abstraction(space.cube_v);
+                    : predl.p_v.and_abstraction(space.var_eq_bdd, space.cube_v);
     BDD ddr = predr.is_p_u_repr ? predr.p_u 
-                    : (predr.p_v && space.var_eq_bdd).existential_abstraction(space.cube_v);
+                    : predr.p_v.and_abstraction(space.var_eq_bdd, space.cube_v);
     return Predicate(space, ddl || ddr, true);
 }
 
@@ -513,9 +1196,9 @@ Predicate operator^(const Predicate& predl, const Predicate& predr)
     if(!predl.is_p_u_repr && !predr.is_p_u_repr)
         return Predicate(space, predl.p_v ^ predr.p_v, false);
     BDD ddl = predl.is_p_u_repr ? predl.p_u 
-                    : (predl.p_v && space.var_eq_bdd).existential_abstraction(space.cube_v);
+                    : predl.p_v.and_abstraction(space.var_eq_bdd, space.cube_v);
     BDD ddr = predr.is_p_u_repr ? predr.p_u 
-                    : (predr.p_v && space.var_eq_bdd).existential_abstraction(space.cube_v);
+                    : predr.p_v.and_abstraction(space.var_eq_bdd, space.cube_v);
     return Predicate(space, ddl ^ ddr, true);
 }
 
@@ -544,13 +1227,57 @@ bool operator!=(const Predicate& predl, const Predicate& predr) { return !(predl
 BDD Predicate::get_bdd() const
 {
     if(is_p_u_repr) return p_u;
-    return (p_v && space.var_eq_bdd).existential_abstraction(space.cube_v);
+    return p_v.and_abstraction(space.var_eq_bdd, space.cube_v);
 }
 
 
+bool Predicate::implies(const Predicate& other) const
+{
+    if(space != other.space) 
+        throw std::runtime_error("Cannot operate on predicates on different spaces");
+    if(is_p_u_repr == other.is_p_u_repr)
+        return (is_p_u_repr ? p_u : p_v).leq(other.is_p_u_repr ? other.p_u : other.p_v);
+    return get_bdd().leq(other.get_bdd());
+}
+
+Predicate Predicate::restrict(const Predicate& care) const
+{
+    if(space != care.space) 
+        throw std::runtime_error("Cannot operate on predicates on different spaces");
+    if(is_p_u_repr == care.is_p_u_repr)
+        return is_p_u_repr ? Predicate(space, p_u.restrict(care.p_u), true)
+                           : Predicate(space, p_v.restrict(care.p_v), false);
+    return Predicate(space, get_bdd().restrict(care.get_bdd()), true);
+}
+
 // Check if sat or valid
 bool Predicate::is_true()  const { return (is_p_u_repr ? p_u : p_v).is_one();  }
 bool Predicate::is_false() const { return (is_p_u_repr ? p_u : p_v).is_zero(); }
 
 
+// Size
+size_t Predicate::node_count() const { return (is_p_u_repr ? p_u : p_v).node_count(); }
+
+std::string Predicate::count_states() const
+{
+    return is_p_u_repr ? p_u.count_minterms(space.u_vars) : p_v.count_minterms(space.v_vars);
+}
+
+std::vector<int> Predicate::support() const
+{
+    // The u and v variables of bit k are 2k and 2k + 1
+    std::vector<int> vars = (is_p_u_repr ? p_u : p_v).support();
+    std::vector<int> ret;
+    for(std::vector<int>::const_iterator i = vars.begin(); i != vars.end(); ++i)
+        if(*i < 2 * space.state_bits) ret.push_back(*i / 2);
+    return ret;
+}
+
+Predicate Predicate::transfer(const StateSpace& sp) const
+{
+    if(sp != space) throw std::runtime_error("Cannot transfer Predicate to a different StateSpace");
+    return Predicate(sp, (is_p_u_repr ? p_u : p_v).transfer(), is_p_u_repr);
+}
+
+
 
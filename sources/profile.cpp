@@ -0,0 +1,174 @@
+/**
+ * Implements the Profiler class declared in `headers/profile.hpp`.
+ */
+
+#include "headers/profile.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+
+
+/**
+ * Escape a string so that it can be put in a JSON string literal
+ */
+static std::string json_escape(const std::string& str)
+{
+    std::string ret;
+    for(char c : str)
+    {
+        if(c == '"' || c == '\\') ret += '\\';
+        ret += c;
+    }
+    return ret;
+}
+
+/**
+ * Order records by decreasing self time
+ */
+struct BySelfTime
+{
+    template<class R> bool operator()(const R& l, const R& r) const
+    {
+        return l.total_time - l.child_time > r.total_time - r.child_time;
+    }
+};
+
+
+
+// CTOR, DTOR
+Profiler::Profiler(Transition& tr, bool tc) 
+    : trans(tr), trace(tc), origin(std::chrono::steady_clock::now()), property(0)
+{
+    trans.add_listener(this);
+}
+
+Profiler::~Profiler() { trans.remove_listener(this); }
+
+double Profiler::now() const
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - origin).count();
+}
+
+
+// Setup
+void Profiler::begin_property(size_t index) { property = index; }
+
+
+// Nodes
+void Profiler::begin_node(const std::string& op, const std::string& location)
+{
+    NodeRecord rec;
+    rec.property = property;
+    rec.op = op;
+    rec.location = location.empty() ? "?" : location;
+    rec.total_time = rec.child_time = 0;
+    rec.iterations = rec.result_nodes = 0;
+    records.push_back(rec);
+    node_stack.push_back(records.size() - 1);
+    node_starts.push_back(now());
+}
+
+void Profiler::end_node(const Predicate& result)
+{
+    if(node_stack.empty()) throw std::runtime_error("Profiler node ended without being begun");
+    double end = now();
+    NodeRecord& rec = records[node_stack.back()];
+    rec.total_time = end - node_starts.back();
+    rec.result_nodes = result.node_count();
+    rec.result_states = result.count_states();
+    node_stack.pop_back();
+    node_starts.pop_back();
+    if(!node_stack.empty()) records[node_stack.back()].child_time += rec.total_time;
+    if(trace)
+    {
+        TraceEvent ev;
+        ev.name = rec.op + " @ " + rec.location;
+        ev.category = "node";
+        ev.start = end - rec.total_time;
+        ev.duration = rec.total_time;
+        std::ostringstream args;
+        args << "{\"property\": " << rec.property << ", \"iterations\": " << rec.iterations 
+             << ", \"result_nodes\": " << rec.result_nodes 
+             << ", \"result_states\": " << rec.result_states << "}";
+        ev.args = args.str();
+        events.push_back(ev);
+    }
+}
+
+
+// Fixpoints
+void Profiler::on_begin(const char*)
+{
+    double t = now();
+    fixpoint_starts.push_back(t);
+    iteration_starts.push_back(t);
+}
+
+void Profiler::on_iteration(const char* op, size_t iteration, const Predicate& prev, 
+                            const Predicate& next)
+{
+    if(!node_stack.empty()) ++records[node_stack.back()].iterations;
+    if(!trace || iteration_starts.empty()) return;
+    double t = now();
+    TraceEvent ev;
+    ev.name = std::string(op) + " iteration " + std::to_string(iteration);
+    ev.category = "iteration";
+    ev.start = iteration_starts.back();
+    ev.duration = t - ev.start;
+    ev.args = "{\"nodes\": " + std::to_string(next.node_count()) + "}";
+    events.push_back(ev);
+    iteration_starts.back() = t;
+}
+
+void Profiler::on_end(const char* op, size_t iterations)
+{
+    if(fixpoint_starts.empty()) return;
+    if(trace)
+    {
+        TraceEvent ev;
+        ev.name = op;
+        ev.category = "fixpoint";
+        ev.start = fixpoint_starts.back();
+        ev.duration = now() - ev.start;
+        ev.args = "{\"iterations\": " + std::to_string(iterations) + "}";
+        events.push_back(ev);
+    }
+    fixpoint_starts.pop_back();
+    iteration_starts.pop_back();
+}
+
+
+// Output
+void Profiler::print_hotspots(std::ostream& out) const
+{
+    std::vector<NodeRecord> sorted(records);
+    std::stable_sort(sorted.begin(), sorted.end(), BySelfTime());
+    out << "Profile, sorted by self time:" << std::endl;
+    out << std::left << std::setw(6)  << "prop" << std::setw(20) << "location" 
+        << std::setw(8) << "op" << std::setw(14) << "self (ms)" << std::setw(14) << "total (ms)" 
+        << std::setw(8) << "iters" << std::setw(10) << "nodes" << "states" << std::endl;
+    for(std::vector<NodeRecord>::const_iterator i = sorted.begin(); i != sorted.end(); ++i)
+        out << std::setw(6) << i->property << std::setw(20) << i->location << std::setw(8) << i->op 
+            << std::setw(14) << (i->total_time - i->child_time) / 1000 
+            << std::setw(14) << i->total_time / 1000
+            << std::setw(8) << i->iterations << std::setw(10) << i->result_nodes 
+            << i->result_states << std::endl;
+    out << std::right;
+}
+
+void Profiler::write_trace(std::ostream& out) const
+{
+    out << "{\"traceEvents\": [" << std::endl;
+    for(std::vector<TraceEvent>::const_iterator i = events.begin(); i != events.end(); ++i)
+    {
+        out << "{\"name\": \"" << json_escape(i->name) << "\", \"cat\": \"" << i->category 
+            << "\", \"ph\": \"X\", \"ts\": " << std::fixed << std::setprecision(3) << i->start 
+            << ", \"dur\": " << i->duration << std::defaultfloat
+            << ", \"pid\": 1, \"tid\": 1, \"args\": " << i->args << "}"
+            << (i + 1 == events.end() ? "" : ",") << std::endl;
+    }
+    out << "]}" << std::endl;
+}
@@ -0,0 +1,158 @@
+/**
+ * Implements the ProgressReporter class declared in `headers/progress.hpp`.
+ */
+
+#include "headers/progress.hpp"
+
+#include <csignal>
+#include <iomanip>
+
+
+
+/**
+ * Set by the signal handler to request a report, polled by the reporting thread
+ */
+static volatile std::sig_atomic_t report_requested = 0;
+
+static void request_report(int) { report_requested = 1; }
+
+/**
+ * How often the reporting thread wakes up to check for signals
+ */
+static const std::chrono::milliseconds poll_interval(100);
+
+
+
+// CTOR, DTOR
+ProgressReporter::ProgressReporter(Transition& tr, std::ostream& o, double intv)
+    : trans(tr), out(o), interval(intv), start(std::chrono::steady_clock::now()), property(0), 
+      current_nodes(0), frontier_nodes(0), live_nodes(0), memory_in_use(0), sizes_due(false),
+      sizes_wanted(false), stop(false)
+{
+#ifdef SIGUSR1
+    std::signal(SIGUSR1, request_report);
+#endif
+    trans.add_listener(this);
+    reporter = std::thread(&ProgressReporter::run, this);
+}
+
+ProgressReporter::~ProgressReporter()
+{
+    trans.remove_listener(this);
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stop = true;
+    }
+    wakeup.notify_all();
+    reporter.join();
+#ifdef SIGUSR1
+    std::signal(SIGUSR1, SIG_DFL);
+#endif
+}
+
+
+// Publishing state
+void ProgressReporter::begin_property(size_t index)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    property = index;
+    ops.clear();
+    iterations.clear();
+    current_nodes = frontier_nodes = 0;
+}
+
+void ProgressReporter::on_begin(const char* op)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    ops.push_back(op);
+    iterations.push_back(0);
+}
+
+bool ProgressReporter::wants_predicates()
+{
+    // Read once, so that on_iteration is only given the iterates it was promised
+    sizes_wanted = sizes_due;
+    return sizes_wanted;
+}
+
+void ProgressReporter::on_iteration(const char*, size_t iter, const Predicate& prev, 
+                                    const Predicate& next)
+{
+    if(!sizes_wanted)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if(!iterations.empty()) iterations.back() = iter;
+        return;
+    }
+
+    // Compute sizes outside the lock, these may take a while on large BDDs
+    size_t cur = next.node_count();
+    size_t frontier = (next ^ prev).node_count();
+    ManagerStats st = BDD::read_manager_stats();
+    std::lock_guard<std::mutex> lock(mtx);
+    if(!iterations.empty()) iterations.back() = iter;
+    current_nodes = cur;
+    frontier_nodes = frontier;
+    live_nodes = st.live_nodes;
+    memory_in_use = st.memory_in_use;
+    sizes_due = false;
+    report();
+}
+
+void ProgressReporter::on_end(const char*, size_t)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    if(!ops.empty()) 
+    {
+        ops.pop_back();
+        iterations.pop_back();
+    }
+}
+
+
+// Reporting
+void ProgressReporter::run()
+{
+    std::unique_lock<std::mutex> lock(mtx);
+    std::chrono::steady_clock::time_point last = std::chrono::steady_clock::now();
+    while(!stop)
+    {
+        wakeup.wait_for(lock, poll_interval);
+        if(stop) break;
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        bool due = interval.count() > 0 && now - last >= interval;
+        if(due || report_requested)
+        {
+            report_requested = 0;
+            last = now;
+            request();
+        }
+        // A fixpoint that ends before its next iteration leaves the report to this thread
+        else if(sizes_due && ops.empty())
+        {
+            sizes_due = false;
+            report();
+        }
+    }
+}
+
+void ProgressReporter::request()
+{
+    if(ops.empty()) report();
+    else sizes_due = true;
+}
+
+void ProgressReporter::report()
+{
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    out << "[progress] " << std::fixed << std::setprecision(1) << elapsed.count() << "s"
+        << " property " << property << " ";
+    if(ops.empty()) out << "(no fixpoint)";
+    for(size_t i = 0; i < ops.size(); ++i) 
+        out << (i ? " > " : "") << ops[i] << " iteration " << iterations[i];
+    out << " current " << current_nodes << " nodes"
+        << " frontier " << frontier_nodes << " nodes"
+        << " live " << live_nodes << " nodes"
+        << " memory " << std::setprecision(1) << memory_in_use / (1024.0 * 1024.0) << " MiB"
+        << std::defaultfloat << std::endl;
+}
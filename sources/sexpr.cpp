@@ -0,0 +1,221 @@
+/**
+ * Implements the s-expression reader declared in `headers/sexpr.hpp`
+ */
+
+#include "headers/sexpr.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>                  // open
+#include <sys/mman.h>               // mmap
+#include <sys/stat.h>               // fstat
+#include <unistd.h>                 // close
+
+
+
+/**
+ * Impl StrRef
+ */
+bool operator==(const StrRef& ref, const char* str)
+{
+    return std::strlen(str) == ref.size && std::equal(ref.data, ref.data + ref.size, str);
+}
+
+bool operator!=(const StrRef& ref, const char* str) { return !(ref == str); }
+
+bool operator==(const StrRef& refl, const StrRef& refr)
+{
+    return refl.size == refr.size && std::equal(refl.data, refl.data + refl.size, refr.data);
+}
+
+bool operator<(const StrRef& refl, const StrRef& refr)
+{
+    return std::lexicographical_compare(refl.data, refl.data + refl.size,
+                                        refr.data, refr.data + refr.size);
+}
+
+std::ostream& operator<<(std::ostream& out, const StrRef& ref)
+{
+    return out.write(ref.data, ref.size);
+}
+
+
+
+/**
+ * Impl MappedFile
+ */
+MappedFile::MappedFile(const std::string& path) : addr(NULL), len(0)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) throw std::runtime_error("Failed to open " + path);
+    struct stat st;
+    if(fstat(fd, &st) < 0)
+    {
+        close(fd);
+        throw std::runtime_error("Failed to stat " + path);
+    }
+    len = st.st_size;
+    // mmap does not accept empty mappings, an empty file is left unmapped
+    if(len > 0)
+    {
+        void* map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(map == MAP_FAILED)
+        {
+            close(fd);
+            throw std::runtime_error("Failed to map " + path);
+        }
+        madvise(map, len, MADV_SEQUENTIAL);
+        addr = static_cast<const char*>(map);
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if(addr) munmap(const_cast<char*>(addr), len);
+}
+
+
+
+/**
+ * Impl Lexer
+ */
+static bool is_delim(char c)
+{
+    return c == '(' || c == ')' || c == ';' || c == ' ' || c == '\t' || c == '\n' || c == '\r' ||
+           c == '\v' || c == '\f';
+}
+
+Lexer::Lexer(const char* data, size_t size) : data(data), size(size), pos(0) {}
+
+void Lexer::skip_space()
+{
+    while(pos < size)
+    {
+        if(data[pos] == ';')
+            while(pos < size && data[pos] != '\n') ++pos;
+        else if(is_delim(data[pos]) && data[pos] != '(' && data[pos] != ')') ++pos;
+        else break;
+    }
+}
+
+Token Lexer::next()
+{
+    skip_space();
+    Token tok;
+    tok.offset = pos;
+    if(pos >= size)
+    {
+        tok.kind = Token::END;
+        return tok;
+    }
+    if(data[pos] == '(' || data[pos] == ')')
+    {
+        tok.kind = data[pos] == '(' ? Token::OPEN : Token::CLOSE;
+        tok.text = StrRef(data + pos, 1);
+        ++pos;
+        return tok;
+    }
+    size_t start = pos;
+    while(pos < size && !is_delim(data[pos])) ++pos;
+    tok.kind = Token::ATOM;
+    tok.text = StrRef(data + start, pos - start);
+    return tok;
+}
+
+Token Lexer::peek()
+{
+    size_t saved = pos;
+    Token tok = next();
+    pos = saved;
+    return tok;
+}
+
+Token Lexer::expect(Token::Kind kind, const std::string& msg)
+{
+    Token tok = next();
+    if(tok.kind != kind) throw std::runtime_error(location(tok.offset) + ": " + msg);
+    return tok;
+}
+
+size_t Lexer::skip()
+{
+    size_t depth = 0;
+    do
+    {
+        Token tok = next();
+        if(tok.kind == Token::END)
+            throw std::runtime_error(location(tok.offset) + ": unexpected end of file");
+        if(tok.kind == Token::CLOSE)
+        {
+            if(depth == 0) throw std::runtime_error(location(tok.offset) + ": unexpected `)`");
+            --depth;
+        }
+        else if(tok.kind == Token::OPEN) ++depth;
+    }
+    while(depth > 0);
+    return pos;
+}
+
+std::string Lexer::location(size_t offset) const
+{
+    if(line_starts.empty())
+    {
+        line_starts.push_back(0);
+        for(size_t i = 0; i < size; ++i) if(data[i] == '\n') line_starts.push_back(i + 1);
+    }
+    size_t line = std::upper_bound(line_starts.begin(), line_starts.end(), offset)
+                    - line_starts.begin();
+    return std::to_string(line) + ":" + std::to_string(offset - line_starts[line - 1] + 1);
+}
+
+
+
+/**
+ * Impl SExpr
+ */
+StrRef SExpr::head() const
+{
+    if(atom || children.empty() || !children[0].atom) return StrRef();
+    return children[0].text;
+}
+
+std::string SExpr::to_string() const
+{
+    if(atom) return text.str();
+    std::string ret = "(";
+    for(size_t i = 0; i < children.size(); ++i)
+    {
+        if(i > 0) ret += " ";
+        ret += children[i].to_string();
+    }
+    return ret + ")";
+}
+
+SExpr parse_sexpr(Lexer& lex)
+{
+    SExpr expr;
+    Token tok = lex.next();
+    expr.begin = tok.offset;
+    if(tok.kind == Token::ATOM)
+    {
+        expr.atom = true;
+        expr.text = tok.text;
+        expr.end = lex.position();
+        expr.location = lex.location(expr.begin) + "-" + lex.location(expr.end - 1);
+        return expr;
+    }
+    if(tok.kind == Token::END)
+        throw std::runtime_error(lex.location(tok.offset) + ": unexpected end of file");
+    if(tok.kind == Token::CLOSE)
+        throw std::runtime_error(lex.location(tok.offset) + ": unexpected `)`");
+
+    expr.atom = false;
+    while(lex.peek().kind != Token::CLOSE) expr.children.push_back(parse_sexpr(lex));
+    lex.next();
+    expr.end = lex.position();
+    expr.location = lex.location(expr.begin) + "-" + lex.location(expr.end - 1);
+    return expr;
+}
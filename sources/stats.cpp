@@ -0,0 +1,78 @@
+/**
+ * Implements the StatsCollector class declared in `headers/stats.hpp`.
+ */
+
+#include "headers/stats.hpp"
+
+
+
+StatsCollector::StatsCollector(Transition& tr, const Predicate& init, std::ostream& o) 
+    : trans(tr), out(o), checked(&tr), cone_bits(tr.space.state_bits), 
+      init_states(init.count_states()), init_nodes(init.node_count()), 
+      start_stats(BDD::read_manager_stats()) 
+{
+    Predicate reachable = trans.reachable(init);
+    reachable_states = reachable.count_states();
+    reachable_nodes = reachable.node_count();
+    trans.add_listener(this);
+}
+
+StatsCollector::~StatsCollector() { trans.remove_listener(this); }
+
+
+void StatsCollector::begin_property()
+{
+    iterations.clear();
+    checked = &trans;
+    cone_bits = trans.space.state_bits;
+    start_stats = BDD::read_manager_stats();
+    start_time = std::chrono::steady_clock::now();
+}
+
+void StatsCollector::set_cone(const Transition& tr, int bits)
+{
+    checked = &tr;
+    cone_bits = bits;
+}
+
+void StatsCollector::on_iteration(const char* op, size_t iteration, const Predicate& prev, 
+                                  const Predicate& next)
+{
+    ++iterations[op];
+}
+
+void StatsCollector::end_property(size_t index, bool sat)
+{
+    std::chrono::duration<double> wall_time = std::chrono::steady_clock::now() - start_time;
+    ManagerStats end_stats = BDD::read_manager_stats();
+    double lookups = end_stats.cache_lookups - start_stats.cache_lookups;
+    double hits = end_stats.cache_hits - start_stats.cache_hits;
+
+    out << "{\"property\": " << index 
+        << ", \"verdict\": \"" << (sat ? "sat" : "unsat") << "\""
+        << ", \"wall_time_s\": " << wall_time.count()
+        << ", \"iterations\": {";
+    for(std::map<std::string, size_t>::const_iterator i = iterations.begin(); 
+            i != iterations.end(); ++i)
+        out << (i == iterations.begin() ? "" : ", ") << "\"" << i->first << "\": " << i->second;
+    out << "}"
+        << ", \"peak_nodes\": " << end_stats.peak_nodes
+        << ", \"peak_nodes_increase\": " << end_stats.peak_nodes - start_stats.peak_nodes
+        << ", \"final_live_nodes\": " << end_stats.live_nodes
+        << ", \"cache_lookups\": " << lookups
+        << ", \"cache_hits\": " << hits
+        << ", \"cache_hit_rate\": " << (lookups > 0 ? hits / lookups : 0.0)
+        << ", \"gc_count\": " << end_stats.gc_count - start_stats.gc_count
+        << ", \"gc_time_ms\": " << end_stats.gc_time - start_stats.gc_time
+        << ", \"reorder_count\": " << end_stats.reorder_count - start_stats.reorder_count
+        << ", \"reorder_time_ms\": " << end_stats.reorder_time - start_stats.reorder_time
+        << ", \"state_bits\": " << trans.space.state_bits
+        << ", \"init_states\": " << init_states
+        << ", \"init_nodes\": " << init_nodes
+        << ", \"reachable_states\": " << reachable_states
+        << ", \"reachable_nodes\": " << reachable_nodes
+        << ", \"cone_bits\": " << cone_bits
+        << ", \"transition_nodes\": {\"t_u_v\": " << checked->size_u_v() 
+        << ", \"t_v_u\": " << checked->size_v_u() << "}"
+        << "}" << std::endl;
+}
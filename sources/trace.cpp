@@ -0,0 +1,235 @@
+/**
+ * Implements the trace writers declared in `headers/trace.hpp`.
+ */
+
+#include "headers/trace.hpp"
+
+#include <algorithm>
+#include <string>
+
+
+
+// Size the buffer is written out at
+static const size_t flush_size = size_t(1) << 16;
+
+
+/**
+ * Impl BufferedTraceWriter
+ */
+BufferedTraceWriter::BufferedTraceWriter(std::ostream& o)
+    : out(o), state_bits(0), finite(true), n_states(0), n_paths(0) {}
+
+BufferedTraceWriter::~BufferedTraceWriter() { flush(true); }
+
+void BufferedTraceWriter::begin(const StateSpace& space, bool fin)
+{
+    state_bits = space.state_bits;
+    finite = fin;
+    n_states = 0;
+    prev.assign((state_bits + 63) / 64, 0);
+}
+
+void BufferedTraceWriter::end(size_t)
+{
+    ++n_paths;
+    flush(true);
+}
+
+void BufferedTraceWriter::flush(bool force)
+{
+    if(buf.empty() || (!force && buf.size() < flush_size)) return;
+    out.write(buf.data(), buf.size());
+    if(force) out.flush();
+    buf.clear();
+}
+
+const std::vector<int>& BufferedTraceWriter::changed_bits(const State& st)
+{
+    changes.clear();
+    const std::vector<uint64_t>& words = st.packed();
+    for(size_t w = 0; w < words.size(); ++w)
+    {
+        for(uint64_t diff = words[w] ^ prev[w]; diff; diff &= diff - 1)
+            changes.push_back(w * 64 + __builtin_ctzll(diff));
+        prev[w] = words[w];
+    }
+    ++n_states;
+    return changes;
+}
+
+
+/**
+ * Impl TextTraceWriter
+ */
+void TextTraceWriter::begin(const StateSpace& space, bool fin)
+{
+    BufferedTraceWriter::begin(space, fin);
+    line_starts.clear();
+    buf += finite ? "Finite path:\n" : "Infinite path:\n";
+    for(int i = 0; i < state_bits; i++)
+    {
+        std::string num = std::to_string(i);
+        buf += "v" + num + std::string(3 - std::min<size_t>(num.size(), 3), ' ');
+    }
+    buf += '\n';
+}
+
+void TextTraceWriter::state(const State& st)
+{
+    ++n_states;
+    if(!finite) line_starts.push_back(buf.size());
+    for(int i = 0; i < state_bits; ++i)
+    {
+        buf += st.bit(i) ? '1' : '0';
+        buf.append(3, ' ');
+    }
+    buf += '\n';
+    // The rows of a lasso stay in the buffer until the loop is known
+    if(finite) flush();
+}
+
+void TextTraceWriter::end(size_t lasso_point)
+{
+    if(!finite)
+    {
+        size_t pos = lasso_point < line_starts.size() ? line_starts[lasso_point] : buf.size();
+        buf.insert(pos, "Begin Loop\n");
+    }
+    BufferedTraceWriter::end(lasso_point);
+}
+
+
+/**
+ * Impl VcdTraceWriter
+ */
+void VcdTraceWriter::begin(const StateSpace& space, bool fin)
+{
+    BufferedTraceWriter::begin(space, fin);
+    buf += "$version cudd-ctl-mc ";
+    buf += finite ? "finite" : "infinite";
+    buf += " path $end\n$timescale 1ns $end\n$scope module state $end\n";
+    // Identifiers are numbers in base 94, written with the printable characters from '!' on
+    ids.resize(state_bits);
+    for(int i = 0; i < state_bits; ++i)
+    {
+        ids[i].clear();
+        for(int n = i; ; n /= 94)
+        {
+            ids[i] += char('!' + n % 94);
+            if(n < 94) break;
+        }
+        buf += "$var wire 1 " + ids[i] + " v" + std::to_string(i) + " $end\n";
+    }
+    buf += "$upscope $end\n$enddefinitions $end\n";
+}
+
+void VcdTraceWriter::state(const State& st)
+{
+    bool first = n_states == 0;
+    const std::vector<int>& changes = changed_bits(st);
+    buf += "#" + std::to_string(n_states - 1) + "\n";
+    // The first step sets every wire
+    if(first)
+    {
+        buf += "$dumpvars\n";
+        for(int i = 0; i < state_bits; ++i) buf += (st.bit(i) ? "1" : "0") + ids[i] + "\n";
+        buf += "$end\n";
+    }
+    else
+    {
+        for(std::vector<int>::const_iterator i = changes.begin(); i != changes.end(); ++i)
+            buf += (st.bit(*i) ? "1" : "0") + ids[*i] + "\n";
+    }
+    flush();
+}
+
+void VcdTraceWriter::end(size_t lasso_point)
+{
+    buf += "#" + std::to_string(n_states) + "\n";
+    if(!finite) buf += "$comment loop back to #" + std::to_string(lasso_point) + " $end\n";
+    BufferedTraceWriter::end(lasso_point);
+}
+
+
+/**
+ * Impl JsonTraceWriter
+ */
+void JsonTraceWriter::begin(const StateSpace& space, bool fin)
+{
+    BufferedTraceWriter::begin(space, fin);
+    buf += "{\"finite\": ";
+    buf += finite ? "true" : "false";
+    buf += ", \"state_bits\": " + std::to_string(state_bits) + ", \"states\": [";
+}
+
+void JsonTraceWriter::state(const State& st)
+{
+    buf += n_states++ ? ",\n\"" : "\n\"";
+    for(int i = 0; i < state_bits; ++i) buf += st.bit(i) ? '1' : '0';
+    buf += '"';
+    flush();
+}
+
+void JsonTraceWriter::end(size_t lasso_point)
+{
+    buf += "\n]";
+    if(!finite) buf += ", \"lasso_point\": " + std::to_string(lasso_point);
+    buf += "}\n";
+    BufferedTraceWriter::end(lasso_point);
+}
+
+
+/**
+ * Impl BinaryTraceWriter
+ */
+void BinaryTraceWriter::put_varint(uint64_t value)
+{
+    for(; value >= 0x80; value >>= 7) buf += char((value & 0x7f) | 0x80);
+    buf += char(value);
+}
+
+void BinaryTraceWriter::begin(const StateSpace& space, bool fin)
+{
+    BufferedTraceWriter::begin(space, fin);
+    buf += "CTLTRACE";
+    put_varint(1);
+    put_varint(state_bits);
+    put_varint(finite ? 1 : 0);
+}
+
+void BinaryTraceWriter::state(const State& st)
+{
+    const std::vector<int>& changes = changed_bits(st);
+    put_varint(changes.size() + 1);
+    int last = -1;
+    for(std::vector<int>::const_iterator i = changes.begin(); i != changes.end(); ++i)
+    {
+        put_varint(*i - last - 1);
+        last = *i;
+    }
+    flush();
+}
+
+void BinaryTraceWriter::end(size_t lasso_point)
+{
+    put_varint(0);
+    put_varint(lasso_point);
+    BufferedTraceWriter::end(lasso_point);
+}
+
+
+// Factory
+BufferedTraceWriter* make_trace_writer(const std::string& format, std::ostream& out)
+{
+    if(format == "text")    return new TextTraceWriter(out);
+    if(format == "vcd")     return new VcdTraceWriter(out);
+    if(format == "json")    return new JsonTraceWriter(out);
+    if(format == "binary")  return new BinaryTraceWriter(out);
+    return NULL;
+}
+
+std::string trace_extension(const std::string& format)
+{
+    if(format == "binary") return "trace";
+    return format == "text" ? "txt" : format;
+}